@@ -1,6 +1,7 @@
-#include "Platform/Windows/Windows.h"
 #include "Atomic.h"
 
+#include "Platform/Atomic.h"
+
 using namespace Helium;
 
 AtomicRefCountBase::AtomicRefCountBase()
@@ -16,17 +17,19 @@ AtomicRefCountBase::~AtomicRefCountBase()
 
 int AtomicRefCountBase::GetRefCount() const
 {
-    return m_RefCount;
+    return Helium::AtomicLoad( &m_RefCount, MemoryOrders::Relaxed );
 }
 
 void AtomicRefCountBase::IncrRefCount() const
 {
-    InterlockedIncrement( (LONG*) &m_RefCount ); 
+    // taking a new reference needs no ordering, the caller already holds one
+    Helium::AtomicIncrement( &m_RefCount, MemoryOrders::Relaxed );
 }
 
 void AtomicRefCountBase::DecrRefCount() const
 {
-    LONG result = InterlockedDecrement( (LONG*) &m_RefCount ); 
+    // release our writes to the object, and acquire everyone else's before we delete it
+    i32 result = Helium::AtomicDecrement( &m_RefCount, MemoryOrders::AcquireRelease );
 
     if (result == 0)
     {
@@ -0,0 +1,295 @@
+#include "Chunker.h"
+
+#include "Foundation/Checksum/MD5.h"
+#include "Foundation/Log.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+using namespace Helium;
+
+// the gear hash shifts a byte's contribution out after 64 more bytes, so the hash at any point depends only
+//  on the 64 bytes ending there
+#define CHUNKER_WINDOW          64
+
+// below this the lanes cost more to warm up than they save
+#define CHUNKER_LANE_STRIDE     512
+
+//
+// Random values for each byte, generated once with splitmix64 and fixed forever since they decide where
+//  every stored chunk was cut
+//
+
+static const u64 s_Gear[ 256 ] =
+{
+    0x1D1876CEABE58A29ULL, 0xBD69E6DE97329694ULL, 0xE73EB67509295D5AULL, 0x55E9E6E20A251083ULL,
+    0x9C3EFDD8E0FF0911ULL, 0x61F72CF724410E6AULL, 0x302791800AEFE84AULL, 0x15CEE0CAA2C81881ULL,
+    0xCFB730D4A9EE7C12ULL, 0xE4C4AA6888E5F502ULL, 0xF435CBFADC119E05ULL, 0x3120E508D90DEE11ULL,
+    0x7D24E074390D2D4AULL, 0xAD0D6E22859C99FCULL, 0x138F1EE8929CE10DULL, 0xFD9EF079851AE2ADULL,
+    0xF943393C4FE87651ULL, 0xE55222FE74BFEFAFULL, 0x6F970FACD04CD6BDULL, 0x613CB7B19E55D7EDULL,
+    0xB19D65E460E68082ULL, 0x2E640A73E5B644F3ULL, 0x0AB5A13ABFDA981DULL, 0xD693090B7D168635ULL,
+    0xC8C35BF18234112AULL, 0xB798A199A5C7DBB0ULL, 0x79ABD0DF6D9C3D88ULL, 0x22482AE39FB8E46EULL,
+    0xB54F43D52BF364D7ULL, 0x6CA42EBA21021519ULL, 0x9D2EEC7A73A65480ULL, 0x2F8D68583834C6AAULL,
+    0xFBC0D9059D62C4E3ULL, 0x3358D513DDF1D378ULL, 0xA19AD9A328E35D9AULL, 0x385358B19253E654ULL,
+    0x9A48E24267C056CCULL, 0x400991C66CE0198EULL, 0xBD3A43C94E9936B1ULL, 0x17FF665F92AE244DULL,
+    0x106FC9A48F87D1B9ULL, 0x19CF58C9D650F605ULL, 0x3D06394E163CCC72ULL, 0x054B5668950797C8ULL,
+    0x1068AD57D73E7491ULL, 0x63704A519DA1C6A8ULL, 0xC87537B5DEF86036ULL, 0x38A82A6EB364AECAULL,
+    0xD8364AE51E038FA4ULL, 0xB882157C11EEA345ULL, 0x7F56D1445C003A73ULL, 0xBA4EA33E12ACBEF5ULL,
+    0xEAEE274C824C76F9ULL, 0x0413F5D2D1C6FB9AULL, 0x93674958163D8261ULL, 0x78BF4F2324287A5FULL,
+    0xB8FAB24181756C31ULL, 0xD357B164F73D233BULL, 0x4FCD7A893109C20AULL, 0x629EF0903285AF7BULL,
+    0xAB116D5BBB11BB72ULL, 0xDAE5533A1074120DULL, 0x67F920CB7504F5C0ULL, 0x7726159BBC3D0E6BULL,
+    0xC83833377EA8FB14ULL, 0xDBC47D24C707B520ULL, 0x0B4F5E825F03A3B3ULL, 0xEDDB871BFDF7BCFEULL,
+    0xAE585406455DB6E0ULL, 0xBA93DF62B3E4583AULL, 0xA9C99568F2B67380ULL, 0xACE8E1239DC3EF21ULL,
+    0x8ED926651FC6C248ULL, 0x246B1578E17C65C3ULL, 0x85CF8716884BEB97ULL, 0xBCE841EEA95976E2ULL,
+    0x4B5BDF042B56723EULL, 0xAF58CEF55D4F9EABULL, 0xB34A87E5C5360439ULL, 0xC3175F9B651EB90AULL,
+    0xAC26F4F0B988B445ULL, 0xB425618B32A3DB0BULL, 0x1EB2AC4CCF16EE9DULL, 0x7107589ED8BAD862ULL,
+    0x460D27D92D151DD7ULL, 0xEDCBDD0A2325BFB8ULL, 0xD7F66C851C6E840CULL, 0x9E5419788A4B426BULL,
+    0x83D56AADE6597284ULL, 0x26F1193D849786A5ULL, 0xFF8C2834445DE9F2ULL, 0xD4B60F823605A2A6ULL,
+    0x7270FFF68E112878ULL, 0xAC5084E8704E1BDFULL, 0x416D08FD0875E26BULL, 0xA46E29B9048CED32ULL,
+    0x63651D0BBC44ADF0ULL, 0x830E2C1A772C3CF6ULL, 0x998E656E17111472ULL, 0xBB0EA65AA3D75F35ULL,
+    0x9A8A8ED93E8F63A2ULL, 0x3B43BC3AEFC18F99ULL, 0x846CDA6A740835DCULL, 0xB18A52D5A1C6A25BULL,
+    0x9FB740284E60B469ULL, 0xC4CC4F73EE056E66ULL, 0x7D48DB90DF6B109DULL, 0x445035A7CAB1420CULL,
+    0x0442E570140438ABULL, 0x844ABB9D3170AD93ULL, 0xBB398DB378640559ULL, 0x1F10908A07A493CEULL,
+    0x090CD9FC7B06388CULL, 0x5ADA4BDEBCAE6E4EULL, 0x68A2E2E4494C1C55ULL, 0x0EB4782ED350AB57ULL,
+    0xF8DA43E3C7D5AC2EULL, 0x805E2F7122E088BFULL, 0xC2482571E5F8D6A4ULL, 0x5B65A1404E5E4E76ULL,
+    0x24A839CBCB33B5DFULL, 0xF579E5DB2D70BF5CULL, 0x4BD2163662B663A7ULL, 0x12946FF1FBCF7F15ULL,
+    0xE11839DA0A8BF049ULL, 0x948134110803F02BULL, 0xEE2D3003476DCF0EULL, 0xE3AC62F715533F47ULL,
+    0x8DCC733F4F8CBB31ULL, 0xB930C60450F2922FULL, 0x78896F41762AF247ULL, 0x9C40A455EE75C4DCULL,
+    0x767EF7F7DFEC8845ULL, 0x7864E944C1E9E156ULL, 0x7C4CE4AE3D96A262ULL, 0xB9BBAE621C889704ULL,
+    0xC1233C6CF73D7F4CULL, 0xEAC9D4D1460905F6ULL, 0x3C7964E1D89EB861ULL, 0x165272DC317D1F3AULL,
+    0x83068E91FE2EE9C5ULL, 0xB0E60F93B90B8A95ULL, 0x9DC3F60B1DA45863ULL, 0x40C7B302D15DE179ULL,
+    0x23629CEBD8AC8A01ULL, 0xEE4986A738A62BF9ULL, 0x1AE899206BB78E57ULL, 0x68E58B9FBCD321ACULL,
+    0x94E3AA8A082ADDC3ULL, 0x1A2264489ED8753FULL, 0xAE06D008B820E4A2ULL, 0x318D581E1935B19DULL,
+    0xA5CD0A78032B12FBULL, 0xAA203C70C03B202BULL, 0xB69E84565B583FECULL, 0xB4AFA5214CD5780FULL,
+    0x17648F2B6558DB4AULL, 0xF156D58C17B65601ULL, 0x2CE1CF4D54B0172CULL, 0xA1B4B3FE21A86355ULL,
+    0xE92D17FDC8A529F5ULL, 0x3F9C1A29BB60A094ULL, 0x8EF11B536277F044ULL, 0x8C0A670375301451ULL,
+    0xBAE9E8896CC09F4FULL, 0x611300EB645932EBULL, 0x63FDD1D205CDBA3CULL, 0x59B84631F69C1C59ULL,
+    0xE9F4A10E0D204FAFULL, 0x8C8D930535A206D1ULL, 0xACBD573C7C0D90B8ULL, 0xB03C1FCAB5226CC4ULL,
+    0xFD51A71AE31A05FAULL, 0x7E0A91697A79875AULL, 0x5061FBD0B82DE8CCULL, 0x5459F1E0FEFF7880ULL,
+    0xC7366BFBE2E7CA17ULL, 0x30981AAA5079C277ULL, 0x87284FCBFA7588CEULL, 0xB2F9684FC966E6FBULL,
+    0x7E9DBA2B7B362BFBULL, 0x7BC9CA89BB6672A3ULL, 0x0E898D342DE147C9ULL, 0x624AF7F337A3FD19ULL,
+    0xC22186B6E0E0742EULL, 0x3CFEA27D662012CFULL, 0xEF009FE7F4BE7C55ULL, 0x1FD75CE7D3BE534DULL,
+    0xFB65FF13235D435CULL, 0x9A9E1A51CD02AF50ULL, 0x516A8C0E726C34C4ULL, 0xA3902825159D97EFULL,
+    0x730DE5B6D4FCFE00ULL, 0xC3347193F4C89142ULL, 0x75D5446A71292944ULL, 0x17E404D81F872529ULL,
+    0xCCFC0D526D2D94B1ULL, 0xAE64EAD93AAE187CULL, 0x6FA0EF378DCC119FULL, 0xC279E73188AD8752ULL,
+    0x05371FE0AC6BC13AULL, 0xD2CC82B5D11F4B23ULL, 0x43E44C019E88174FULL, 0x0FE58CB56D6CD566ULL,
+    0xF6879D470101025EULL, 0x26E6C231BFE3144EULL, 0x0802C8CF10882692ULL, 0x63FF389BFC924169ULL,
+    0xEC33FB7529EE37C1ULL, 0x2C9BD12EE0047038ULL, 0x8365E7FC207B7F1BULL, 0xBB7B499FA20EA3FAULL,
+    0xA2A67B856B4328F6ULL, 0xFF55A2676D13D2D4ULL, 0xADD8A79D62A023D4ULL, 0x14F2D2D4D3FE870CULL,
+    0x1DC542480E7EF6CDULL, 0xAB198D4BC533433EULL, 0xCC37FE760D9958B1ULL, 0x7A13E3E26D5F0EE0ULL,
+    0x27F27406F71EF3FEULL, 0xA0D89DC661A1DF04ULL, 0xDA956CC6997A49C1ULL, 0xC75B7FBACD18C208ULL,
+    0x70F06D95D92CAD94ULL, 0x8A1D76FB80E485F9ULL, 0x91A4CD620A114CD3ULL, 0xD36F4CC5AA656ADDULL,
+    0x72F549F10E92ABDDULL, 0xE3628DAECAE6F08DULL, 0x1AB2DA5874ED3FFDULL, 0x165DF82863353C7AULL,
+    0x93682E08A77CCE3BULL, 0x2D1FB686EC199BE8ULL, 0x6521A59B461C9123ULL, 0x7A9D6F208C1BB2FAULL,
+    0x2B503E367D99C072ULL, 0x40419D7394C1C823ULL, 0x2C2A1AAFFDCF97AFULL, 0xD49205CAF40BE85DULL,
+    0x0E6512C90259D111ULL, 0x9C1803819DC904F6ULL, 0xC6FA52BDA7426B3FULL, 0x47BFBA4297B6864DULL,
+    0x561A764D14259B1DULL, 0x3D12F4A5D5FE62F5ULL, 0x9DAB6DEA037E0517ULL, 0x416671DF50F11D11ULL,
+    0x556BD6850E49BEE1ULL, 0xD83005ADBB74D0C8ULL, 0xC4AB5C2875E1CFBDULL, 0xECC45E150795CB64ULL,
+    0x2D9C966ACEEC7526ULL, 0x71ECCF13585D10C9ULL, 0xECE6252C33B6F6D9ULL, 0x5CA386E496A8E41AULL,
+};
+
+// the first position in [begin, end) where the hash of the window ending there has no mask bits set, or end
+static size_t ScanSerial( const u8* data, size_t begin, size_t end, u64 mask )
+{
+    u64 hash = 0;
+    for ( size_t i = begin - ( CHUNKER_WINDOW - 1 ); i < begin; ++i )
+    {
+        hash = ( hash << 1 ) + s_Gear[ data[ i ] ];
+    }
+
+    for ( size_t i = begin; i < end; ++i )
+    {
+        hash = ( hash << 1 ) + s_Gear[ data[ i ] ];
+        if ( !( hash & mask ) )
+        {
+            return i;
+        }
+    }
+
+    return end;
+}
+
+//
+// Each hash step depends on the one before it, so a single scan runs at the latency of a load, shift and add
+//  per byte.  Since the hash only sees the last 64 bytes, we can instead hash four neighboring stretches
+//  at once, warming each one up on the 63 bytes before it, and get the same answer as the serial scan.
+//
+
+static size_t Scan( const u8* data, size_t begin, size_t end, u64 mask )
+{
+    while ( end - begin >= 4 * CHUNKER_LANE_STRIDE )
+    {
+        const u8* lane0 = data + begin;
+        const u8* lane1 = lane0 + CHUNKER_LANE_STRIDE;
+        const u8* lane2 = lane1 + CHUNKER_LANE_STRIDE;
+        const u8* lane3 = lane2 + CHUNKER_LANE_STRIDE;
+
+        u64 hash0 = 0, hash1 = 0, hash2 = 0, hash3 = 0;
+        for ( int i = -( CHUNKER_WINDOW - 1 ); i < 0; ++i )
+        {
+            hash0 = ( hash0 << 1 ) + s_Gear[ lane0[ i ] ];
+            hash1 = ( hash1 << 1 ) + s_Gear[ lane1[ i ] ];
+            hash2 = ( hash2 << 1 ) + s_Gear[ lane2[ i ] ];
+            hash3 = ( hash3 << 1 ) + s_Gear[ lane3[ i ] ];
+        }
+
+        size_t hit1 = CHUNKER_LANE_STRIDE, hit2 = CHUNKER_LANE_STRIDE, hit3 = CHUNKER_LANE_STRIDE;
+        for ( size_t i = 0; i < CHUNKER_LANE_STRIDE; ++i )
+        {
+            hash0 = ( hash0 << 1 ) + s_Gear[ lane0[ i ] ];
+            hash1 = ( hash1 << 1 ) + s_Gear[ lane1[ i ] ];
+            hash2 = ( hash2 << 1 ) + s_Gear[ lane2[ i ] ];
+            hash3 = ( hash3 << 1 ) + s_Gear[ lane3[ i ] ];
+
+            if ( ( hash0 & mask ) && ( hash1 & mask ) && ( hash2 & mask ) && ( hash3 & mask ) )
+            {
+                continue;
+            }
+
+            // nothing in a later lane can come before a cut in the first one
+            if ( !( hash0 & mask ) )
+            {
+                return begin + i;
+            }
+
+            hit1 = ( !( hash1 & mask ) && hit1 == CHUNKER_LANE_STRIDE ) ? i : hit1;
+            hit2 = ( !( hash2 & mask ) && hit2 == CHUNKER_LANE_STRIDE ) ? i : hit2;
+            hit3 = ( !( hash3 & mask ) && hit3 == CHUNKER_LANE_STRIDE ) ? i : hit3;
+        }
+
+        if ( hit1 < CHUNKER_LANE_STRIDE )
+        {
+            return begin + CHUNKER_LANE_STRIDE + hit1;
+        }
+        if ( hit2 < CHUNKER_LANE_STRIDE )
+        {
+            return begin + 2 * CHUNKER_LANE_STRIDE + hit2;
+        }
+        if ( hit3 < CHUNKER_LANE_STRIDE )
+        {
+            return begin + 3 * CHUNKER_LANE_STRIDE + hit3;
+        }
+
+        begin += 4 * CHUNKER_LANE_STRIDE;
+    }
+
+    return ScanSerial( data, begin, end, mask );
+}
+
+static u64 GetMask( u32 bits )
+{
+    // the high bits have seen the most bytes
+    return bits ? ~0ULL << ( 64 - bits ) : 0;
+}
+
+Chunker::Chunker( u32 minSize, u32 averageSize, u32 maxSize )
+{
+    u32 bits = 0;
+    while ( ( 1U << ( bits + 1 ) ) <= averageSize && bits < 30 )
+    {
+        ++bits;
+    }
+    bits = std::max< u32 >( bits, 8 );
+
+    m_AverageSize = 1U << bits;
+    m_MinSize = std::min( std::max< u32 >( minSize, CHUNKER_WINDOW ), m_AverageSize );
+    m_MaxSize = std::max( maxSize, m_AverageSize );
+
+    // normalization level 2, four times less likely to cut before the average and four times more after
+    m_SmallMask = GetMask( bits + 2 );
+    m_LargeMask = GetMask( bits - 2 );
+}
+
+u32 Chunker::FindBoundary( const u8* data, size_t count ) const
+{
+    if ( count <= m_MinSize )
+    {
+        return (u32)count;
+    }
+
+    size_t end = std::min< size_t >( count, m_MaxSize );
+    size_t normal = std::min< size_t >( m_AverageSize, end );
+
+    // a cut at index i ends the chunk after that byte, and chunks are at least the min size
+    size_t i = Scan( data, m_MinSize - 1, normal - 1, m_SmallMask );
+    if ( i == normal - 1 )
+    {
+        i = Scan( data, normal - 1, end - 1, m_LargeMask );
+    }
+
+    return (u32)( i + 1 );
+}
+
+static void AddChunk( const u8* data, u64 offset, u32 length, V_Chunk& chunks )
+{
+    Chunk chunk;
+    chunk.m_Offset = offset;
+    chunk.m_Length = length;
+    Helium::MD5( data, length, chunk.m_Digest );
+    chunks.push_back( chunk );
+}
+
+void Chunker::ChunkBuffer( const void* data, u64 size, V_Chunk& chunks ) const
+{
+    const u8* bytes = (const u8*)data;
+
+    for ( u64 offset = 0; offset < size; )
+    {
+        u32 length = FindBoundary( bytes + offset, (size_t)std::min< u64 >( size - offset, m_MaxSize ) );
+        AddChunk( bytes + offset, offset, length, chunks );
+        offset += length;
+    }
+}
+
+bool Chunker::ChunkFile( const tstring& file, V_Chunk& chunks ) const
+{
+    FILE* f = _tfopen( file.c_str(), TXT( "rb" ) );
+    if ( !f )
+    {
+        Log::Error( TXT( "Unable to open %s for read\n" ), file.c_str() );
+        return false;
+    }
+
+    std::vector< u8 > buffer ( std::max< size_t >( CHUNKER_BUFFER_SIZE, 2 * m_MaxSize ) );
+    size_t start = 0;
+    size_t end = 0;
+    u64 offset = 0;
+    bool eof = false;
+
+    while ( true )
+    {
+        // a boundary can't be decided until we have the max size in hand, or the rest of the file
+        if ( !eof && end - start < m_MaxSize )
+        {
+            memmove( &buffer[ 0 ], &buffer[ start ], end - start );
+            end -= start;
+            start = 0;
+
+            size_t read = fread( &buffer[ end ], 1, buffer.size() - end, f );
+            eof = ( read == 0 );
+            end += read;
+            continue;
+        }
+
+        if ( start == end )
+        {
+            break;
+        }
+
+        u32 length = FindBoundary( &buffer[ start ], end - start );
+        AddChunk( &buffer[ start ], offset, length, chunks );
+        start += length;
+        offset += length;
+    }
+
+    bool result = ferror( f ) == 0;
+    fclose( f );
+
+    if ( !result )
+    {
+        Log::Error( TXT( "Failed to read %s\n" ), file.c_str() );
+        return false;
+    }
+
+    return true;
+}
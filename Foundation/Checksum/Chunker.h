@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+#include "Platform/Types.h"
+
+#include "Foundation/API.h"
+#include "Foundation/Checksum/Digest.h"
+
+// FastCDC's defaults, the average is rounded to a power of two
+#define CHUNKER_MIN_SIZE        ( 2 * 1024 )
+#define CHUNKER_AVERAGE_SIZE    ( 8 * 1024 )
+#define CHUNKER_MAX_SIZE        ( 64 * 1024 )
+
+// how much of a file is read at once when chunking it
+#define CHUNKER_BUFFER_SIZE     ( 1024 * 1024 )
+
+namespace Helium
+{
+    //
+    // A piece of a file cut where its content says to, so the same data produces the same chunks no matter
+    //  what was inserted or removed ahead of it
+    //
+
+    struct Chunk
+    {
+        u64         m_Offset;
+        u32         m_Length;
+        Digest128   m_Digest;   // MD5 of the chunk, its identity for deduplication
+    };
+
+    typedef std::vector< Chunk > V_Chunk;
+
+    //
+    // Content-defined chunking with a gear hash (FastCDC, Xia et al.), normalized so chunk sizes cluster
+    //  around the average: a harder cut condition before the average and an easier one after it
+    //
+
+    class FOUNDATION_API Chunker
+    {
+    public:
+        Chunker( u32 minSize = CHUNKER_MIN_SIZE, u32 averageSize = CHUNKER_AVERAGE_SIZE, u32 maxSize = CHUNKER_MAX_SIZE );
+
+        u32 GetMinSize() const
+        {
+            return m_MinSize;
+        }
+
+        u32 GetAverageSize() const
+        {
+            return m_AverageSize;
+        }
+
+        u32 GetMaxSize() const
+        {
+            return m_MaxSize;
+        }
+
+        // the length of the chunk at the front of the data, pass at least the max size unless the data ends sooner
+        u32 FindBoundary( const u8* data, size_t count ) const;
+
+        // cut data into chunks, with digests, appending them to the list
+        void ChunkBuffer( const void* data, u64 size, V_Chunk& chunks ) const;
+
+        // cut a file into chunks, with digests, reading it once from front to back
+        bool ChunkFile( const tstring& file, V_Chunk& chunks ) const;
+
+    private:
+        u32 m_MinSize;
+        u32 m_AverageSize;
+        u32 m_MaxSize;
+        u64 m_SmallMask;    // before the average size, more bits must be clear
+        u64 m_LargeMask;    // after it, fewer
+    };
+}
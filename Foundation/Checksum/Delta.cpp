@@ -0,0 +1,702 @@
+#include "Delta.h"
+
+#include "Platform/Exception.h"
+#include "Platform/Path.h"
+
+#include "Foundation/Checksum/MD5.h"
+#include "Foundation/File/Path.h"
+#include "Foundation/Log.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+using namespace Helium;
+
+struct DeltaSignatureHeader
+{
+    u32 m_Magic;
+    u32 m_Version;
+    u32 m_BlockSize;
+    u32 m_EntrySize;
+    u64 m_FileSize;
+    u64 m_Count;
+};
+
+struct DeltaHeader
+{
+    u32 m_Magic;
+    u32 m_Version;
+    u32 m_BlockSize;
+    u32 m_Reserved;
+};
+
+struct DeltaRecord
+{
+    u32 m_Command;
+    u32 m_Length;   // bytes to copy, or literal bytes that follow
+    u64 m_Offset;   // where to copy from in the old file, or the size of the new file for End
+};
+
+static bool SeekFile( FILE* f, u64 offset )
+{
+#ifdef WIN32
+    return _fseeki64( f, (i64)offset, SEEK_SET ) == 0;
+#else
+    return fseeko( f, (off_t)offset, SEEK_SET ) == 0;
+#endif
+}
+
+// whole blocks at a time, so only the last one can come up short
+static size_t GetReadSize( u32 blockSize )
+{
+    return blockSize >= DELTA_BUFFER_SIZE ? blockSize : DELTA_BUFFER_SIZE - DELTA_BUFFER_SIZE % blockSize;
+}
+
+static inline u32 GetTag( u32 weak )
+{
+    return ( weak ^ ( weak >> 16 ) ) & 0xFFFF;
+}
+
+DeltaSignature::DeltaSignature()
+: m_BlockSize( 0 )
+, m_FileSize( 0 )
+{
+
+}
+
+u32 DeltaSignature::GetBlockSize( u64 fileSize )
+{
+    u32 blockSize = (u32)sqrt( (double)fileSize ) & ~7;
+    return std::min< u32 >( std::max< u32 >( blockSize, DELTA_MIN_BLOCK_SIZE ), DELTA_MAX_BLOCK_SIZE );
+}
+
+bool DeltaSignature::Generate( const tstring& file, u32 blockSize )
+{
+    Clear();
+
+    FILE* f = _tfopen( file.c_str(), TXT( "rb" ) );
+    if ( !f )
+    {
+        Log::Error( TXT( "Unable to open %s for read\n" ), file.c_str() );
+        return false;
+    }
+
+    Begin( Helium::Path( file ).Size(), blockSize );
+
+    std::vector< u8 > buffer ( GetReadSize( m_BlockSize ) );
+
+    u64 size = 0;
+    while ( true )
+    {
+        size_t read = fread( &buffer[ 0 ], 1, buffer.size(), f );
+        if ( read == 0 )
+        {
+            break;
+        }
+
+        Append( &buffer[ 0 ], (u32)read );
+        size += read;
+    }
+
+    bool result = ferror( f ) == 0;
+    fclose( f );
+
+    if ( !result )
+    {
+        Log::Error( TXT( "Failed to read %s\n" ), file.c_str() );
+        Clear();
+        return false;
+    }
+
+    // the size we stat'd only picked the block size, what we read is what the signature describes
+    m_FileSize = size;
+    Index();
+
+    return true;
+}
+
+void DeltaSignature::GenerateFromBuffer( const void* data, u64 size, u32 blockSize )
+{
+    Clear();
+    Begin( size, blockSize );
+
+    const u8* bytes = (const u8*)data;
+    const size_t readSize = GetReadSize( m_BlockSize );
+    for ( u64 offset = 0; offset < size; offset += readSize )
+    {
+        Append( bytes + offset, (u32)std::min< u64 >( size - offset, readSize ) );
+    }
+
+    m_FileSize = size;
+    Index();
+}
+
+bool DeltaSignature::Load( const tstring& file )
+{
+    Clear();
+
+    FILE* f = _tfopen( file.c_str(), TXT( "rb" ) );
+    if ( !f )
+    {
+        Log::Error( TXT( "Unable to open %s for read\n" ), file.c_str() );
+        return false;
+    }
+
+    DeltaSignatureHeader header;
+    bool result = fread( &header, sizeof( header ), 1, f ) == 1
+        && header.m_Magic == DELTA_SIGNATURE_MAGIC
+        && header.m_Version == DELTA_VERSION
+        && header.m_EntrySize == sizeof( DeltaBlock )
+        && header.m_BlockSize != 0
+        && header.m_Count == ( header.m_FileSize + header.m_BlockSize - 1 ) / header.m_BlockSize;
+
+    // a corrupt count must not size the allocation, the blocks have to actually be in the file
+    i64 available = Helium::Path( file ).Size() - (i64)sizeof( header );
+    result = result && available >= 0 && header.m_Count <= (u64)available / sizeof( DeltaBlock );
+
+    if ( result )
+    {
+        m_BlockSize = header.m_BlockSize;
+        m_FileSize = header.m_FileSize;
+        m_Blocks.resize( (size_t)header.m_Count );
+        result = header.m_Count == 0 || fread( &m_Blocks[ 0 ], sizeof( DeltaBlock ), m_Blocks.size(), f ) == m_Blocks.size();
+    }
+
+    fclose( f );
+
+    if ( !result )
+    {
+        Log::Error( TXT( "Failed to read delta signature %s\n" ), file.c_str() );
+        Clear();
+        return false;
+    }
+
+    Index();
+
+    return true;
+}
+
+bool DeltaSignature::Save( const tstring& file ) const
+{
+    FILE* f = _tfopen( file.c_str(), TXT( "wb" ) );
+    if ( !f )
+    {
+        Log::Error( TXT( "Unable to open %s for write\n" ), file.c_str() );
+        return false;
+    }
+
+    DeltaSignatureHeader header;
+    header.m_Magic = DELTA_SIGNATURE_MAGIC;
+    header.m_Version = DELTA_VERSION;
+    header.m_BlockSize = m_BlockSize;
+    header.m_EntrySize = sizeof( DeltaBlock );
+    header.m_FileSize = m_FileSize;
+    header.m_Count = m_Blocks.size();
+
+    bool result = fwrite( &header, sizeof( header ), 1, f ) == 1
+        && ( m_Blocks.empty() || fwrite( &m_Blocks[ 0 ], sizeof( DeltaBlock ), m_Blocks.size(), f ) == m_Blocks.size() );
+
+    result = ( fclose( f ) == 0 ) && result;
+
+    if ( !result )
+    {
+        Log::Error( TXT( "Failed to write delta signature %s\n" ), file.c_str() );
+        return false;
+    }
+
+    return true;
+}
+
+void DeltaSignature::Clear()
+{
+    m_BlockSize = 0;
+    m_FileSize = 0;
+    m_Blocks.clear();
+    m_Index.clear();
+    m_Tags.clear();
+}
+
+u32 DeltaSignature::GetBlockLength( u32 block ) const
+{
+    u64 offset = (u64)block * m_BlockSize;
+    return (u32)std::min< u64 >( m_BlockSize, m_FileSize - offset );
+}
+
+i32 DeltaSignature::Find( u32 weak, const u8* data, u32 count, u32 hint ) const
+{
+    u32 tag = GetTag( weak );
+    if ( m_Tags.empty() || !( m_Tags[ tag >> 5 ] & ( 1U << ( tag & 31 ) ) ) )
+    {
+        return -1;
+    }
+
+    bool hashed = false;
+    Digest128 strong;
+
+    // the block after the last match is the most likely one, and keeps the copies contiguous
+    if ( hint < m_Blocks.size() && m_Blocks[ hint ].m_Weak == weak && GetBlockLength( hint ) == count )
+    {
+        Helium::MD5( data, count, strong );
+        hashed = true;
+
+        if ( m_Blocks[ hint ].m_Strong == strong )
+        {
+            return (i32)hint;
+        }
+    }
+
+    std::vector< u32 >::const_iterator itr = m_Index.begin();
+    std::vector< u32 >::const_iterator end = m_Index.end();
+
+    // lower bound on the weak checksum of the block each index entry refers to
+    size_t length = end - itr;
+    while ( length > 0 )
+    {
+        size_t half = length / 2;
+        if ( m_Blocks[ itr[ half ] ].m_Weak < weak )
+        {
+            itr += half + 1;
+            length -= half + 1;
+        }
+        else
+        {
+            length = half;
+        }
+    }
+
+    for ( ; itr != end && m_Blocks[ *itr ].m_Weak == weak; ++itr )
+    {
+        if ( *itr == hint || GetBlockLength( *itr ) != count )
+        {
+            continue;
+        }
+
+        if ( !hashed )
+        {
+            Helium::MD5( data, count, strong );
+            hashed = true;
+        }
+
+        if ( m_Blocks[ *itr ].m_Strong == strong )
+        {
+            return (i32)*itr;
+        }
+    }
+
+    return -1;
+}
+
+void DeltaSignature::Begin( u64 size, u32 blockSize )
+{
+    m_BlockSize = blockSize ? blockSize : GetBlockSize( size );
+    m_Blocks.reserve( (size_t)( ( size + m_BlockSize - 1 ) / m_BlockSize ) );
+}
+
+void DeltaSignature::Append( const u8* data, u32 count )
+{
+    for ( u32 offset = 0; offset < count; offset += m_BlockSize )
+    {
+        u32 length = std::min( m_BlockSize, count - offset );
+
+        DeltaBlock block;
+        block.m_Weak = RollingChecksum( data + offset, length ).Get();
+        Helium::MD5( data + offset, length, block.m_Strong );
+        m_Blocks.push_back( block );
+    }
+}
+
+class BlockWeakLess
+{
+public:
+    BlockWeakLess( const V_DeltaBlock& blocks )
+        : m_Blocks( blocks )
+    {
+
+    }
+
+    bool operator()( u32 lhs, u32 rhs ) const
+    {
+        return m_Blocks[ lhs ].m_Weak < m_Blocks[ rhs ].m_Weak;
+    }
+
+private:
+    const V_DeltaBlock& m_Blocks;
+};
+
+void DeltaSignature::Index()
+{
+    m_Index.resize( m_Blocks.size() );
+    m_Tags.assign( 65536 / 32, 0 );
+
+    for ( u32 i = 0; i < m_Blocks.size(); ++i )
+    {
+        m_Index[ i ] = i;
+
+        u32 tag = GetTag( m_Blocks[ i ].m_Weak );
+        m_Tags[ tag >> 5 ] |= 1U << ( tag & 31 );
+    }
+
+    // stable, so repeated blocks are tried in file order
+    std::stable_sort( m_Index.begin(), m_Index.end(), BlockWeakLess( m_Blocks ) );
+}
+
+//
+// Writes delta records, merging copies of consecutive blocks into one
+//
+
+class DeltaWriter
+{
+public:
+    DeltaWriter( FILE* file, DeltaStats& stats )
+        : m_File( file )
+        , m_Stats( stats )
+        , m_Failed( false )
+    {
+        m_Copy.m_Command = DeltaCommands::Copy;
+        m_Copy.m_Length = 0;
+        m_Copy.m_Offset = 0;
+    }
+
+    void Begin( u32 blockSize )
+    {
+        DeltaHeader header;
+        header.m_Magic = DELTA_MAGIC;
+        header.m_Version = DELTA_VERSION;
+        header.m_BlockSize = blockSize;
+        header.m_Reserved = 0;
+        Write( &header, sizeof( header ) );
+    }
+
+    void Copy( u64 offset, u32 length )
+    {
+        if ( m_Copy.m_Length && m_Copy.m_Offset + m_Copy.m_Length == offset && m_Copy.m_Length <= 0xffffffff - length )
+        {
+            m_Copy.m_Length += length;
+            return;
+        }
+
+        FlushCopy();
+
+        m_Copy.m_Offset = offset;
+        m_Copy.m_Length = length;
+    }
+
+    void Literal( const u8* data, size_t length )
+    {
+        if ( !length )
+        {
+            return;
+        }
+
+        FlushCopy();
+
+        DeltaRecord record;
+        record.m_Command = DeltaCommands::Literal;
+        record.m_Length = (u32)length;
+        record.m_Offset = 0;
+        Write( &record, sizeof( record ) );
+        Write( data, length );
+
+        m_Stats.m_LiteralBytes += length;
+        m_Stats.m_Commands++;
+    }
+
+    void End( u64 size, const Digest128& digest )
+    {
+        FlushCopy();
+
+        DeltaRecord record;
+        record.m_Command = DeltaCommands::End;
+        record.m_Length = 0;
+        record.m_Offset = size;
+        Write( &record, sizeof( record ) );
+        Write( digest.m_Bytes, sizeof( digest.m_Bytes ) );
+    }
+
+    bool Failed() const
+    {
+        return m_Failed;
+    }
+
+private:
+    void FlushCopy()
+    {
+        if ( m_Copy.m_Length )
+        {
+            Write( &m_Copy, sizeof( m_Copy ) );
+
+            m_Stats.m_CopiedBytes += m_Copy.m_Length;
+            m_Stats.m_Commands++;
+
+            m_Copy.m_Length = 0;
+        }
+    }
+
+    void Write( const void* data, size_t length )
+    {
+        if ( !m_Failed && fwrite( data, 1, length, m_File ) != length )
+        {
+            m_Failed = true;
+        }
+    }
+
+    FILE*       m_File;
+    DeltaStats& m_Stats;
+    DeltaRecord m_Copy;     // pending, until we know the next block doesn't extend it
+    bool        m_Failed;
+};
+
+bool Helium::ComputeDelta( const DeltaSignature& signature, const tstring& newFile, const tstring& deltaFile, DeltaStats* stats )
+{
+    const u32 blockSize = signature.GetBlockSize();
+    if ( !blockSize )
+    {
+        Log::Error( TXT( "Cannot compute a delta for %s without a signature\n" ), newFile.c_str() );
+        return false;
+    }
+
+    FILE* in = _tfopen( newFile.c_str(), TXT( "rb" ) );
+    if ( !in )
+    {
+        Log::Error( TXT( "Unable to open %s for read\n" ), newFile.c_str() );
+        return false;
+    }
+
+    FILE* out = _tfopen( deltaFile.c_str(), TXT( "wb" ) );
+    if ( !out )
+    {
+        Log::Error( TXT( "Unable to open %s for write\n" ), deltaFile.c_str() );
+        fclose( in );
+        return false;
+    }
+
+    DeltaStats localStats;
+    DeltaWriter writer ( out, stats ? *stats : localStats );
+    writer.Begin( blockSize );
+
+    md5_state_t state;
+    md5_init( &state );
+
+    // the buffer slides along the new file, holding the window being matched and any literal bytes before it
+    std::vector< u8 > buffer ( std::max< size_t >( DELTA_BUFFER_SIZE, 4 * blockSize ) );
+    size_t start = 0;       // the window
+    size_t end = 0;         // the data read so far
+    size_t literal = 0;     // the literal bytes not yet written out
+    u64 size = 0;
+    bool eof = false;
+
+    RollingChecksum weak;
+    bool rolling = false;
+    u32 hint = 0;
+
+    while ( true )
+    {
+        // we need the window and the byte that rolls into it next
+        if ( !eof && end - start < blockSize + 1 )
+        {
+            writer.Literal( &buffer[ literal ], start - literal );
+
+            memmove( &buffer[ 0 ], &buffer[ start ], end - start );
+            end -= start;
+            literal = start = 0;
+
+            size_t read = fread( &buffer[ end ], 1, buffer.size() - end, in );
+            if ( read == 0 )
+            {
+                eof = true;
+            }
+            else
+            {
+                md5_append( &state, &buffer[ end ], (int)read );
+                end += read;
+                size += read;
+            }
+
+            continue;
+        }
+
+        if ( end - start < blockSize )
+        {
+            break;
+        }
+
+        if ( !rolling )
+        {
+            weak.Reset( &buffer[ start ], blockSize );
+            rolling = true;
+        }
+
+        i32 block = signature.Find( weak.Get(), &buffer[ start ], blockSize, hint );
+        if ( block >= 0 )
+        {
+            writer.Literal( &buffer[ literal ], start - literal );
+            writer.Copy( (u64)block * blockSize, blockSize );
+
+            start += blockSize;
+            literal = start;
+            rolling = false;
+            hint = block + 1;
+            continue;
+        }
+
+        if ( end - start > blockSize )
+        {
+            weak.Roll( buffer[ start ], buffer[ start + blockSize ] );
+        }
+        else
+        {
+            rolling = false;
+        }
+
+        ++start;
+    }
+
+    // what is left is shorter than a block, but it can still match a short last block of the old file
+    if ( start < end && !signature.GetBlocks().empty() )
+    {
+        u32 last = (u32)signature.GetBlocks().size() - 1;
+        u32 length = (u32)( end - start );
+        if ( signature.GetBlockLength( last ) == length
+            && signature.Find( RollingChecksum( &buffer[ start ], length ).Get(), &buffer[ start ], length, last ) == (i32)last )
+        {
+            writer.Literal( &buffer[ literal ], start - literal );
+            writer.Copy( (u64)last * blockSize, length );
+            literal = start = end;
+        }
+    }
+
+    writer.Literal( &buffer[ literal ], end - literal );
+
+    Digest128 digest;
+    md5_finish( &state, digest.m_Bytes );
+    writer.End( size, digest );
+
+    bool result = !ferror( in ) && !writer.Failed();
+    fclose( in );
+    result = ( fclose( out ) == 0 ) && result;
+
+    if ( !result )
+    {
+        Log::Error( TXT( "Failed to write delta %s from %s\n" ), deltaFile.c_str(), newFile.c_str() );
+        return false;
+    }
+
+    return true;
+}
+
+bool Helium::ApplyDelta( const tstring& oldFile, const tstring& deltaFile, const tstring& newFile )
+{
+    FILE* delta = _tfopen( deltaFile.c_str(), TXT( "rb" ) );
+    if ( !delta )
+    {
+        Log::Error( TXT( "Unable to open %s for read\n" ), deltaFile.c_str() );
+        return false;
+    }
+
+    DeltaHeader header;
+    if ( fread( &header, sizeof( header ), 1, delta ) != 1 || header.m_Magic != DELTA_MAGIC || header.m_Version != DELTA_VERSION )
+    {
+        Log::Error( TXT( "%s is not a delta\n" ), deltaFile.c_str() );
+        fclose( delta );
+        return false;
+    }
+
+    FILE* old = _tfopen( oldFile.c_str(), TXT( "rb" ) );
+    if ( !old )
+    {
+        Log::Error( TXT( "Unable to open %s for read\n" ), oldFile.c_str() );
+        fclose( delta );
+        return false;
+    }
+
+    tstring temp = newFile + TXT( ".tmp" );
+    FILE* out = _tfopen( temp.c_str(), TXT( "wb" ) );
+    if ( !out )
+    {
+        Log::Error( TXT( "Unable to open %s for write\n" ), temp.c_str() );
+        fclose( old );
+        fclose( delta );
+        return false;
+    }
+
+    md5_state_t state;
+    md5_init( &state );
+
+    std::vector< u8 > buffer ( DELTA_BUFFER_SIZE );
+    u64 size = 0;
+    bool result = false;
+
+    DeltaRecord record;
+    while ( fread( &record, sizeof( record ), 1, delta ) == 1 )
+    {
+        if ( record.m_Command == DeltaCommands::End )
+        {
+            Digest128 expected, actual;
+            md5_finish( &state, actual.m_Bytes );
+
+            result = fread( expected.m_Bytes, sizeof( expected.m_Bytes ), 1, delta ) == 1
+                && record.m_Offset == size
+                && expected == actual;
+            break;
+        }
+
+        FILE* source = NULL;
+        if ( record.m_Command == DeltaCommands::Copy )
+        {
+            source = old;
+            if ( !SeekFile( old, record.m_Offset ) )
+            {
+                break;
+            }
+        }
+        else if ( record.m_Command == DeltaCommands::Literal )
+        {
+            source = delta;
+        }
+        else
+        {
+            break;
+        }
+
+        u32 remaining = record.m_Length;
+        while ( remaining )
+        {
+            size_t length = std::min< size_t >( remaining, buffer.size() );
+            if ( fread( &buffer[ 0 ], 1, length, source ) != length || fwrite( &buffer[ 0 ], 1, length, out ) != length )
+            {
+                break;
+            }
+
+            md5_append( &state, &buffer[ 0 ], (int)length );
+            remaining -= (u32)length;
+            size += length;
+        }
+
+        if ( remaining )
+        {
+            break;
+        }
+    }
+
+    fclose( old );
+    fclose( delta );
+    result = ( fclose( out ) == 0 ) && result;
+
+    if ( !result )
+    {
+        Log::Error( TXT( "Failed to apply delta %s to %s\n" ), deltaFile.c_str(), oldFile.c_str() );
+        Helium::Delete( temp.c_str() );
+        return false;
+    }
+
+    // a crash before here leaves the old file intact, and the replace itself is atomic
+    if ( !Helium::Replace( temp.c_str(), newFile.c_str() ) )
+    {
+        Log::Error( TXT( "Failed to replace %s\n" ), newFile.c_str() );
+        Helium::Delete( temp.c_str() );
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <vector>
+
+#include "Platform/Types.h"
+
+#include "Foundation/API.h"
+#include "Foundation/Checksum/Digest.h"
+
+// identifies signature and delta files, and the layout of their records
+#define DELTA_SIGNATURE_MAGIC   0x47495344 // 'DSIG'
+#define DELTA_MAGIC             0x544C4544 // 'DELT'
+#define DELTA_VERSION           1
+
+// the block size picked for a file is about the square root of its size, within these bounds
+#define DELTA_MIN_BLOCK_SIZE    512
+#define DELTA_MAX_BLOCK_SIZE    ( 64 * 1024 )
+
+// how much of a file is read at once when building signatures and deltas and applying patches
+#define DELTA_BUFFER_SIZE       ( 1024 * 1024 )
+
+namespace Helium
+{
+    //
+    // The rsync weak checksum, an Adler-style pair of sums over a window that can slide along a byte
+    //  at a time without looking at the rest of the window
+    //
+
+    class RollingChecksum
+    {
+    public:
+        RollingChecksum()
+            : m_A( 0 )
+            , m_B( 0 )
+            , m_Count( 0 )
+        {
+
+        }
+
+        RollingChecksum( const u8* data, u32 count )
+        {
+            Reset( data, count );
+        }
+
+        void Reset( const u8* data, u32 count )
+        {
+            m_A = m_B = 0;
+            m_Count = count;
+
+            for ( u32 i = 0; i < count; ++i )
+            {
+                m_A += data[ i ];
+                m_B += m_A;
+            }
+        }
+
+        // slide the window one byte, dropping the byte at its start and taking in the one just past its end
+        void Roll( u8 out, u8 in )
+        {
+            m_A += in - out;
+            m_B += m_A - m_Count * out;
+        }
+
+        u32 Get() const
+        {
+            return ( m_A & 0xFFFF ) | ( m_B << 16 );
+        }
+
+    private:
+        u32 m_A;
+        u32 m_B;
+        u32 m_Count;
+    };
+
+    //
+    // The checksums of one block of the old file
+    //
+
+    struct DeltaBlock
+    {
+        u32         m_Weak;     // RollingChecksum of the block
+        Digest128   m_Strong;   // MD5 of the block, to confirm a weak match
+    };
+
+    typedef std::vector< DeltaBlock > V_DeltaBlock;
+
+    //
+    // The block checksums of the file the receiver already has, which is all the sender needs to work out
+    //  what to send (see http://rsync.samba.org/tech_report/)
+    //
+
+    class FOUNDATION_API DeltaSignature
+    {
+    public:
+        DeltaSignature();
+
+        // about the square root of the size, so the signature and the copy commands stay small
+        static u32 GetBlockSize( u64 fileSize );
+
+        // a block size of 0 picks one from the size of the file
+        bool Generate( const tstring& file, u32 blockSize = 0 );
+        void GenerateFromBuffer( const void* data, u64 size, u32 blockSize = 0 );
+
+        bool Load( const tstring& file );
+        bool Save( const tstring& file ) const;
+
+        void Clear();
+
+        u32 GetBlockSize() const
+        {
+            return m_BlockSize;
+        }
+
+        u64 GetFileSize() const
+        {
+            return m_FileSize;
+        }
+
+        const V_DeltaBlock& GetBlocks() const
+        {
+            return m_Blocks;
+        }
+
+        // the length of a block, the last one can be short
+        u32 GetBlockLength( u32 block ) const;
+
+        // find a block with this weak checksum whose contents match, trying the hinted block first, -1 if none
+        i32 Find( u32 weak, const u8* data, u32 count, u32 hint ) const;
+
+    private:
+        void Begin( u64 size, u32 blockSize );
+        void Append( const u8* data, u32 count );
+        void Index();
+
+        u32                 m_BlockSize;
+        u64                 m_FileSize;
+        V_DeltaBlock        m_Blocks;
+        std::vector< u32 >  m_Index;    // block numbers, sorted by weak checksum
+        std::vector< u32 >  m_Tags;     // bit per 16 bit tag of the weak checksums, to reject most misses with one load
+    };
+
+    namespace DeltaCommands
+    {
+        enum DeltaCommand
+        {
+            Copy,       // take a range from the old file
+            Literal,    // take bytes stored in the delta
+            End,        // followed by the MD5 of the whole new file, so the patch can be verified
+        };
+    }
+    typedef DeltaCommands::DeltaCommand DeltaCommand;
+
+    struct DeltaStats
+    {
+        u64 m_CopiedBytes;
+        u64 m_LiteralBytes;
+        u32 m_Commands;
+
+        DeltaStats()
+            : m_CopiedBytes( 0 )
+            , m_LiteralBytes( 0 )
+            , m_Commands( 0 )
+        {
+
+        }
+    };
+
+    // write the copy and literal commands that turn the file the signature came from into newFile, reading
+    //  newFile once from front to back
+    FOUNDATION_API bool ComputeDelta( const DeltaSignature& signature, const tstring& newFile, const tstring& deltaFile, DeltaStats* stats = NULL );
+
+    // rebuild newFile from oldFile and a delta, streaming the commands in order; newFile is only replaced once
+    //  the result checks out, so it may be oldFile itself
+    FOUNDATION_API bool ApplyDelta( const tstring& oldFile, const tstring& deltaFile, const tstring& newFile );
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <string.h>
+
+#include "Platform/Types.h"
+
+namespace Helium
+{
+    namespace DigestHex
+    {
+        inline tchar Format( u8 nibble )
+        {
+            return (tchar)( nibble < 10 ? TXT( '0' ) + nibble : TXT( 'A' ) + ( nibble - 10 ) );
+        }
+
+        // returns -1 for anything that isn't a hex digit, either case is accepted
+        inline int Parse( tchar c )
+        {
+            if ( c >= TXT( '0' ) && c <= TXT( '9' ) )
+            {
+                return c - TXT( '0' );
+            }
+            if ( c >= TXT( 'A' ) && c <= TXT( 'F' ) )
+            {
+                return c - TXT( 'A' ) + 10;
+            }
+            if ( c >= TXT( 'a' ) && c <= TXT( 'f' ) )
+            {
+                return c - TXT( 'a' ) + 10;
+            }
+            return -1;
+        }
+    }
+
+    //
+    // A 128 bit digest (MD5, XXH3) held by value, it only becomes a string when asked to
+    //
+
+    struct Digest128
+    {
+        u8 m_Bytes[ 16 ];
+
+        Digest128()
+        {
+            memset( m_Bytes, 0, sizeof( m_Bytes ) );
+        }
+
+        explicit Digest128( const u8 bytes[ 16 ] )
+        {
+            memcpy( m_Bytes, bytes, sizeof( m_Bytes ) );
+        }
+
+        bool operator==( const Digest128& rhs ) const
+        {
+            return memcmp( m_Bytes, rhs.m_Bytes, sizeof( m_Bytes ) ) == 0;
+        }
+
+        bool operator!=( const Digest128& rhs ) const
+        {
+            return !( *this == rhs );
+        }
+
+        bool operator<( const Digest128& rhs ) const
+        {
+            return memcmp( m_Bytes, rhs.m_Bytes, sizeof( m_Bytes ) ) < 0;
+        }
+
+        bool IsZero() const
+        {
+            return *this == Digest128();
+        }
+
+        // the bytes are already well mixed, so folding the two halves together makes a fine key
+        u64 Hash() const
+        {
+            u64 low, high;
+            memcpy( &low, m_Bytes, sizeof( low ) );
+            memcpy( &high, m_Bytes + sizeof( low ), sizeof( high ) );
+            return low ^ high;
+        }
+
+        // uppercase hex, the same text the string returning MD5 functions produce
+        void ToString( tchar buffer[ 33 ] ) const
+        {
+            for ( int i = 0; i < 16; ++i )
+            {
+                buffer[ i * 2 ] = DigestHex::Format( m_Bytes[ i ] >> 4 );
+                buffer[ i * 2 + 1 ] = DigestHex::Format( m_Bytes[ i ] & 0xF );
+            }
+            buffer[ 32 ] = TXT( '\0' );
+        }
+
+        tstring ToString() const
+        {
+            tchar buffer[ 33 ];
+            ToString( buffer );
+            return buffer;
+        }
+
+        // parse 32 hex digits, leaves the digest alone if the text isn't one
+        bool FromString( const tchar* str )
+        {
+            u8 bytes[ 16 ];
+            for ( int i = 0; i < 16; ++i )
+            {
+                int high = DigestHex::Parse( str[ i * 2 ] );
+                int low = high < 0 ? -1 : DigestHex::Parse( str[ i * 2 + 1 ] );
+                if ( low < 0 )
+                {
+                    return false;
+                }
+                bytes[ i ] = (u8)( ( high << 4 ) | low );
+            }
+
+            if ( str[ 32 ] != TXT( '\0' ) )
+            {
+                return false;
+            }
+
+            memcpy( m_Bytes, bytes, sizeof( m_Bytes ) );
+            return true;
+        }
+
+        bool FromString( const tstring& str )
+        {
+            return FromString( str.c_str() );
+        }
+    };
+
+    //
+    // A 32 bit digest (CRC32) held by value
+    //
+
+    struct Digest32
+    {
+        u32 m_Value;
+
+        Digest32()
+            : m_Value( 0 )
+        {
+
+        }
+
+        explicit Digest32( u32 value )
+            : m_Value( value )
+        {
+
+        }
+
+        bool operator==( const Digest32& rhs ) const
+        {
+            return m_Value == rhs.m_Value;
+        }
+
+        bool operator!=( const Digest32& rhs ) const
+        {
+            return m_Value != rhs.m_Value;
+        }
+
+        bool operator<( const Digest32& rhs ) const
+        {
+            return m_Value < rhs.m_Value;
+        }
+
+        u64 Hash() const
+        {
+            return m_Value;
+        }
+
+        // uppercase hex without leading zeroes, which is what Path::FileCRC has always handed out
+        void ToString( tchar buffer[ 9 ] ) const
+        {
+            tchar digits[ 8 ];
+            int count = 0;
+            u32 value = m_Value;
+            do
+            {
+                digits[ count++ ] = DigestHex::Format( value & 0xF );
+                value >>= 4;
+            }
+            while ( value );
+
+            for ( int i = 0; i < count; ++i )
+            {
+                buffer[ i ] = digits[ count - i - 1 ];
+            }
+            buffer[ count ] = TXT( '\0' );
+        }
+
+        tstring ToString() const
+        {
+            tchar buffer[ 9 ];
+            ToString( buffer );
+            return buffer;
+        }
+
+        // parse up to 8 hex digits, leaves the digest alone if the text isn't one
+        bool FromString( const tchar* str )
+        {
+            u32 value = 0;
+            int count = 0;
+            for ( ; str[ count ] != TXT( '\0' ); ++count )
+            {
+                int digit = DigestHex::Parse( str[ count ] );
+                if ( digit < 0 || count == 8 )
+                {
+                    return false;
+                }
+                value = ( value << 4 ) | digit;
+            }
+
+            if ( count == 0 )
+            {
+                return false;
+            }
+
+            m_Value = value;
+            return true;
+        }
+
+        bool FromString( const tstring& str )
+        {
+            return FromString( str.c_str() );
+        }
+    };
+
+    // found by stdext::hash_compare, so digests can key a stdext::hash_map
+    inline size_t hash_value( const Digest128& digest )
+    {
+        return (size_t)digest.Hash();
+    }
+
+    inline size_t hash_value( const Digest32& digest )
+    {
+        return (size_t)digest.Hash();
+    }
+}
@@ -0,0 +1,32 @@
+#include "MD5.h"
+
+#include "Platform/Exception.h"
+
+#include "Foundation/File/AsyncFileReader.h"
+
+using namespace Helium;
+
+void Helium::FileMD5(const tstring& filePath, Digest128& digest, u32 packetSize)
+{
+    AsyncFileReader reader ( packetSize ? packetSize : MD5_FILE_PACKET_SIZE );
+    if ( !reader.Open( filePath ) )
+    {
+        throw Helium::Exception( TXT( "Unable to open %s for read" ), filePath.c_str());
+    }
+
+    md5_state_t state;
+    md5_init(&state);
+
+    AsyncReadBuffer buffer;
+    while ( reader.Next( buffer ) )
+    {
+        md5_append(&state, buffer.m_Data, (int)buffer.m_Size);
+    }
+
+    if ( reader.Failed() )
+    {
+        throw Helium::Exception( TXT( "Error reading %s" ), filePath.c_str() );
+    }
+
+    md5_finish(&state, digest.m_Bytes);
+}
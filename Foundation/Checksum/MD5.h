@@ -54,6 +54,12 @@ Purschke <purschke@bnl.gov>.
 
 #include "Platform/Types.h"
 
+#include "Foundation/API.h"
+#include "Foundation/Checksum/Digest.h"
+
+// how much of a file FileMD5 reads at once, several reads are kept going ahead of the hash
+#define MD5_FILE_PACKET_SIZE        ( 1024 * 1024 )
+
 /*
 * This package supports both compile-time and run-time determination of CPU
 * byte order.  If BIG_ENDIAN is defined as 0, the code will be
@@ -490,23 +496,26 @@ inline void md5_finish(md5_state_t *pms, md5_byte_t digest[16])
 
 namespace Helium
 {
-    inline tstring MD5(const void* data, u32 count)
+    inline void MD5(const void* data, u32 count, Digest128& digest)
     {
         md5_state_t state;
         md5_init(&state);
 
         md5_append(&state, (const md5_byte_t *)data, count);
 
-        md5_byte_t digest[16];
-        md5_finish(&state, digest);
+        md5_finish(&state, digest.m_Bytes);
+    }
 
-        tchar hex_output[16*2 + 1];
-        for (int di = 0; di < 16; ++di)
-        {
-            _stprintf(hex_output + di * 2, TXT( "%02X" ), digest[di]);
-        }
+    inline tstring MD5(const void* data, u32 count)
+    {
+        Digest128 digest;
+        MD5(data, count, digest);
+        return digest.ToString();
+    }
 
-        return hex_output;
+    inline void MD5(const tstring& data, Digest128& digest)
+    {
+        MD5( data.data(), (u32)data.length(), digest );
     }
 
     inline tstring MD5(const tstring& data)
@@ -514,40 +523,13 @@ namespace Helium
         return MD5( data.data(), (u32)data.length() );
     }
 
-    inline tstring FileMD5(const tstring& filePath, u32 packetSize = 4096)
-    {
-        FILE* f = _tfopen(filePath.c_str(), TXT( "rb" ) );
-        if (f==0)
-        {
-            throw Helium::Exception( TXT( "Unable to open %s for read" ), filePath.c_str());
-        }
+    // hashes through AsyncFileReader, so the next packets are read while this one is hashed
+    FOUNDATION_API void FileMD5(const tstring& filePath, Digest128& digest, u32 packetSize = MD5_FILE_PACKET_SIZE);
 
-        fseek(f,0,SEEK_END);
-        size_t size = ftell(f);
-        fseek(f,0,SEEK_SET);
-
-        md5_state_t state;
-        md5_init(&state);
-
-        u8* data = new u8[ packetSize ];
-        while ( size )
-        {
-            size_t read = fread(data,1,packetSize,f);
-            md5_append(&state, data, (int)read);
-            size -= read;
-        }
-        fclose(f);
-        delete[] data;
-
-        md5_byte_t digest[16];
-        md5_finish(&state, digest);
-
-        tchar hex_output[16*2 + 1];
-        for (int di = 0; di < 16; ++di)
-        {
-            _stprintf(hex_output + di * 2, TXT( "%02X" ), digest[di]);
-        }
-
-        return hex_output;
+    inline tstring FileMD5(const tstring& filePath, u32 packetSize = MD5_FILE_PACKET_SIZE)
+    {
+        Digest128 digest;
+        FileMD5(filePath, digest, packetSize);
+        return digest.ToString();
     }
 }
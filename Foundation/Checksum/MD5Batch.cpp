@@ -0,0 +1,570 @@
+#include "MD5Batch.h"
+
+#include "Platform/Atomic.h"
+#include "Platform/Compiler.h"
+#include "Platform/Exception.h"
+#include "Platform/Platform.h"
+
+#include "Foundation/Checksum/MD5.h"
+#include "Foundation/Log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined( X86 ) || defined( X64 )
+# define MD5_BATCH_SIMD
+# ifdef _MSC_VER
+#  include <intrin.h>
+#  define MD5_SSE2_TARGET
+#  define MD5_AVX2_TARGET
+#  if _MSC_VER >= 1700
+#   define MD5_BATCH_AVX2
+#  endif
+# else
+#  include <immintrin.h>
+#  define MD5_SSE2_TARGET __attribute__ (( target ( "sse2" ) ))
+#  define MD5_AVX2_TARGET __attribute__ (( target ( "avx2" ) ))
+#  define MD5_BATCH_AVX2
+# endif
+#endif
+
+using namespace Helium;
+
+// the most streams any kernel hashes at once
+#define MD5_BATCH_MAX_LANES     8
+
+#ifdef MD5_BATCH_SIMD
+
+//
+// The RFC 1321 constants, in step order: the sine table, the rotation of each step, and the word of the
+//  block each step takes in
+//
+
+static const u32 s_Sines[ 64 ] =
+{
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const u32 s_Rotations[ 64 ] =
+{
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+static const u8 s_Words[ 64 ] =
+{
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    1, 6, 11, 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12,
+    5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2,
+    0, 7, 14, 5, 12, 3, 10, 1, 8, 15, 6, 13, 4, 11, 2, 9,
+};
+
+// one 64 byte block from each lane into the lanes' state, which is stored word major ( a for every lane, then b, ... )
+typedef void (*MD5Kernel)( u32* state, const u8* const* blocks );
+
+// turn a row of four words from each of four lanes into each word across the four lanes
+static inline void MD5_SSE2_TARGET Transpose( __m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3 )
+{
+    __m128i t0 = _mm_unpacklo_epi32( r0, r1 );
+    __m128i t1 = _mm_unpacklo_epi32( r2, r3 );
+    __m128i t2 = _mm_unpackhi_epi32( r0, r1 );
+    __m128i t3 = _mm_unpackhi_epi32( r2, r3 );
+
+    r0 = _mm_unpacklo_epi64( t0, t1 );
+    r1 = _mm_unpackhi_epi64( t0, t1 );
+    r2 = _mm_unpacklo_epi64( t2, t3 );
+    r3 = _mm_unpackhi_epi64( t2, t3 );
+}
+
+static inline void MD5_SSE2_TARGET LoadWords( const u8* const* blocks, u32 group, __m128i words[ 4 ] )
+{
+    for ( u32 lane = 0; lane < 4; ++lane )
+    {
+        words[ lane ] = _mm_loadu_si128( (const __m128i*)( blocks[ lane ] + 16 * group ) );
+    }
+
+    Transpose( words[ 0 ], words[ 1 ], words[ 2 ], words[ 3 ] );
+}
+
+#define MD5_SSE2_STEP( function, i )                                                                \
+    {                                                                                               \
+        __m128i t = _mm_add_epi32( _mm_add_epi32( a, function ),                                    \
+                                   _mm_add_epi32( x[ s_Words[ i ] ], _mm_set1_epi32( s_Sines[ i ] ) ) ); \
+        __m128i shift = _mm_cvtsi32_si128( s_Rotations[ i ] );                                      \
+        __m128i unshift = _mm_cvtsi32_si128( 32 - s_Rotations[ i ] );                               \
+        t = _mm_or_si128( _mm_sll_epi32( t, shift ), _mm_srl_epi32( t, unshift ) );                 \
+        a = d; d = c; c = b; b = _mm_add_epi32( b, t );                                             \
+    }
+
+static void MD5_SSE2_TARGET MD5Process4( u32* state, const u8* const* blocks )
+{
+    __m128i x[ 16 ];
+    for ( u32 group = 0; group < 4; ++group )
+    {
+        LoadWords( blocks, group, x + 4 * group );
+    }
+
+    __m128i a = _mm_loadu_si128( (const __m128i*)( state + 0 ) );
+    __m128i b = _mm_loadu_si128( (const __m128i*)( state + 4 ) );
+    __m128i c = _mm_loadu_si128( (const __m128i*)( state + 8 ) );
+    __m128i d = _mm_loadu_si128( (const __m128i*)( state + 12 ) );
+    __m128i aa = a, bb = b, cc = c, dd = d;
+    __m128i ones = _mm_set1_epi32( -1 );
+
+    u32 i = 0;
+    for ( ; i < 16; ++i )
+    {
+        MD5_SSE2_STEP( _mm_xor_si128( d, _mm_and_si128( b, _mm_xor_si128( c, d ) ) ), i );   // F
+    }
+    for ( ; i < 32; ++i )
+    {
+        MD5_SSE2_STEP( _mm_xor_si128( c, _mm_and_si128( d, _mm_xor_si128( b, c ) ) ), i );   // G
+    }
+    for ( ; i < 48; ++i )
+    {
+        MD5_SSE2_STEP( _mm_xor_si128( _mm_xor_si128( b, c ), d ), i );                       // H
+    }
+    for ( ; i < 64; ++i )
+    {
+        MD5_SSE2_STEP( _mm_xor_si128( c, _mm_or_si128( b, _mm_xor_si128( d, ones ) ) ), i );  // I
+    }
+
+    _mm_storeu_si128( (__m128i*)( state + 0 ), _mm_add_epi32( a, aa ) );
+    _mm_storeu_si128( (__m128i*)( state + 4 ), _mm_add_epi32( b, bb ) );
+    _mm_storeu_si128( (__m128i*)( state + 8 ), _mm_add_epi32( c, cc ) );
+    _mm_storeu_si128( (__m128i*)( state + 12 ), _mm_add_epi32( d, dd ) );
+}
+
+#ifdef MD5_BATCH_AVX2
+
+#define MD5_AVX2_STEP( function, i )                                                                \
+    {                                                                                               \
+        __m256i t = _mm256_add_epi32( _mm256_add_epi32( a, function ),                              \
+                                      _mm256_add_epi32( x[ s_Words[ i ] ], _mm256_set1_epi32( s_Sines[ i ] ) ) ); \
+        __m128i shift = _mm_cvtsi32_si128( s_Rotations[ i ] );                                      \
+        __m128i unshift = _mm_cvtsi32_si128( 32 - s_Rotations[ i ] );                               \
+        t = _mm256_or_si256( _mm256_sll_epi32( t, shift ), _mm256_srl_epi32( t, unshift ) );        \
+        a = d; d = c; c = b; b = _mm256_add_epi32( b, t );                                          \
+    }
+
+static void MD5_AVX2_TARGET MD5Process8( u32* state, const u8* const* blocks )
+{
+    __m256i x[ 16 ];
+    for ( u32 group = 0; group < 4; ++group )
+    {
+        __m128i low[ 4 ], high[ 4 ];
+        LoadWords( blocks, group, low );
+        LoadWords( blocks + 4, group, high );
+
+        for ( u32 word = 0; word < 4; ++word )
+        {
+            x[ 4 * group + word ] = _mm256_inserti128_si256( _mm256_castsi128_si256( low[ word ] ), high[ word ], 1 );
+        }
+    }
+
+    __m256i a = _mm256_loadu_si256( (const __m256i*)( state + 0 ) );
+    __m256i b = _mm256_loadu_si256( (const __m256i*)( state + 8 ) );
+    __m256i c = _mm256_loadu_si256( (const __m256i*)( state + 16 ) );
+    __m256i d = _mm256_loadu_si256( (const __m256i*)( state + 24 ) );
+    __m256i aa = a, bb = b, cc = c, dd = d;
+    __m256i ones = _mm256_set1_epi32( -1 );
+
+    u32 i = 0;
+    for ( ; i < 16; ++i )
+    {
+        MD5_AVX2_STEP( _mm256_xor_si256( d, _mm256_and_si256( b, _mm256_xor_si256( c, d ) ) ), i );  // F
+    }
+    for ( ; i < 32; ++i )
+    {
+        MD5_AVX2_STEP( _mm256_xor_si256( c, _mm256_and_si256( d, _mm256_xor_si256( b, c ) ) ), i );  // G
+    }
+    for ( ; i < 48; ++i )
+    {
+        MD5_AVX2_STEP( _mm256_xor_si256( _mm256_xor_si256( b, c ), d ), i );                         // H
+    }
+    for ( ; i < 64; ++i )
+    {
+        MD5_AVX2_STEP( _mm256_xor_si256( c, _mm256_or_si256( b, _mm256_xor_si256( d, ones ) ) ), i ); // I
+    }
+
+    _mm256_storeu_si256( (__m256i*)( state + 0 ), _mm256_add_epi32( a, aa ) );
+    _mm256_storeu_si256( (__m256i*)( state + 8 ), _mm256_add_epi32( b, bb ) );
+    _mm256_storeu_si256( (__m256i*)( state + 16 ), _mm256_add_epi32( c, cc ) );
+    _mm256_storeu_si256( (__m256i*)( state + 24 ), _mm256_add_epi32( d, dd ) );
+}
+
+#endif // MD5_BATCH_AVX2
+
+//
+// A stream being hashed in one lane: the whole blocks of its data, then one or two blocks holding the
+//  rest of the data and the padding
+//
+
+struct MD5Lane
+{
+    u32         m_Message;
+    const u8*   m_Data;
+    u64         m_Blocks;
+    u64         m_Block;
+    u32         m_TailBlocks;
+    u8          m_Tail[ 128 ];
+
+    const u8* GetBlock() const
+    {
+        return m_Block < m_Blocks ? m_Data + m_Block * 64 : m_Tail + ( m_Block - m_Blocks ) * 64;
+    }
+
+    bool Done() const
+    {
+        return m_Block == m_Blocks + m_TailBlocks;
+    }
+};
+
+static const u32 s_Initial[ 4 ] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+static void StartLane( MD5Lane& lane, u32* state, u32 width, u32 index, u32 message, const u8* data, u64 size )
+{
+    lane.m_Message = message;
+    lane.m_Data = data;
+    lane.m_Blocks = size / 64;
+    lane.m_Block = 0;
+
+    u32 remainder = (u32)( size % 64 );
+    lane.m_TailBlocks = remainder < 56 ? 1 : 2;
+
+    memset( lane.m_Tail, 0, sizeof( lane.m_Tail ) );
+    memcpy( lane.m_Tail, data + lane.m_Blocks * 64, remainder );
+    lane.m_Tail[ remainder ] = 0x80;
+
+    u64 bits = size * 8;
+    u8* length = lane.m_Tail + lane.m_TailBlocks * 64 - 8;
+    for ( u32 i = 0; i < 8; ++i )
+    {
+        length[ i ] = (u8)( bits >> ( 8 * i ) );
+    }
+
+    for ( u32 word = 0; word < 4; ++word )
+    {
+        state[ word * width + index ] = s_Initial[ word ];
+    }
+}
+
+static void GetLaneDigest( const u32* state, u32 width, u32 index, Digest128& digest )
+{
+    for ( u32 word = 0; word < 4; ++word )
+    {
+        u32 value = state[ word * width + index ];
+        for ( u32 i = 0; i < 4; ++i )
+        {
+            digest.m_Bytes[ word * 4 + i ] = (u8)( value >> ( 8 * i ) );
+        }
+    }
+}
+
+// take the lane's state over to the scalar code and finish the stream there
+static void FinishLane( const MD5Lane& lane, const u32* state, u32 width, u32 index, u64 size, Digest128& digest )
+{
+    md5_state_t scalar;
+    for ( u32 word = 0; word < 4; ++word )
+    {
+        scalar.abcd[ word ] = state[ word * width + index ];
+    }
+
+    u64 bits = lane.m_Block * 64 * 8;
+    scalar.count[ 0 ] = (md5_word_t)bits;
+    scalar.count[ 1 ] = (md5_word_t)( bits >> 32 );
+
+    const u8* data = lane.m_Data + lane.m_Block * 64;
+    u64 remaining = size - lane.m_Block * 64;
+    while ( remaining )
+    {
+        int count = (int)( remaining < 0x40000000 ? remaining : 0x40000000 );
+        md5_append( &scalar, data, count );
+        data += count;
+        remaining -= count;
+    }
+
+    md5_finish( &scalar, digest.m_Bytes );
+}
+
+static void RunLanes( MD5Kernel kernel, u32 width, u32 count, const void* const* data, const u64* sizes, Digest128* digests )
+{
+    static const u8 s_Idle[ 64 ] = { 0 };
+
+    u32 state[ 4 * MD5_BATCH_MAX_LANES ];
+    MD5Lane lanes[ MD5_BATCH_MAX_LANES ];
+    bool busy[ MD5_BATCH_MAX_LANES ];
+
+    u32 next = 0;
+    u32 active = 0;
+    for ( u32 i = 0; i < width; ++i )
+    {
+        busy[ i ] = next < count;
+        if ( busy[ i ] )
+        {
+            StartLane( lanes[ i ], state, width, i, next, (const u8*)data[ next ], sizes[ next ] );
+            ++next;
+            ++active;
+        }
+    }
+
+    while ( active )
+    {
+        // once a long stream is all that's left the other lanes would just be wasted, so go scalar
+        if ( active == 1 && next == count )
+        {
+            for ( u32 i = 0; i < width; ++i )
+            {
+                if ( busy[ i ] && lanes[ i ].m_Block < lanes[ i ].m_Blocks )
+                {
+                    u32 message = lanes[ i ].m_Message;
+                    FinishLane( lanes[ i ], state, width, i, sizes[ message ], digests[ message ] );
+                    busy[ i ] = false;
+                    --active;
+                }
+            }
+
+            if ( !active )
+            {
+                break;
+            }
+        }
+
+        const u8* blocks[ MD5_BATCH_MAX_LANES ];
+        for ( u32 i = 0; i < width; ++i )
+        {
+            blocks[ i ] = busy[ i ] ? lanes[ i ].GetBlock() : s_Idle;
+        }
+
+        kernel( state, blocks );
+
+        for ( u32 i = 0; i < width; ++i )
+        {
+            if ( !busy[ i ] )
+            {
+                continue;
+            }
+
+            MD5Lane& lane = lanes[ i ];
+            lane.m_Block++;
+
+            if ( lane.Done() )
+            {
+                GetLaneDigest( state, width, i, digests[ lane.m_Message ] );
+
+                if ( next < count )
+                {
+                    StartLane( lane, state, width, i, next, (const u8*)data[ next ], sizes[ next ] );
+                    ++next;
+                }
+                else
+                {
+                    busy[ i ] = false;
+                    --active;
+                }
+            }
+        }
+    }
+}
+
+#endif // MD5_BATCH_SIMD
+
+u32 Helium::GetMD5BatchLanes()
+{
+#ifdef MD5_BATCH_SIMD
+    u32 features = Helium::GetProcessorFeatures();
+# ifdef MD5_BATCH_AVX2
+    if ( features & ProcessorFeatures::AVX2 )
+    {
+        return 8;
+    }
+# endif
+    if ( features & ProcessorFeatures::SSE2 )
+    {
+        return 4;
+    }
+#endif
+
+    return 1;
+}
+
+void Helium::MD5Batch( u32 count, const void* const* data, const u64* sizes, Digest128* digests )
+{
+    // picked on first use, racing threads just pick the same thing
+    static volatile i32 s_Lanes = 0;
+    u32 lanes = (u32)AtomicLoad( &s_Lanes, MemoryOrders::Relaxed );
+    if ( !lanes )
+    {
+        lanes = GetMD5BatchLanes();
+        AtomicStore( &s_Lanes, (i32)lanes, MemoryOrders::Relaxed );
+    }
+
+#ifdef MD5_BATCH_SIMD
+    if ( lanes > 1 && count > 1 )
+    {
+        MD5Kernel kernel = &MD5Process4;
+# ifdef MD5_BATCH_AVX2
+        if ( lanes == 8 )
+        {
+            kernel = &MD5Process8;
+        }
+# endif
+
+        RunLanes( kernel, lanes, count, data, sizes, digests );
+        return;
+    }
+#endif
+
+    for ( u32 i = 0; i < count; ++i )
+    {
+        md5_state_t state;
+        md5_init( &state );
+
+        const u8* bytes = (const u8*)data[ i ];
+        for ( u64 remaining = sizes[ i ]; remaining; )
+        {
+            int chunk = (int)( remaining < 0x40000000 ? remaining : 0x40000000 );
+            md5_append( &state, bytes, chunk );
+            bytes += chunk;
+            remaining -= chunk;
+        }
+
+        md5_finish( &state, digests[ i ].m_Bytes );
+    }
+}
+
+//
+// Reads files into one buffer until it is full, then hashes them all together
+//
+
+class FileMD5Batcher
+{
+public:
+    FileMD5Batcher( std::vector< Digest128 >& digests )
+        : m_Digests( digests )
+        , m_Buffer( MD5_BATCH_BUFFER_SIZE )
+        , m_Used( 0 )
+    {
+
+    }
+
+    bool Add( u32 index, const tstring& file )
+    {
+        FILE* f = _tfopen( file.c_str(), TXT( "rb" ) );
+        if ( !f )
+        {
+            Log::Warning( TXT( "Unable to open %s for read\n" ), file.c_str() );
+            return false;
+        }
+
+        fseek( f, 0, SEEK_END );
+        long size = ftell( f );
+        fseek( f, 0, SEEK_SET );
+
+        if ( size < 0 || size > MD5_BATCH_MAX_FILE_SIZE )
+        {
+            fclose( f );
+
+            try
+            {
+                Helium::FileMD5( file, m_Digests[ index ] );
+            }
+            catch ( const Helium::Exception& ex )
+            {
+                Log::Warning( TXT( "%s\n" ), ex.What() );
+                return false;
+            }
+
+            return true;
+        }
+
+        if ( m_Used + size > m_Buffer.size() )
+        {
+            Flush();
+        }
+
+        size_t read = size ? fread( &m_Buffer[ m_Used ], 1, size, f ) : 0;
+        fclose( f );
+
+        if ( read != (size_t)size )
+        {
+            Log::Warning( TXT( "Failed to read %s\n" ), file.c_str() );
+            return false;
+        }
+
+        m_Indices.push_back( index );
+        m_Offsets.push_back( m_Used );
+        m_Sizes.push_back( size );
+        m_Used += size;
+
+        return true;
+    }
+
+    void Flush()
+    {
+        if ( m_Indices.empty() )
+        {
+            return;
+        }
+
+        std::vector< const void* > data ( m_Indices.size() );
+        std::vector< Digest128 > digests ( m_Indices.size() );
+        for ( size_t i = 0; i < m_Indices.size(); ++i )
+        {
+            data[ i ] = &m_Buffer[ 0 ] + m_Offsets[ i ];
+        }
+
+        MD5Batch( (u32)m_Indices.size(), &data[ 0 ], &m_Sizes[ 0 ], &digests[ 0 ] );
+
+        for ( size_t i = 0; i < m_Indices.size(); ++i )
+        {
+            m_Digests[ m_Indices[ i ] ] = digests[ i ];
+        }
+
+        m_Indices.clear();
+        m_Offsets.clear();
+        m_Sizes.clear();
+        m_Used = 0;
+    }
+
+private:
+    std::vector< Digest128 >&   m_Digests;
+    std::vector< u8 >           m_Buffer;
+    size_t                      m_Used;
+    std::vector< u32 >          m_Indices;  // which file each buffered one is
+    std::vector< size_t >       m_Offsets;
+    std::vector< u64 >          m_Sizes;
+};
+
+bool Helium::FileMD5Batch( const std::vector< tstring >& files, std::vector< Digest128 >& digests )
+{
+    digests.assign( files.size(), Digest128() );
+
+    bool result = true;
+
+    FileMD5Batcher batcher ( digests );
+    for ( u32 i = 0; i < files.size(); ++i )
+    {
+        result &= batcher.Add( i, files[ i ] );
+    }
+    batcher.Flush();
+
+    return result;
+}
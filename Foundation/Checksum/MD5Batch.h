@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "Platform/Types.h"
+
+#include "Foundation/API.h"
+#include "Foundation/Checksum/Digest.h"
+
+// files larger than this are streamed through the scalar MD5 rather than read whole into a lane
+#define MD5_BATCH_MAX_FILE_SIZE     ( 1024 * 1024 )
+
+// how much file data FileMD5Batch holds in memory at once
+#define MD5_BATCH_BUFFER_SIZE       ( 8 * 1024 * 1024 )
+
+namespace Helium
+{
+    //
+    // Multi-buffer MD5: a single stream can't go faster than the dependency chain through the rounds, but
+    //  independent streams can share vector registers, 4 at a time with SSE2 and 8 with AVX2.  This pays off
+    //  when there are many small buffers, where per stream overhead rather than bandwidth is the cost.
+    //
+
+    // how many streams the batch hashes side by side on this processor (1 if it can't use vectors)
+    FOUNDATION_API u32 GetMD5BatchLanes();
+
+    // hash count buffers, digests[ i ] gets the MD5 of the sizes[ i ] bytes at data[ i ]
+    FOUNDATION_API void MD5Batch( u32 count, const void* const* data, const u64* sizes, Digest128* digests );
+
+    // hash a list of files, returns false if any couldn't be read (their digests are left zeroed)
+    FOUNDATION_API bool FileMD5Batch( const std::vector< tstring >& files, std::vector< Digest128 >& digests );
+}
@@ -0,0 +1,332 @@
+#include "MD5Tree.h"
+
+#include "Platform/Atomic.h"
+#include "Platform/Exception.h"
+#include "Platform/Mutex.h"
+#include "Platform/Platform.h"
+#include "Platform/Stat.h"
+#include "Platform/Thread.h"
+
+#include "Foundation/Checksum/MD5.h"
+#include "Foundation/Log.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+using namespace Helium;
+
+static bool SeekFile( FILE* f, u64 offset )
+{
+#ifdef WIN32
+    return _fseeki64( f, (i64)offset, SEEK_SET ) == 0;
+#else
+    return fseeko( f, (off_t)offset, SEEK_SET ) == 0;
+#endif
+}
+
+// the MD5 of a range of an open file, read through a buffer of MD5_TREE_READ_SIZE
+static bool HashRange( FILE* f, u64 offset, u64 length, u8* buffer, Digest128& digest )
+{
+    if ( !SeekFile( f, offset ) )
+    {
+        return false;
+    }
+
+    md5_state_t state;
+    md5_init( &state );
+
+    while ( length )
+    {
+        size_t count = (size_t)std::min< u64 >( length, MD5_TREE_READ_SIZE );
+        if ( fread( buffer, 1, count, f ) != count )
+        {
+            return false;
+        }
+
+        md5_append( &state, buffer, (int)count );
+        length -= count;
+    }
+
+    md5_finish( &state, digest.m_Bytes );
+    return true;
+}
+
+static u64 GetLeafLength( u64 fileSize, u32 leafSize, u32 leaf )
+{
+    u64 offset = (u64)leaf * leafSize;
+    return std::min< u64 >( fileSize - offset, leafSize );
+}
+
+//
+// Hands the leaves out in file order to workers that each have their own handle on the file, so reads
+//  stay close together and the device sees as many requests in flight as there are workers
+//
+
+class MD5TreeHasher
+{
+public:
+    struct Worker
+    {
+        MD5TreeHasher*  m_Hasher;
+        Helium::Thread  m_Thread;
+
+        void Run()
+        {
+            m_Hasher->Run();
+        }
+    };
+
+    MD5TreeHasher( const tstring& file, u64 fileSize, u32 leafSize, std::vector< Digest128 >& leaves, const MD5TreeProgressSignature::Delegate& progress )
+        : m_File( file )
+        , m_FileSize( fileSize )
+        , m_LeafSize( leafSize )
+        , m_Leaves( leaves )
+        , m_Progress( progress )
+        , m_NextLeaf( 0 )
+        , m_Failed( 0 )
+        , m_Hashed( 0 )
+    {
+
+    }
+
+    bool Hash( u32 threads )
+    {
+        Worker* workers = new Worker[ threads ];
+
+        // the calling thread is the first worker
+        for ( u32 i = 1; i < threads; ++i )
+        {
+            Worker& worker = workers[ i ];
+            worker.m_Hasher = this;
+            if ( !worker.m_Thread.Create( &Thread::EntryHelper< Worker, &Worker::Run >, &worker, "MD5 Tree", ThreadPriorities::Normal ) )
+            {
+                // carry on with the workers we have, they just take more leaves each
+                Log::Warning( TXT( "Failed to create MD5 tree thread %d\n" ), i );
+            }
+        }
+
+        Run();
+
+        for ( u32 i = 1; i < threads; ++i )
+        {
+            if ( workers[ i ].m_Thread.Valid() )
+            {
+                workers[ i ].m_Thread.Wait();
+                workers[ i ].m_Thread.Close();
+            }
+        }
+
+        delete[] workers;
+
+        return AtomicLoad( &m_Failed ) == 0;
+    }
+
+private:
+    void Run()
+    {
+        FILE* f = _tfopen( m_File.c_str(), TXT( "rb" ) );
+        if ( !f )
+        {
+            Log::Warning( TXT( "Unable to open %s for read\n" ), m_File.c_str() );
+            AtomicStore( &m_Failed, 1 );
+            return;
+        }
+
+        u8* buffer = new u8[ MD5_TREE_READ_SIZE ];
+
+        while ( AtomicLoad( &m_Failed ) == 0 )
+        {
+            u32 leaf = (u32)( AtomicIncrement( &m_NextLeaf ) - 1 );
+            if ( leaf >= m_Leaves.size() )
+            {
+                break;
+            }
+
+            u64 length = GetLeafLength( m_FileSize, m_LeafSize, leaf );
+            if ( !HashRange( f, (u64)leaf * m_LeafSize, length, buffer, m_Leaves[ leaf ] ) )
+            {
+                Log::Warning( TXT( "Failed to read %s\n" ), m_File.c_str() );
+                AtomicStore( &m_Failed, 1 );
+                break;
+            }
+
+            if ( m_Progress.Valid() )
+            {
+                Helium::TakeMutex lock ( m_ProgressLock );
+                m_Hashed += length;
+                m_Progress.Invoke( MD5TreeProgressArgs( m_Hashed, m_FileSize ) );
+            }
+        }
+
+        delete[] buffer;
+        fclose( f );
+    }
+
+    const tstring&                      m_File;
+    u64                                 m_FileSize;
+    u32                                 m_LeafSize;
+    std::vector< Digest128 >&           m_Leaves;
+    MD5TreeProgressSignature::Delegate  m_Progress;
+    Helium::Mutex                       m_ProgressLock;     // guards m_Hashed, and keeps the delegate on one thread at a time
+    volatile i32                        m_NextLeaf;
+    volatile i32                        m_Failed;
+    u64                                 m_Hashed;
+};
+
+MD5Tree::MD5Tree()
+: m_LeafSize( MD5_TREE_LEAF_SIZE )
+, m_FileSize( 0 )
+{
+
+}
+
+void MD5Tree::Clear()
+{
+    m_Root = Digest128();
+    m_LeafSize = MD5_TREE_LEAF_SIZE;
+    m_FileSize = 0;
+    m_Leaves.clear();
+}
+
+bool MD5Tree::Generate( const tstring& file, u32 leafSize, u32 threads, const MD5TreeProgressSignature::Delegate& progress )
+{
+    Clear();
+
+    if ( leafSize == 0 )
+    {
+        Log::Warning( TXT( "Invalid MD5 tree leaf size for %s\n" ), file.c_str() );
+        return false;
+    }
+
+    Helium::Stat stat;
+    if ( !Helium::StatPath( file.c_str(), stat ) )
+    {
+        Log::Warning( TXT( "Unable to open %s for read\n" ), file.c_str() );
+        return false;
+    }
+
+    u64 fileSize = (u64)stat.m_Size;
+    u64 leafCount = ( fileSize + leafSize - 1 ) / leafSize;
+    if ( leafCount > 0x7FFFFFFF )
+    {
+        Log::Warning( TXT( "MD5 tree leaf size %d is too small for %s\n" ), leafSize, file.c_str() );
+        return false;
+    }
+
+    std::vector< Digest128 > leaves ( (size_t)leafCount );
+
+    if ( threads == 0 )
+    {
+        threads = Helium::GetProcessorCount();
+    }
+    threads = (u32)std::max< u64 >( std::min< u64 >( threads, leafCount ), 1 );
+
+    MD5TreeHasher hasher ( file, fileSize, leafSize, leaves, progress );
+    if ( !hasher.Hash( threads ) )
+    {
+        return false;
+    }
+
+    m_LeafSize = leafSize;
+    m_FileSize = fileSize;
+    m_Leaves.swap( leaves );
+    GetRoot( m_FileSize, m_LeafSize, m_Leaves, m_Root );
+
+    return true;
+}
+
+bool MD5Tree::Verify( const tstring& file, u64 offset, u64 length, std::vector< u32 >& mismatches ) const
+{
+    Helium::Stat stat;
+    if ( !Helium::StatPath( file.c_str(), stat ) || (u64)stat.m_Size != m_FileSize )
+    {
+        Log::Warning( TXT( "%s is not the file the MD5 tree was made from\n" ), file.c_str() );
+        return false;
+    }
+
+    if ( offset >= m_FileSize || length == 0 )
+    {
+        return true;
+    }
+
+    FILE* f = _tfopen( file.c_str(), TXT( "rb" ) );
+    if ( !f )
+    {
+        Log::Warning( TXT( "Unable to open %s for read\n" ), file.c_str() );
+        return false;
+    }
+
+    u8* buffer = new u8[ MD5_TREE_READ_SIZE ];
+    bool result = true;
+
+    u32 last = GetLeaf( std::min< u64 >( length, m_FileSize - offset ) + offset - 1 );
+    for ( u32 leaf = GetLeaf( offset ); leaf <= last; ++leaf )
+    {
+        Digest128 digest;
+        if ( !HashRange( f, (u64)leaf * m_LeafSize, GetLeafLength( m_FileSize, m_LeafSize, leaf ), buffer, digest ) )
+        {
+            Log::Warning( TXT( "Failed to read %s\n" ), file.c_str() );
+            result = false;
+            break;
+        }
+
+        if ( digest != m_Leaves[ leaf ] )
+        {
+            mismatches.push_back( leaf );
+        }
+    }
+
+    delete[] buffer;
+    fclose( f );
+
+    return result;
+}
+
+bool MD5Tree::VerifyLeaf( u32 leaf, const void* data, u32 size ) const
+{
+    if ( leaf >= m_Leaves.size() || size != GetLeafLength( m_FileSize, m_LeafSize, leaf ) )
+    {
+        return false;
+    }
+
+    Digest128 digest;
+    MD5( data, size, digest );
+
+    return digest == m_Leaves[ leaf ];
+}
+
+void MD5Tree::GetRoot( u64 fileSize, u32 leafSize, const std::vector< Digest128 >& leaves, Digest128& root )
+{
+    // the sizes go in little endian whatever the platform, so roots compare between machines
+    u8 header[ 12 ];
+    for ( u32 i = 0; i < 8; ++i )
+    {
+        header[ i ] = (u8)( fileSize >> ( i * 8 ) );
+    }
+    for ( u32 i = 0; i < 4; ++i )
+    {
+        header[ 8 + i ] = (u8)( leafSize >> ( i * 8 ) );
+    }
+
+    md5_state_t state;
+    md5_init( &state );
+    md5_append( &state, header, sizeof( header ) );
+
+    for ( std::vector< Digest128 >::const_iterator itr = leaves.begin(), end = leaves.end(); itr != end; ++itr )
+    {
+        md5_append( &state, itr->m_Bytes, sizeof( itr->m_Bytes ) );
+    }
+
+    md5_finish( &state, root.m_Bytes );
+}
+
+void Helium::FileMD5Tree( const tstring& filePath, Digest128& root, const MD5TreeProgressSignature::Delegate& progress, u32 leafSize )
+{
+    MD5Tree tree;
+    if ( !tree.Generate( filePath, leafSize, 0, progress ) )
+    {
+        throw Helium::Exception( TXT( "Unable to hash %s" ), filePath.c_str() );
+    }
+
+    root = tree.GetRoot();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+#include "Platform/Types.h"
+
+#include "Foundation/API.h"
+#include "Foundation/Checksum/Digest.h"
+#include "Foundation/Automation/Event.h"
+
+// how much of the file each leaf digest covers, the last leaf may be shorter
+#define MD5_TREE_LEAF_SIZE          ( 4 * 1024 * 1024 )
+
+// how much of a leaf a worker reads at once
+#define MD5_TREE_READ_SIZE          ( 256 * 1024 )
+
+namespace Helium
+{
+    struct FOUNDATION_API MD5TreeProgressArgs
+    {
+        u64 m_Hashed;
+        u64 m_Total;
+
+        MD5TreeProgressArgs( u64 hashed, u64 total )
+            : m_Hashed( hashed )
+            , m_Total( total )
+        {
+        }
+    };
+    typedef Helium::Signature< const MD5TreeProgressArgs& > MD5TreeProgressSignature;
+
+    //
+    // Tree hash of one large file: the file is cut into fixed size leaves which are MD5'd in parallel,
+    //  one leaf per worker at a time, and the root is the MD5 of the file size, the leaf size and the leaf
+    //  digests in order.  The root is not the file's plain MD5, so it only compares with other tree
+    //  roots made with the same leaf size.  The leaf digests are kept so part of a file (a resumed
+    //  transfer, a suspect range) can be checked without hashing all of it again.
+    //
+
+    class FOUNDATION_API MD5Tree
+    {
+    public:
+        MD5Tree();
+
+        void Clear();
+
+        // hash a file on threads workers (0 for one per processor), progress is raised as each leaf is
+        //  done, from whichever thread finished it
+        bool Generate( const tstring& file, u32 leafSize = MD5_TREE_LEAF_SIZE, u32 threads = 0, const MD5TreeProgressSignature::Delegate& progress = MD5TreeProgressSignature::Delegate() );
+
+        const Digest128& GetRoot() const
+        {
+            return m_Root;
+        }
+
+        u32 GetLeafSize() const
+        {
+            return m_LeafSize;
+        }
+
+        u64 GetFileSize() const
+        {
+            return m_FileSize;
+        }
+
+        const std::vector< Digest128 >& GetLeaves() const
+        {
+            return m_Leaves;
+        }
+
+        // the leaf a byte of the file falls in
+        u32 GetLeaf( u64 offset ) const
+        {
+            return (u32)( offset / m_LeafSize );
+        }
+
+        // rehash the leaves overlapping a range of the file, collecting the ones that don't match; false if
+        //  the file couldn't be read or is no longer the size it was
+        bool Verify( const tstring& file, u64 offset, u64 length, std::vector< u32 >& mismatches ) const;
+
+        // check one leaf's worth of data that came from elsewhere
+        bool VerifyLeaf( u32 leaf, const void* data, u32 size ) const;
+
+        // the root over a set of leaf digests, for leaves that were sent rather than hashed here
+        static void GetRoot( u64 fileSize, u32 leafSize, const std::vector< Digest128 >& leaves, Digest128& root );
+
+    private:
+        Digest128                   m_Root;
+        u32                         m_LeafSize;
+        u64                         m_FileSize;
+        std::vector< Digest128 >    m_Leaves;
+    };
+
+    // the tree root of a file's contents, hashed on every processor, throws like FileMD5 if it can't be read
+    FOUNDATION_API void FileMD5Tree( const tstring& filePath, Digest128& root, const MD5TreeProgressSignature::Delegate& progress = MD5TreeProgressSignature::Delegate(), u32 leafSize = MD5_TREE_LEAF_SIZE );
+}
@@ -0,0 +1,823 @@
+#include "XXH3.h"
+
+#include "Platform/Atomic.h"
+#include "Platform/Compiler.h"
+#include "Platform/Exception.h"
+#include "Platform/Platform.h"
+
+#include "Foundation/File/AsyncFileReader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined( X86 ) || defined( X64 )
+# define XXH3_SIMD
+# ifdef _MSC_VER
+#  include <intrin.h>
+#  define XXH3_SSE2_TARGET
+#  define XXH3_AVX2_TARGET
+#  if _MSC_VER >= 1700
+#   define XXH3_AVX2
+#  endif
+# else
+#  include <immintrin.h>
+#  define XXH3_SSE2_TARGET __attribute__ (( target ( "sse2" ) ))
+#  define XXH3_AVX2_TARGET __attribute__ (( target ( "avx2" ) ))
+#  define XXH3_AVX2
+# endif
+#endif
+
+using namespace Helium;
+
+#define XXH3_PRIME32_1          0x9E3779B1U
+#define XXH3_PRIME32_2          0x85EBCA77U
+#define XXH3_PRIME32_3          0xC2B2AE3DU
+
+#define XXH3_PRIME64_1          0x9E3779B185EBCA87ULL
+#define XXH3_PRIME64_2          0xC2B2AE3D27D4EB4FULL
+#define XXH3_PRIME64_3          0x165667B19E3779F9ULL
+#define XXH3_PRIME64_4          0x85EBCA77C2B2AE63ULL
+#define XXH3_PRIME64_5          0x27D4EB2F165667C5ULL
+
+#define XXH3_PRIME_MX1          0x165667919E3779F9ULL
+#define XXH3_PRIME_MX2          0x9FB21C651E98DF25ULL
+
+// long input is cut into 64 byte stripes, each taking in the secret 8 bytes further along than the last,
+//  and the accumulators are scrambled whenever the secret runs out
+#define XXH3_STRIPE_LENGTH      64
+#define XXH3_SECRET_ADVANCE     8
+#define XXH3_STRIPES_PER_BLOCK  ( ( XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH ) / XXH3_SECRET_ADVANCE )
+#define XXH3_BLOCK_LENGTH       ( XXH3_STRIPE_LENGTH * XXH3_STRIPES_PER_BLOCK )
+
+// offsets into the secret for the finishing steps
+#define XXH3_SECRET_MERGE_START 11
+#define XXH3_SECRET_LAST_START  7
+
+// input up to this length is hashed without the accumulators
+#define XXH3_MID_SIZE_MAX       240
+
+//
+// The reference implementation's default secret, any seed is folded into a copy of it
+//
+
+static const u8 s_Secret[ XXH3_SECRET_SIZE ] =
+{
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static const u64 s_InitialAccumulators[ 8 ] =
+{
+    XXH3_PRIME32_3, XXH3_PRIME64_1, XXH3_PRIME64_2, XXH3_PRIME64_3,
+    XXH3_PRIME64_4, XXH3_PRIME32_2, XXH3_PRIME64_5, XXH3_PRIME32_1,
+};
+
+//
+// Little endian loads and stores (we only build for little endian processors), and the arithmetic
+//  everything is built from
+//
+
+static inline u32 Read32( const u8* data )
+{
+    u32 value;
+    memcpy( &value, data, sizeof( value ) );
+    return value;
+}
+
+static inline u64 Read64( const u8* data )
+{
+    u64 value;
+    memcpy( &value, data, sizeof( value ) );
+    return value;
+}
+
+static inline void Write64( u8* data, u64 value )
+{
+    memcpy( data, &value, sizeof( value ) );
+}
+
+static inline u32 Swap32( u32 value )
+{
+    return ( value >> 24 ) | ( ( value >> 8 ) & 0xFF00 ) | ( ( value << 8 ) & 0xFF0000 ) | ( value << 24 );
+}
+
+static inline u64 Swap64( u64 value )
+{
+    return ( (u64)Swap32( (u32)value ) << 32 ) | Swap32( (u32)( value >> 32 ) );
+}
+
+static inline u64 Rotate64( u64 value, u32 bits )
+{
+    return ( value << bits ) | ( value >> ( 64 - bits ) );
+}
+
+// the full 128 bit product, the high half is returned through high
+static inline u64 Multiply128( u64 a, u64 b, u64& high )
+{
+#if defined( _MSC_VER ) && defined( X64 )
+    return _umul128( a, b, &high );
+#elif defined( __GNUC__ ) && defined( __SIZEOF_INT128__ )
+    unsigned __int128 product = (unsigned __int128)a * b;
+    high = (u64)( product >> 64 );
+    return (u64)product;
+#else
+    u64 lowLow = ( a & 0xFFFFFFFF ) * ( b & 0xFFFFFFFF );
+    u64 highLow = ( a >> 32 ) * ( b & 0xFFFFFFFF );
+    u64 lowHigh = ( a & 0xFFFFFFFF ) * ( b >> 32 );
+    u64 highHigh = ( a >> 32 ) * ( b >> 32 );
+
+    u64 cross = ( lowLow >> 32 ) + ( highLow & 0xFFFFFFFF ) + lowHigh;
+    high = ( highLow >> 32 ) + ( cross >> 32 ) + highHigh;
+    return ( cross << 32 ) | ( lowLow & 0xFFFFFFFF );
+#endif
+}
+
+static inline u64 MultiplyFold64( u64 a, u64 b )
+{
+    u64 high;
+    u64 low = Multiply128( a, b, high );
+    return low ^ high;
+}
+
+// the XXH64 finalizer
+static inline u64 Avalanche64( u64 h )
+{
+    h ^= h >> 33;
+    h *= XXH3_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH3_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline u64 Avalanche( u64 h )
+{
+    h ^= h >> 37;
+    h *= XXH3_PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+// a stronger finalizer for 4 to 8 byte keys, which get the fewest multiplies
+static inline u64 StrongAvalanche( u64 h, u64 length )
+{
+    h ^= Rotate64( h, 49 ) ^ Rotate64( h, 24 );
+    h *= XXH3_PRIME_MX2;
+    h ^= ( h >> 35 ) + length;
+    h *= XXH3_PRIME_MX2;
+    h ^= h >> 28;
+    return h;
+}
+
+static inline u64 Mix16( const u8* input, const u8* secret, u64 seed )
+{
+    u64 low = Read64( input ) ^ ( Read64( secret ) + seed );
+    u64 high = Read64( input + 8 ) ^ ( Read64( secret + 8 ) - seed );
+    return MultiplyFold64( low, high );
+}
+
+static inline void Mix32( u64& low, u64& high, const u8* input1, const u8* input2, const u8* secret, u64 seed )
+{
+    low += Mix16( input1, secret, seed );
+    low ^= Read64( input2 ) + Read64( input2 + 8 );
+    high += Mix16( input2, secret + 16, seed );
+    high ^= Read64( input1 ) + Read64( input1 + 8 );
+}
+
+static void InitSecret( u64 seed, u8 secret[ XXH3_SECRET_SIZE ] )
+{
+    for ( u32 i = 0; i < XXH3_SECRET_SIZE; i += 16 )
+    {
+        Write64( secret + i, Read64( s_Secret + i ) + seed );
+        Write64( secret + i + 8, Read64( s_Secret + i + 8 ) - seed );
+    }
+}
+
+// the 128 bit hash, written high half first and each half most significant byte first, like the reference
+static inline void SetDigest( Digest128& digest, u64 low, u64 high )
+{
+    Write64( digest.m_Bytes, Swap64( high ) );
+    Write64( digest.m_Bytes + 8, Swap64( low ) );
+}
+
+//
+// Short input, 0 to 240 bytes, each length range with its own mixing
+//
+
+static u64 Hash64Short( const u8* input, size_t count, u64 seed )
+{
+    const u8* secret = s_Secret;
+    u64 length = count;
+
+    if ( count > 16 )
+    {
+        u64 acc = length * XXH3_PRIME64_1;
+
+        if ( count <= 128 )
+        {
+            if ( count > 32 )
+            {
+                if ( count > 64 )
+                {
+                    if ( count > 96 )
+                    {
+                        acc += Mix16( input + 48, secret + 96, seed );
+                        acc += Mix16( input + count - 64, secret + 112, seed );
+                    }
+                    acc += Mix16( input + 32, secret + 64, seed );
+                    acc += Mix16( input + count - 48, secret + 80, seed );
+                }
+                acc += Mix16( input + 16, secret + 32, seed );
+                acc += Mix16( input + count - 32, secret + 48, seed );
+            }
+            acc += Mix16( input, secret, seed );
+            acc += Mix16( input + count - 16, secret + 16, seed );
+            return Avalanche( acc );
+        }
+
+        u32 rounds = (u32)( count / 16 );
+        u32 i = 0;
+        for ( ; i < 8; ++i )
+        {
+            acc += Mix16( input + 16 * i, secret + 16 * i, seed );
+        }
+        acc = Avalanche( acc );
+        for ( ; i < rounds; ++i )
+        {
+            acc += Mix16( input + 16 * i, secret + 16 * ( i - 8 ) + 3, seed );
+        }
+        acc += Mix16( input + count - 16, secret + 136 - 17, seed );
+        return Avalanche( acc );
+    }
+
+    if ( count > 8 )
+    {
+        u64 flip1 = ( Read64( secret + 24 ) ^ Read64( secret + 32 ) ) + seed;
+        u64 flip2 = ( Read64( secret + 40 ) ^ Read64( secret + 48 ) ) - seed;
+        u64 low = Read64( input ) ^ flip1;
+        u64 high = Read64( input + count - 8 ) ^ flip2;
+        return Avalanche( length + Swap64( low ) + high + MultiplyFold64( low, high ) );
+    }
+
+    if ( count >= 4 )
+    {
+        seed ^= (u64)Swap32( (u32)seed ) << 32;
+        u64 flip = ( Read64( secret + 8 ) ^ Read64( secret + 16 ) ) - seed;
+        u64 combined = Read32( input + count - 4 ) + ( (u64)Read32( input ) << 32 );
+        return StrongAvalanche( combined ^ flip, length );
+    }
+
+    if ( count > 0 )
+    {
+        u32 combined = ( (u32)input[ 0 ] << 16 ) | ( (u32)input[ count >> 1 ] << 24 ) | input[ count - 1 ] | ( (u32)count << 8 );
+        u64 flip = ( Read32( secret ) ^ Read32( secret + 4 ) ) + seed;
+        return Avalanche64( combined ^ flip );
+    }
+
+    return Avalanche64( seed ^ Read64( secret + 56 ) ^ Read64( secret + 64 ) );
+}
+
+static inline void Finish128( u64 low, u64 high, u64 length, u64 seed, Digest128& digest )
+{
+    u64 resultLow = Avalanche( low + high );
+    u64 resultHigh = 0 - Avalanche( low * XXH3_PRIME64_1 + high * XXH3_PRIME64_4 + ( length - seed ) * XXH3_PRIME64_2 );
+    SetDigest( digest, resultLow, resultHigh );
+}
+
+static void Hash128Short( const u8* input, size_t count, u64 seed, Digest128& digest )
+{
+    const u8* secret = s_Secret;
+    u64 length = count;
+
+    if ( count > 16 )
+    {
+        u64 low = length * XXH3_PRIME64_1;
+        u64 high = 0;
+
+        if ( count <= 128 )
+        {
+            if ( count > 32 )
+            {
+                if ( count > 64 )
+                {
+                    if ( count > 96 )
+                    {
+                        Mix32( low, high, input + 48, input + count - 64, secret + 96, seed );
+                    }
+                    Mix32( low, high, input + 32, input + count - 48, secret + 64, seed );
+                }
+                Mix32( low, high, input + 16, input + count - 32, secret + 32, seed );
+            }
+            Mix32( low, high, input, input + count - 16, secret, seed );
+            Finish128( low, high, length, seed, digest );
+            return;
+        }
+
+        u32 rounds = (u32)( count / 32 );
+        u32 i = 0;
+        for ( ; i < 4; ++i )
+        {
+            Mix32( low, high, input + 32 * i, input + 32 * i + 16, secret + 32 * i, seed );
+        }
+        low = Avalanche( low );
+        high = Avalanche( high );
+        for ( ; i < rounds; ++i )
+        {
+            Mix32( low, high, input + 32 * i, input + 32 * i + 16, secret + 32 * ( i - 4 ) + 3, seed );
+        }
+        Mix32( low, high, input + count - 16, input + count - 32, secret + 136 - 17 - 16, 0 - seed );
+        Finish128( low, high, length, seed, digest );
+        return;
+    }
+
+    if ( count > 8 )
+    {
+        u64 flipLow = ( Read64( secret + 32 ) ^ Read64( secret + 40 ) ) - seed;
+        u64 flipHigh = ( Read64( secret + 48 ) ^ Read64( secret + 56 ) ) + seed;
+        u64 inputLow = Read64( input );
+        u64 inputHigh = Read64( input + count - 8 );
+
+        u64 mulHigh;
+        u64 mulLow = Multiply128( inputLow ^ inputHigh ^ flipLow, XXH3_PRIME64_1, mulHigh );
+        mulLow += ( length - 1 ) << 54;
+        inputHigh ^= flipHigh;
+        mulHigh += inputHigh + ( inputHigh & 0xFFFFFFFF ) * ( XXH3_PRIME32_2 - 1 );
+        mulLow ^= Swap64( mulHigh );
+
+        u64 resultHigh;
+        u64 resultLow = Multiply128( mulLow, XXH3_PRIME64_2, resultHigh );
+        resultHigh += mulHigh * XXH3_PRIME64_2;
+        SetDigest( digest, Avalanche( resultLow ), Avalanche( resultHigh ) );
+        return;
+    }
+
+    if ( count >= 4 )
+    {
+        seed ^= (u64)Swap32( (u32)seed ) << 32;
+        u64 combined = Read32( input ) + ( (u64)Read32( input + count - 4 ) << 32 );
+        u64 flip = ( Read64( secret + 16 ) ^ Read64( secret + 24 ) ) + seed;
+
+        u64 high;
+        u64 low = Multiply128( combined ^ flip, XXH3_PRIME64_1 + ( length << 2 ), high );
+        high += low << 1;
+        low ^= high >> 3;
+        low ^= low >> 35;
+        low *= XXH3_PRIME_MX2;
+        low ^= low >> 28;
+        SetDigest( digest, low, Avalanche( high ) );
+        return;
+    }
+
+    if ( count > 0 )
+    {
+        u32 combinedLow = ( (u32)input[ 0 ] << 16 ) | ( (u32)input[ count >> 1 ] << 24 ) | input[ count - 1 ] | ( (u32)count << 8 );
+        u32 swapped = Swap32( combinedLow );
+        u32 combinedHigh = ( swapped << 13 ) | ( swapped >> 19 );
+        u64 flipLow = ( Read32( secret ) ^ Read32( secret + 4 ) ) + seed;
+        u64 flipHigh = ( Read32( secret + 8 ) ^ Read32( secret + 12 ) ) - seed;
+        SetDigest( digest, Avalanche64( combinedLow ^ flipLow ), Avalanche64( combinedHigh ^ flipHigh ) );
+        return;
+    }
+
+    u64 flipLow = Read64( secret + 64 ) ^ Read64( secret + 72 );
+    u64 flipHigh = Read64( secret + 80 ) ^ Read64( secret + 88 );
+    SetDigest( digest, Avalanche64( seed ^ flipLow ), Avalanche64( seed ^ flipHigh ) );
+}
+
+//
+// Long input: every stripe feeds all 8 accumulators, the part worth vectorizing.  Kernels take a run of
+//  stripes so the accumulators can stay in registers across it.
+//
+
+typedef void (*AccumulateKernel)( u64* accumulators, const u8* input, const u8* secret, size_t stripes );
+typedef void (*ScrambleKernel)( u64* accumulators, const u8* secret );
+
+struct XXH3Kernel
+{
+    AccumulateKernel    m_Accumulate;
+    ScrambleKernel      m_Scramble;
+};
+
+static void AccumulateScalar( u64* accumulators, const u8* input, const u8* secret, size_t stripes )
+{
+    for ( size_t s = 0; s < stripes; ++s, input += XXH3_STRIPE_LENGTH, secret += XXH3_SECRET_ADVANCE )
+    {
+        for ( u32 i = 0; i < 8; ++i )
+        {
+            u64 data = Read64( input + 8 * i );
+            u64 key = data ^ Read64( secret + 8 * i );
+            accumulators[ i ^ 1 ] += data;
+            accumulators[ i ] += ( key & 0xFFFFFFFF ) * ( key >> 32 );
+        }
+    }
+}
+
+static void ScrambleScalar( u64* accumulators, const u8* secret )
+{
+    for ( u32 i = 0; i < 8; ++i )
+    {
+        u64 acc = accumulators[ i ];
+        acc ^= acc >> 47;
+        acc ^= Read64( secret + 8 * i );
+        accumulators[ i ] = acc * XXH3_PRIME32_1;
+    }
+}
+
+static const XXH3Kernel s_ScalarKernel = { &AccumulateScalar, &ScrambleScalar };
+
+#ifdef XXH3_SIMD
+
+static void XXH3_SSE2_TARGET AccumulateSSE2( u64* accumulators, const u8* input, const u8* secret, size_t stripes )
+{
+    __m128i acc[ 4 ];
+    for ( u32 i = 0; i < 4; ++i )
+    {
+        acc[ i ] = _mm_loadu_si128( (const __m128i*)accumulators + i );
+    }
+
+    for ( size_t s = 0; s < stripes; ++s, input += XXH3_STRIPE_LENGTH, secret += XXH3_SECRET_ADVANCE )
+    {
+        for ( u32 i = 0; i < 4; ++i )
+        {
+            __m128i data = _mm_loadu_si128( (const __m128i*)input + i );
+            __m128i key = _mm_xor_si128( data, _mm_loadu_si128( (const __m128i*)secret + i ) );
+
+            // the low half of each lane times its high half, plus the neighbouring lane's input
+            __m128i product = _mm_mul_epu32( key, _mm_shuffle_epi32( key, _MM_SHUFFLE( 0, 3, 0, 1 ) ) );
+            __m128i swapped = _mm_shuffle_epi32( data, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+            acc[ i ] = _mm_add_epi64( acc[ i ], _mm_add_epi64( product, swapped ) );
+        }
+    }
+
+    for ( u32 i = 0; i < 4; ++i )
+    {
+        _mm_storeu_si128( (__m128i*)accumulators + i, acc[ i ] );
+    }
+}
+
+static void XXH3_SSE2_TARGET ScrambleSSE2( u64* accumulators, const u8* secret )
+{
+    const __m128i prime = _mm_set1_epi32( (int)XXH3_PRIME32_1 );
+
+    for ( u32 i = 0; i < 4; ++i )
+    {
+        __m128i acc = _mm_loadu_si128( (const __m128i*)accumulators + i );
+        acc = _mm_xor_si128( acc, _mm_srli_epi64( acc, 47 ) );
+        acc = _mm_xor_si128( acc, _mm_loadu_si128( (const __m128i*)secret + i ) );
+
+        // there is no 64 bit multiply, so it's put together from 32 bit halves
+        __m128i low = _mm_mul_epu32( acc, prime );
+        __m128i high = _mm_mul_epu32( _mm_shuffle_epi32( acc, _MM_SHUFFLE( 0, 3, 0, 1 ) ), prime );
+        _mm_storeu_si128( (__m128i*)accumulators + i, _mm_add_epi64( low, _mm_slli_epi64( high, 32 ) ) );
+    }
+}
+
+static const XXH3Kernel s_SSE2Kernel = { &AccumulateSSE2, &ScrambleSSE2 };
+
+#ifdef XXH3_AVX2
+
+static void XXH3_AVX2_TARGET AccumulateAVX2( u64* accumulators, const u8* input, const u8* secret, size_t stripes )
+{
+    __m256i acc0 = _mm256_loadu_si256( (const __m256i*)accumulators );
+    __m256i acc1 = _mm256_loadu_si256( (const __m256i*)accumulators + 1 );
+
+    for ( size_t s = 0; s < stripes; ++s, input += XXH3_STRIPE_LENGTH, secret += XXH3_SECRET_ADVANCE )
+    {
+        __m256i data0 = _mm256_loadu_si256( (const __m256i*)input );
+        __m256i data1 = _mm256_loadu_si256( (const __m256i*)input + 1 );
+        __m256i key0 = _mm256_xor_si256( data0, _mm256_loadu_si256( (const __m256i*)secret ) );
+        __m256i key1 = _mm256_xor_si256( data1, _mm256_loadu_si256( (const __m256i*)secret + 1 ) );
+
+        __m256i product0 = _mm256_mul_epu32( key0, _mm256_srli_epi64( key0, 32 ) );
+        __m256i product1 = _mm256_mul_epu32( key1, _mm256_srli_epi64( key1, 32 ) );
+        __m256i swapped0 = _mm256_shuffle_epi32( data0, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+        __m256i swapped1 = _mm256_shuffle_epi32( data1, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+
+        acc0 = _mm256_add_epi64( acc0, _mm256_add_epi64( product0, swapped0 ) );
+        acc1 = _mm256_add_epi64( acc1, _mm256_add_epi64( product1, swapped1 ) );
+    }
+
+    _mm256_storeu_si256( (__m256i*)accumulators, acc0 );
+    _mm256_storeu_si256( (__m256i*)accumulators + 1, acc1 );
+}
+
+static void XXH3_AVX2_TARGET ScrambleAVX2( u64* accumulators, const u8* secret )
+{
+    const __m256i prime = _mm256_set1_epi32( (int)XXH3_PRIME32_1 );
+
+    for ( u32 i = 0; i < 2; ++i )
+    {
+        __m256i acc = _mm256_loadu_si256( (const __m256i*)accumulators + i );
+        acc = _mm256_xor_si256( acc, _mm256_srli_epi64( acc, 47 ) );
+        acc = _mm256_xor_si256( acc, _mm256_loadu_si256( (const __m256i*)secret + i ) );
+
+        __m256i low = _mm256_mul_epu32( acc, prime );
+        __m256i high = _mm256_mul_epu32( _mm256_srli_epi64( acc, 32 ), prime );
+        _mm256_storeu_si256( (__m256i*)accumulators + i, _mm256_add_epi64( low, _mm256_slli_epi64( high, 32 ) ) );
+    }
+}
+
+static const XXH3Kernel s_AVX2Kernel = { &AccumulateAVX2, &ScrambleAVX2 };
+
+#endif // XXH3_AVX2
+
+#endif // XXH3_SIMD
+
+static const XXH3Kernel* SelectKernel()
+{
+#ifdef XXH3_SIMD
+    u32 features = Helium::GetProcessorFeatures();
+
+# ifdef XXH3_AVX2
+    if ( features & ProcessorFeatures::AVX2 )
+    {
+        return &s_AVX2Kernel;
+    }
+# endif
+
+    if ( features & ProcessorFeatures::SSE2 )
+    {
+        return &s_SSE2Kernel;
+    }
+#endif
+
+    return &s_ScalarKernel;
+}
+
+// picked on first use, racing threads just pick the same thing
+static const XXH3Kernel* volatile s_Kernel = NULL;
+
+static inline const XXH3Kernel* GetKernel()
+{
+    const XXH3Kernel* kernel = AtomicLoad( &s_Kernel, MemoryOrders::Relaxed );
+    if ( !kernel )
+    {
+        kernel = SelectKernel();
+        AtomicStore( &s_Kernel, kernel, MemoryOrders::Relaxed );
+    }
+
+    return kernel;
+}
+
+static void HashLong( u64 accumulators[ 8 ], const u8* input, size_t count, const u8* secret )
+{
+    const XXH3Kernel* kernel = GetKernel();
+
+    memcpy( accumulators, s_InitialAccumulators, sizeof( s_InitialAccumulators ) );
+
+    // the last stripe is always taken from the very end of the input, so one short of whole blocks
+    size_t blocks = ( count - 1 ) / XXH3_BLOCK_LENGTH;
+    for ( size_t b = 0; b < blocks; ++b )
+    {
+        kernel->m_Accumulate( accumulators, input + b * XXH3_BLOCK_LENGTH, secret, XXH3_STRIPES_PER_BLOCK );
+        kernel->m_Scramble( accumulators, secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH );
+    }
+
+    size_t stripes = ( ( count - 1 ) - blocks * XXH3_BLOCK_LENGTH ) / XXH3_STRIPE_LENGTH;
+    kernel->m_Accumulate( accumulators, input + blocks * XXH3_BLOCK_LENGTH, secret, stripes );
+    kernel->m_Accumulate( accumulators, input + count - XXH3_STRIPE_LENGTH, secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH - XXH3_SECRET_LAST_START, 1 );
+}
+
+static u64 MergeAccumulators( const u64 accumulators[ 8 ], const u8* secret, u64 start )
+{
+    u64 result = start;
+    for ( u32 i = 0; i < 4; ++i )
+    {
+        result += MultiplyFold64( accumulators[ 2 * i ] ^ Read64( secret + 16 * i ), accumulators[ 2 * i + 1 ] ^ Read64( secret + 16 * i + 8 ) );
+    }
+
+    return Avalanche( result );
+}
+
+static inline u64 Merge64( const u64 accumulators[ 8 ], const u8* secret, u64 length )
+{
+    return MergeAccumulators( accumulators, secret + XXH3_SECRET_MERGE_START, length * XXH3_PRIME64_1 );
+}
+
+static inline void Merge128( const u64 accumulators[ 8 ], const u8* secret, u64 length, Digest128& digest )
+{
+    u64 low = MergeAccumulators( accumulators, secret + XXH3_SECRET_MERGE_START, length * XXH3_PRIME64_1 );
+    u64 high = MergeAccumulators( accumulators, secret + XXH3_SECRET_SIZE - 64 - XXH3_SECRET_MERGE_START, ~( length * XXH3_PRIME64_2 ) );
+    SetDigest( digest, low, high );
+}
+
+u64 Helium::XXH3_64( const void* data, size_t count, u64 seed )
+{
+    const u8* input = (const u8*)data;
+
+    if ( count <= XXH3_MID_SIZE_MAX )
+    {
+        return Hash64Short( input, count, seed );
+    }
+
+    const u8* secret = s_Secret;
+    u8 seeded[ XXH3_SECRET_SIZE ];
+    if ( seed )
+    {
+        InitSecret( seed, seeded );
+        secret = seeded;
+    }
+
+    u64 accumulators[ 8 ];
+    HashLong( accumulators, input, count, secret );
+    return Merge64( accumulators, secret, count );
+}
+
+void Helium::XXH3_128( const void* data, size_t count, Digest128& digest, u64 seed )
+{
+    const u8* input = (const u8*)data;
+
+    if ( count <= XXH3_MID_SIZE_MAX )
+    {
+        Hash128Short( input, count, seed, digest );
+        return;
+    }
+
+    const u8* secret = s_Secret;
+    u8 seeded[ XXH3_SECRET_SIZE ];
+    if ( seed )
+    {
+        InitSecret( seed, seeded );
+        secret = seeded;
+    }
+
+    u64 accumulators[ 8 ];
+    HashLong( accumulators, input, count, secret );
+    Merge128( accumulators, secret, count, digest );
+}
+
+//
+// Streaming: input is held back until there is more than the buffer's worth, so a stripe is never
+//  accumulated before we know whether it's the last one (which is treated differently)
+//
+
+// accumulate stripes continuing on from stripeCount into the current block, scrambling where the block
+//  ends, returns the stripe count in the block after
+static u32 ConsumeStripes( u64* accumulators, u32 stripeCount, const u8* input, size_t stripes, const u8* secret )
+{
+    const XXH3Kernel* kernel = GetKernel();
+
+    if ( XXH3_STRIPES_PER_BLOCK - stripeCount <= stripes )
+    {
+        size_t toEnd = XXH3_STRIPES_PER_BLOCK - stripeCount;
+        size_t afterEnd = stripes - toEnd;
+        kernel->m_Accumulate( accumulators, input, secret + stripeCount * XXH3_SECRET_ADVANCE, toEnd );
+        kernel->m_Scramble( accumulators, secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH );
+        kernel->m_Accumulate( accumulators, input + toEnd * XXH3_STRIPE_LENGTH, secret, afterEnd );
+        return (u32)afterEnd;
+    }
+
+    kernel->m_Accumulate( accumulators, input, secret + stripeCount * XXH3_SECRET_ADVANCE, stripes );
+    return stripeCount + (u32)stripes;
+}
+
+XXH3State::XXH3State( u64 seed )
+{
+    Reset( seed );
+}
+
+void XXH3State::Reset( u64 seed )
+{
+    memcpy( m_Accumulators, s_InitialAccumulators, sizeof( m_Accumulators ) );
+
+    if ( seed )
+    {
+        InitSecret( seed, m_Secret );
+    }
+    else
+    {
+        memcpy( m_Secret, s_Secret, sizeof( m_Secret ) );
+    }
+
+    m_Seed = seed;
+    m_TotalLength = 0;
+    m_BufferedLength = 0;
+    m_StripeCount = 0;
+}
+
+void XXH3State::Update( const void* data, size_t count )
+{
+    const u8* input = (const u8*)data;
+
+    m_TotalLength += count;
+
+    if ( m_BufferedLength + count <= XXH3_BUFFER_SIZE )
+    {
+        memcpy( m_Buffer + m_BufferedLength, input, count );
+        m_BufferedLength += (u32)count;
+        return;
+    }
+
+    const size_t bufferStripes = XXH3_BUFFER_SIZE / XXH3_STRIPE_LENGTH;
+
+    if ( m_BufferedLength )
+    {
+        size_t fill = XXH3_BUFFER_SIZE - m_BufferedLength;
+        memcpy( m_Buffer + m_BufferedLength, input, fill );
+        input += fill;
+        count -= fill;
+
+        m_StripeCount = ConsumeStripes( m_Accumulators, m_StripeCount, m_Buffer, bufferStripes, m_Secret );
+        m_BufferedLength = 0;
+    }
+
+    // straight from the caller's memory, holding back at least a byte
+    if ( count > XXH3_BUFFER_SIZE )
+    {
+        do
+        {
+            m_StripeCount = ConsumeStripes( m_Accumulators, m_StripeCount, input, bufferStripes, m_Secret );
+            input += XXH3_BUFFER_SIZE;
+            count -= XXH3_BUFFER_SIZE;
+        }
+        while ( count > XXH3_BUFFER_SIZE );
+
+        // the final stripe may need to reach back into this
+        memcpy( m_Buffer + XXH3_BUFFER_SIZE - XXH3_STRIPE_LENGTH, input - XXH3_STRIPE_LENGTH, XXH3_STRIPE_LENGTH );
+    }
+
+    memcpy( m_Buffer, input, count );
+    m_BufferedLength = (u32)count;
+}
+
+void XXH3State::Finish( u64 accumulators[ 8 ] ) const
+{
+    memcpy( accumulators, m_Accumulators, sizeof( m_Accumulators ) );
+
+    const u8* lastSecret = m_Secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH - XXH3_SECRET_LAST_START;
+
+    if ( m_BufferedLength >= XXH3_STRIPE_LENGTH )
+    {
+        size_t stripes = ( m_BufferedLength - 1 ) / XXH3_STRIPE_LENGTH;
+        ConsumeStripes( accumulators, m_StripeCount, m_Buffer, stripes, m_Secret );
+        GetKernel()->m_Accumulate( accumulators, m_Buffer + m_BufferedLength - XXH3_STRIPE_LENGTH, lastSecret, 1 );
+    }
+    else
+    {
+        // the last stripe is the tail of what was already consumed plus what's buffered
+        u8 last[ XXH3_STRIPE_LENGTH ];
+        size_t catchUp = XXH3_STRIPE_LENGTH - m_BufferedLength;
+        memcpy( last, m_Buffer + XXH3_BUFFER_SIZE - catchUp, catchUp );
+        memcpy( last + catchUp, m_Buffer, m_BufferedLength );
+        GetKernel()->m_Accumulate( accumulators, last, lastSecret, 1 );
+    }
+}
+
+u64 XXH3State::Get64() const
+{
+    if ( m_TotalLength <= XXH3_MID_SIZE_MAX )
+    {
+        return Hash64Short( m_Buffer, (size_t)m_TotalLength, m_Seed );
+    }
+
+    u64 accumulators[ 8 ];
+    Finish( accumulators );
+    return Merge64( accumulators, m_Secret, m_TotalLength );
+}
+
+void XXH3State::Get128( Digest128& digest ) const
+{
+    if ( m_TotalLength <= XXH3_MID_SIZE_MAX )
+    {
+        Hash128Short( m_Buffer, (size_t)m_TotalLength, m_Seed, digest );
+        return;
+    }
+
+    u64 accumulators[ 8 ];
+    Finish( accumulators );
+    Merge128( accumulators, m_Secret, m_TotalLength, digest );
+}
+
+void Helium::FileXXH3( const tstring& filePath, Digest128& digest, u32 packetSize )
+{
+    // the next packets are read while this one is hashed
+    AsyncFileReader reader ( packetSize ? packetSize : XXH3_FILE_PACKET_SIZE );
+    if ( !reader.Open( filePath ) )
+    {
+        throw Helium::Exception( TXT( "Unable to open %s for read" ), filePath.c_str() );
+    }
+
+    XXH3State state;
+    AsyncReadBuffer buffer;
+    while ( reader.Next( buffer ) )
+    {
+        state.Update( buffer.m_Data, buffer.m_Size );
+    }
+
+    if ( reader.Failed() )
+    {
+        throw Helium::Exception( TXT( "Error reading %s" ), filePath.c_str() );
+    }
+
+    state.Get128( digest );
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Platform/Types.h"
+
+#include "Foundation/API.h"
+#include "Foundation/Checksum/Digest.h"
+
+// the seed hashes use unless given one, Path::Hash values are saved (see SnapshotIndex) so changing it
+//  means rebuilding anything keyed by them
+#ifndef XXH3_SEED
+# define XXH3_SEED                  0
+#endif
+
+// the key material the hash mixes input with, and how much input the streaming state holds back
+#define XXH3_SECRET_SIZE            192
+#define XXH3_BUFFER_SIZE            256
+
+// how much of a file FileXXH3 reads at once, several reads are kept going ahead of the hash
+#define XXH3_FILE_PACKET_SIZE       ( 1024 * 1024 )
+
+namespace Helium
+{
+    //
+    // XXH3 from xxHash 0.8 (Yann Collet, BSD 2-clause, https://github.com/Cyan4973/xxHash), bit for bit, so
+    //  values can be checked against the reference tools.  Short keys take a few multiplies, long input runs
+    //  through 8 accumulators with SSE2 or AVX2, picked for the processor on first use.  Not cryptographic:
+    //  use it for hash tables and for noticing that data changed, keep MD5 where a digest is an identity.
+    //
+
+    FOUNDATION_API u64 XXH3_64( const void* data, size_t count, u64 seed = XXH3_SEED );
+    FOUNDATION_API void XXH3_128( const void* data, size_t count, Digest128& digest, u64 seed = XXH3_SEED );
+
+    inline u64 XXH3_64( const tstring& str, u64 seed = XXH3_SEED )
+    {
+        return XXH3_64( str.data(), str.length() * sizeof( tchar ), seed );
+    }
+
+    inline void XXH3_128( const tstring& str, Digest128& digest, u64 seed = XXH3_SEED )
+    {
+        XXH3_128( str.data(), str.length() * sizeof( tchar ), digest, seed );
+    }
+
+    //
+    // The same hashes over data that arrives in pieces, the result doesn't depend on where it was split
+    //
+
+    class FOUNDATION_API XXH3State
+    {
+    public:
+        XXH3State( u64 seed = XXH3_SEED );
+
+        void Reset( u64 seed = XXH3_SEED );
+        void Update( const void* data, size_t count );
+
+        // the hash of everything so far, more can still be added afterward
+        u64 Get64() const;
+        void Get128( Digest128& digest ) const;
+
+    private:
+        void Finish( u64 accumulators[ 8 ] ) const;
+
+        u64     m_Accumulators[ 8 ];
+        u8      m_Secret[ XXH3_SECRET_SIZE ];   // the default secret, offset by the seed
+        u8      m_Buffer[ XXH3_BUFFER_SIZE ];   // input not yet accumulated, always at least one byte once there is any
+        u64     m_Seed;
+        u64     m_TotalLength;
+        u32     m_BufferedLength;
+        u32     m_StripeCount;                  // stripes accumulated since the last scramble
+    };
+
+    // the 128 bit hash of a file's contents, in the byte order the reference tools print
+    FOUNDATION_API void FileXXH3( const tstring& filePath, Digest128& digest, u32 packetSize = XXH3_FILE_PACKET_SIZE );
+}
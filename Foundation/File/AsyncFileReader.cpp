@@ -0,0 +1,646 @@
+#ifdef WIN32
+# include "Platform/Windows/Windows.h"
+#else
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/stat.h>
+# if defined( __linux__ ) && defined( __has_include )
+#  if __has_include( <linux/io_uring.h> )
+#   include <linux/io_uring.h>
+#   include <sys/mman.h>
+#   include <sys/syscall.h>
+#   include <sys/uio.h>
+#   ifdef __NR_io_uring_setup
+#    define ASYNC_READ_IO_URING
+#   endif
+#  endif
+# endif
+#endif
+
+#include "Platform/Align.h"
+#include "Platform/Atomic.h"
+#include "Platform/Error.h"
+
+#include "AsyncFileReader.h"
+
+#include "Foundation/Log.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace Helium;
+
+#ifdef ASYNC_READ_IO_URING
+
+//
+// Just enough of io_uring to queue reads and wait for them, straight on the system calls so there is no
+//  library to depend on.  Every read the reader has out fits in the rings, so nothing ever waits for space.
+//
+
+struct AsyncFileReader::IORing
+{
+    int             m_Fd;
+    u8*             m_SqRing;
+    size_t          m_SqRingSize;
+    u8*             m_CqRing;
+    size_t          m_CqRingSize;
+    io_uring_sqe*   m_Sqes;
+    size_t          m_SqesSize;
+    volatile u32*   m_SqTail;
+    u32             m_SqMask;
+    u32*            m_SqArray;
+    volatile u32*   m_CqHead;
+    volatile u32*   m_CqTail;
+    u32             m_CqMask;
+    io_uring_cqe*   m_Cqes;
+    u32             m_Queued;       // entries written that the kernel hasn't been told about
+    iovec*          m_Vectors;      // one per slot, they have to stay put until the read is submitted
+
+    bool Create( u32 entries );
+    void Destroy();
+    void Queue( int fd, u32 slot, u8* data, u32 size, u64 offset );
+    bool Enter( u32 waitFor );
+};
+
+bool AsyncFileReader::IORing::Create( u32 entries )
+{
+    io_uring_params params;
+    memset( &params, 0, sizeof( params ) );
+    m_Vectors = NULL;
+
+    m_Fd = (int)syscall( __NR_io_uring_setup, entries, &params );
+    if ( m_Fd < 0 )
+    {
+        // old kernel, or one that has it switched off, the threads will do
+        return false;
+    }
+
+    m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof( u32 );
+    m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+    if ( params.features & IORING_FEAT_SINGLE_MMAP )
+    {
+        m_SqRingSize = m_CqRingSize = std::max( m_SqRingSize, m_CqRingSize );
+    }
+
+    m_SqRing = (u8*)mmap( NULL, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQ_RING );
+    m_CqRing = m_SqRing;
+    if ( m_SqRing != MAP_FAILED && !( params.features & IORING_FEAT_SINGLE_MMAP ) )
+    {
+        m_CqRing = (u8*)mmap( NULL, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_CQ_RING );
+    }
+
+    m_SqesSize = params.sq_entries * sizeof( io_uring_sqe );
+    m_Sqes = (io_uring_sqe*)mmap( NULL, m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQES );
+
+    if ( m_SqRing == MAP_FAILED || m_CqRing == MAP_FAILED || m_Sqes == MAP_FAILED )
+    {
+        Destroy();
+        return false;
+    }
+
+    m_SqTail = (volatile u32*)( m_SqRing + params.sq_off.tail );
+    m_SqMask = *(u32*)( m_SqRing + params.sq_off.ring_mask );
+    m_SqArray = (u32*)( m_SqRing + params.sq_off.array );
+    m_CqHead = (volatile u32*)( m_CqRing + params.cq_off.head );
+    m_CqTail = (volatile u32*)( m_CqRing + params.cq_off.tail );
+    m_CqMask = *(u32*)( m_CqRing + params.cq_off.ring_mask );
+    m_Cqes = (io_uring_cqe*)( m_CqRing + params.cq_off.cqes );
+    m_Queued = 0;
+    m_Vectors = new iovec[ entries ];
+
+    return true;
+}
+
+void AsyncFileReader::IORing::Destroy()
+{
+    if ( m_Sqes && m_Sqes != MAP_FAILED )
+    {
+        munmap( m_Sqes, m_SqesSize );
+    }
+
+    if ( m_CqRing && m_CqRing != MAP_FAILED && m_CqRing != m_SqRing )
+    {
+        munmap( m_CqRing, m_CqRingSize );
+    }
+
+    if ( m_SqRing && m_SqRing != MAP_FAILED )
+    {
+        munmap( m_SqRing, m_SqRingSize );
+    }
+
+    close( m_Fd );
+    delete[] m_Vectors;
+}
+
+void AsyncFileReader::IORing::Queue( int fd, u32 slot, u8* data, u32 size, u64 offset )
+{
+    iovec& vector = m_Vectors[ slot ];
+    vector.iov_base = data;
+    vector.iov_len = size;
+
+    // only this thread writes the tail, the kernel only reads it
+    u32 tail = *m_SqTail;
+    u32 index = tail & m_SqMask;
+
+    // readv rather than read so kernels from before 5.6 work too
+    io_uring_sqe& sqe = m_Sqes[ index ];
+    memset( &sqe, 0, sizeof( sqe ) );
+    sqe.opcode = IORING_OP_READV;
+    sqe.fd = fd;
+    sqe.addr = (u64)(uintptr)&vector;
+    sqe.len = 1;
+    sqe.off = offset;
+    sqe.user_data = slot;
+
+    m_SqArray[ index ] = index;
+    AtomicStore( (volatile i32*)m_SqTail, (i32)( tail + 1 ), MemoryOrders::Release );
+    ++m_Queued;
+}
+
+bool AsyncFileReader::IORing::Enter( u32 waitFor )
+{
+    while ( true )
+    {
+        int result = (int)syscall( __NR_io_uring_enter, m_Fd, m_Queued, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0, NULL, 0 );
+        if ( result >= 0 )
+        {
+            m_Queued -= std::min< u32 >( result, m_Queued );
+            return true;
+        }
+
+        if ( errno != EINTR )
+        {
+            return false;
+        }
+    }
+}
+
+#endif
+
+AsyncFileReader::AsyncFileReader( u32 bufferSize, u32 bufferCount )
+: m_Size( 0 )
+, m_BufferSize( (u32)HELIUM_ALIGN_ARB( std::max< u32 >( bufferSize, 1 ), ASYNC_READ_ALIGNMENT ) )
+, m_BufferCount( std::max< u32 >( bufferCount, 1 ) )
+, m_Allocation( NULL )
+, m_AllocationSize( 0 )
+, m_Slots( NULL )
+, m_BlockCount( 0 )
+, m_NextRead( 0 )
+, m_NextConsume( 0 )
+, m_Holding( false )
+, m_Direct( false )
+, m_Failed( 0 )
+, m_Stopping( 0 )
+#ifdef WIN32
+, m_File( INVALID_HANDLE_VALUE )
+#else
+, m_File( -1 )
+#endif
+, m_Ring( NULL )
+, m_InFlight( 0 )
+, m_Workers( NULL )
+, m_WorkerCount( 0 )
+{
+    m_Slots = new Slot[ m_BufferCount ];
+    for ( u32 i = 0; i < m_BufferCount; ++i )
+    {
+        m_Slots[ i ].m_Data = NULL;
+        m_Slots[ i ].m_Offset = 0;
+        m_Slots[ i ].m_Size = 0;
+        m_Slots[ i ].m_Done = 0;
+    }
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    Close();
+
+    delete[] m_Slots;
+    delete[] m_Allocation;
+}
+
+bool AsyncFileReader::Open( const tstring& path )
+{
+    Close();
+
+    m_Path = path;
+
+#ifdef WIN32
+    m_File = ::CreateFile( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    // the caller decides whether a file it can't open is worth mentioning
+    if ( m_File == INVALID_HANDLE_VALUE )
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if ( !::GetFileSizeEx( m_File, &size ) )
+    {
+        Close();
+        return false;
+    }
+    m_Size = size.QuadPart;
+#else
+    m_File = open( path.c_str(), O_RDONLY );
+    // the caller decides whether a file it can't open is worth mentioning
+    if ( m_File < 0 )
+    {
+        return false;
+    }
+
+    struct stat info;
+    if ( fstat( m_File, &info ) != 0 )
+    {
+        Close();
+        return false;
+    }
+    m_Size = info.st_size;
+#endif
+
+    m_BlockCount = ( m_Size + m_BufferSize - 1 ) / m_BufferSize;
+    m_NextRead = 0;
+    m_NextConsume = 0;
+    m_Holding = false;
+    m_Failed = 0;
+    m_Stopping = 0;
+
+    // setting up a ring or threads costs far more than reading a small file, so just read it in Next
+    m_Direct = m_BlockCount <= 1;
+    if ( m_Direct )
+    {
+        Reserve( (size_t)HELIUM_ALIGN_ARB( std::max< u64 >( m_Size, 1 ), ASYNC_READ_ALIGNMENT ) );
+        m_Slots[ 0 ].m_Data = (u8*)HELIUM_ALIGN_ARB( m_Allocation, ASYNC_READ_ALIGNMENT );
+        return true;
+    }
+
+    Reserve( (size_t)m_BufferSize * m_BufferCount );
+    u8* data = (u8*)HELIUM_ALIGN_ARB( m_Allocation, ASYNC_READ_ALIGNMENT );
+    for ( u32 i = 0; i < m_BufferCount; ++i )
+    {
+        m_Slots[ i ].m_Data = data + (size_t)i * m_BufferSize;
+    }
+
+#ifdef ASYNC_READ_IO_URING
+    m_Ring = new IORing;
+    if ( m_Ring->Create( m_BufferCount ) )
+    {
+        Submit();
+        return true;
+    }
+
+    delete m_Ring;
+    m_Ring = NULL;
+#endif
+
+    for ( u32 i = 0; i < m_BufferCount; ++i )
+    {
+        m_Free.Increment();
+    }
+
+    m_WorkerCount = (u32)std::min< u64 >( std::min< u32 >( ASYNC_READ_THREADS, m_BufferCount ), m_BlockCount );
+    m_Workers = new Worker[ m_WorkerCount ];
+    for ( u32 i = 0; i < m_WorkerCount; ++i )
+    {
+        Worker& worker = m_Workers[ i ];
+        worker.m_Reader = this;
+        if ( !worker.m_Thread.Create( &Thread::EntryHelper< Worker, &Worker::Run >, &worker, "Async File Reader", ThreadPriorities::Normal ) )
+        {
+            Log::Warning( TXT( "Failed to create async file reader thread %d\n" ), i );
+        }
+    }
+
+    // without a single reader the consumer would wait forever
+    if ( m_WorkerCount && !m_Workers[ 0 ].m_Thread.Valid() )
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void AsyncFileReader::Close()
+{
+    AtomicStore( &m_Stopping, 1 );
+
+#ifdef ASYNC_READ_IO_URING
+    if ( m_Ring )
+    {
+        // the kernel is writing into our buffers, they can't go anywhere until it's done
+        while ( m_InFlight && m_Ring->Enter( 1 ) )
+        {
+            Reap();
+        }
+
+        m_Ring->Destroy();
+        delete m_Ring;
+        m_Ring = NULL;
+        m_InFlight = 0;
+    }
+#endif
+
+    if ( m_Workers )
+    {
+        for ( u32 i = 0; i < m_WorkerCount; ++i )
+        {
+            m_Free.Increment();
+        }
+
+        for ( u32 i = 0; i < m_WorkerCount; ++i )
+        {
+            if ( m_Workers[ i ].m_Thread.Valid() )
+            {
+                m_Workers[ i ].m_Thread.Wait();
+                m_Workers[ i ].m_Thread.Close();
+            }
+        }
+
+        delete[] m_Workers;
+        m_Workers = NULL;
+        m_WorkerCount = 0;
+
+        m_Free.Reset();
+        for ( u32 i = 0; i < m_BufferCount; ++i )
+        {
+            m_Slots[ i ].m_Ready.Reset();
+        }
+    }
+
+#ifdef WIN32
+    if ( m_File != INVALID_HANDLE_VALUE )
+    {
+        ::CloseHandle( m_File );
+        m_File = INVALID_HANDLE_VALUE;
+    }
+#else
+    if ( m_File >= 0 )
+    {
+        close( m_File );
+        m_File = -1;
+    }
+#endif
+
+    m_Size = 0;
+    m_BlockCount = 0;
+    m_Holding = false;
+    m_Direct = false;
+}
+
+bool AsyncFileReader::Next( AsyncReadBuffer& buffer )
+{
+    if ( m_Direct )
+    {
+        if ( Failed() || m_NextConsume >= m_BlockCount )
+        {
+            return false;
+        }
+
+        Slot& slot = m_Slots[ 0 ];
+        Prepare( slot, m_NextConsume++ );
+
+        if ( !ReadAt( slot.m_Offset, slot.m_Data, slot.m_Size ) )
+        {
+            AtomicStore( &m_Failed, 1 );
+            return false;
+        }
+
+        buffer.m_Data = slot.m_Data;
+        buffer.m_Size = slot.m_Size;
+        buffer.m_Offset = slot.m_Offset;
+        return true;
+    }
+
+    if ( m_Holding )
+    {
+        m_Holding = false;
+
+        if ( m_Ring )
+        {
+            Submit();
+        }
+        else
+        {
+            m_Free.Increment();
+        }
+    }
+
+    if ( Failed() || m_NextConsume >= m_BlockCount )
+    {
+        return false;
+    }
+
+    Slot& slot = m_Slots[ m_NextConsume % m_BufferCount ];
+
+#ifdef ASYNC_READ_IO_URING
+    if ( m_Ring )
+    {
+        while ( slot.m_Done < slot.m_Size && !Failed() )
+        {
+            if ( !m_Ring->Enter( 1 ) )
+            {
+                Log::Warning( TXT( "Failed to wait for a read of %s (%s)\n" ), m_Path.c_str(), Helium::GetErrorString().c_str() );
+                AtomicStore( &m_Failed, 1 );
+                break;
+            }
+
+            Reap();
+        }
+    }
+    else
+#endif
+    {
+        slot.m_Ready.Wait();
+        slot.m_Ready.Reset();
+    }
+
+    if ( Failed() )
+    {
+        return false;
+    }
+
+    buffer.m_Data = slot.m_Data;
+    buffer.m_Size = slot.m_Size;
+    buffer.m_Offset = slot.m_Offset;
+
+    ++m_NextConsume;
+    m_Holding = true;
+
+    return true;
+}
+
+void AsyncFileReader::Reserve( size_t size )
+{
+    if ( size > m_AllocationSize )
+    {
+        delete[] m_Allocation;
+        m_Allocation = new u8[ size + ASYNC_READ_ALIGNMENT ];
+        m_AllocationSize = size;
+    }
+}
+
+void AsyncFileReader::Prepare( Slot& slot, u64 block )
+{
+    slot.m_Offset = block * m_BufferSize;
+    slot.m_Size = (u32)std::min< u64 >( m_Size - slot.m_Offset, m_BufferSize );
+    slot.m_Done = 0;
+}
+
+void AsyncFileReader::Submit()
+{
+#ifdef ASYNC_READ_IO_URING
+    // every slot but the one the consumer holds can be reading
+    while ( m_NextRead < m_BlockCount && m_NextRead - m_NextConsume + ( m_Holding ? 1 : 0 ) < m_BufferCount )
+    {
+        u32 slot = (u32)( m_NextRead % m_BufferCount );
+        Prepare( m_Slots[ slot ], m_NextRead++ );
+        Start( slot );
+    }
+
+    if ( m_Ring->m_Queued && !m_Ring->Enter( 0 ) )
+    {
+        Log::Warning( TXT( "Failed to queue reads of %s (%s)\n" ), m_Path.c_str(), Helium::GetErrorString().c_str() );
+        AtomicStore( &m_Failed, 1 );
+    }
+#endif
+}
+
+void AsyncFileReader::Start( u32 slot )
+{
+#ifdef ASYNC_READ_IO_URING
+    Slot& s = m_Slots[ slot ];
+    m_Ring->Queue( m_File, slot, s.m_Data + s.m_Done, s.m_Size - s.m_Done, s.m_Offset + s.m_Done );
+    ++m_InFlight;
+#endif
+}
+
+void AsyncFileReader::Reap()
+{
+#ifdef ASYNC_READ_IO_URING
+    u32 head = *m_Ring->m_CqHead;
+    u32 tail = (u32)AtomicLoad( (volatile i32*)m_Ring->m_CqTail, MemoryOrders::Acquire );
+
+    for ( ; head != tail; ++head )
+    {
+        const io_uring_cqe& cqe = m_Ring->m_Cqes[ head & m_Ring->m_CqMask ];
+        u32 slot = (u32)cqe.user_data;
+        Slot& s = m_Slots[ slot ];
+        --m_InFlight;
+
+        if ( cqe.res > 0 )
+        {
+            s.m_Done += cqe.res;
+        }
+        else if ( cqe.res != -EINTR && cqe.res != -EAGAIN )
+        {
+            if ( cqe.res == 0 )
+            {
+                Log::Warning( TXT( "%s got shorter while it was being read\n" ), m_Path.c_str() );
+            }
+            else
+            {
+                Log::Warning( TXT( "Failed to read %s (%s)\n" ), m_Path.c_str(), Helium::GetErrorString( -cqe.res ).c_str() );
+            }
+            AtomicStore( &m_Failed, 1 );
+            continue;
+        }
+
+        // a short or interrupted read, go for the rest
+        if ( s.m_Done < s.m_Size && !AtomicLoad( &m_Stopping ) && !Failed() )
+        {
+            Start( slot );
+        }
+    }
+
+    AtomicStore( (volatile i32*)m_Ring->m_CqHead, (i32)head, MemoryOrders::Release );
+
+    if ( m_Ring->m_Queued )
+    {
+        m_Ring->Enter( 0 );
+    }
+#endif
+}
+
+void AsyncFileReader::Run()
+{
+    while ( true )
+    {
+        m_Free.Decrement();
+
+        if ( AtomicLoad( &m_Stopping ) )
+        {
+            break;
+        }
+
+        u64 block;
+        {
+            Helium::TakeMutex lock ( m_Lock );
+            if ( m_NextRead >= m_BlockCount )
+            {
+                break;
+            }
+            block = m_NextRead++;
+        }
+
+        Slot& slot = m_Slots[ block % m_BufferCount ];
+        Prepare( slot, block );
+
+        if ( !Failed() )
+        {
+            if ( ReadAt( slot.m_Offset, slot.m_Data, slot.m_Size ) )
+            {
+                slot.m_Done = slot.m_Size;
+            }
+            else
+            {
+                AtomicStore( &m_Failed, 1 );
+            }
+        }
+
+        slot.m_Ready.Signal();
+    }
+}
+
+bool AsyncFileReader::ReadAt( u64 offset, u8* data, u32 size )
+{
+    while ( size )
+    {
+#ifdef WIN32
+        OVERLAPPED overlapped;
+        memset( &overlapped, 0, sizeof( overlapped ) );
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)( offset >> 32 );
+
+        DWORD read = 0;
+        if ( !::ReadFile( m_File, data, size, &read, &overlapped ) )
+        {
+            Log::Warning( TXT( "Failed to read %s (%s)\n" ), m_Path.c_str(), Helium::GetErrorString().c_str() );
+            return false;
+        }
+#else
+        ssize_t read = pread( m_File, data, size, (off_t)offset );
+        if ( read < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+
+            Log::Warning( TXT( "Failed to read %s (%s)\n" ), m_Path.c_str(), Helium::GetErrorString().c_str() );
+            return false;
+        }
+#endif
+
+        if ( read == 0 )
+        {
+            Log::Warning( TXT( "%s got shorter while it was being read\n" ), m_Path.c_str() );
+            return false;
+        }
+
+        offset += read;
+        data += read;
+        size -= (u32)read;
+    }
+
+    return true;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+
+#include "Platform/Types.h"
+#include "Platform/Condition.h"
+#include "Platform/Mutex.h"
+#include "Platform/Semaphore.h"
+#include "Platform/Thread.h"
+
+#include "Foundation/API.h"
+
+// the size of each read, and how many buffers there are: all but the one being consumed are being read
+#define ASYNC_READ_BUFFER_SIZE      ( 1024 * 1024 )
+#define ASYNC_READ_BUFFER_COUNT     4
+
+// buffers and read offsets are multiples of this, so reads don't straddle pages
+#define ASYNC_READ_ALIGNMENT        4096
+
+// reader threads per file when the kernel can't take the reads asynchronously
+#define ASYNC_READ_THREADS          2
+
+namespace Helium
+{
+    struct AsyncReadBuffer
+    {
+        const u8*   m_Data;
+        u32         m_Size;
+        u64         m_Offset;   // where in the file the data came from
+    };
+
+    //
+    // Reads a file front to back ahead of whoever consumes it, so the disk stays busy while the last buffer
+    //  is hashed or sent.  On Linux the reads are handed to the kernel through io_uring, elsewhere (or if
+    //  the kernel won't give us a ring) a couple of threads do positional reads.  The buffers are a bounded
+    //  queue: reads never get further ahead of the consumer than the buffer count.  A file that fits in one
+    //  buffer is just read when it's asked for, and the buffers are only as big as the files need.
+    //
+
+    class FOUNDATION_API AsyncFileReader
+    {
+    public:
+        AsyncFileReader( u32 bufferSize = ASYNC_READ_BUFFER_SIZE, u32 bufferCount = ASYNC_READ_BUFFER_COUNT );
+        ~AsyncFileReader();
+
+        // opening starts the reads
+        bool Open( const tstring& path );
+        void Close();
+
+        const tstring& GetPath() const
+        {
+            return m_Path;
+        }
+
+        u64 GetSize() const
+        {
+            return m_Size;
+        }
+
+        // a read failed, or the file got shorter under us
+        bool Failed() const
+        {
+            return m_Failed != 0;
+        }
+
+        // the next buffer in file order, waiting if it isn't read yet; the buffer from the previous call is
+        //  handed back to be refilled, so only one can be held at a time.  False at the end or on failure.
+        bool Next( AsyncReadBuffer& buffer );
+
+    private:
+        struct Slot
+        {
+            u8*                 m_Data;
+            u64                 m_Offset;
+            u32                 m_Size;     // how much the read is for
+            u32                 m_Done;     // how much of it has arrived
+            Helium::Condition   m_Ready;    // signaled by the reader threads
+        };
+
+        struct Worker
+        {
+            AsyncFileReader*    m_Reader;
+            Helium::Thread      m_Thread;
+
+            void Run()
+            {
+                m_Reader->Run();
+            }
+        };
+
+        struct IORing;
+
+        void Reserve( size_t size );
+        void Prepare( Slot& slot, u64 block );
+        void Submit();
+        void Start( u32 slot );
+        void Reap();
+        void Run();
+        bool ReadAt( u64 offset, u8* data, u32 size );
+
+#ifdef WIN32
+        typedef void* NativeFile;
+#else
+        typedef int NativeFile;
+#endif
+
+        tstring             m_Path;
+        u64                 m_Size;
+        u32                 m_BufferSize;
+        u32                 m_BufferCount;
+        u8*                 m_Allocation;   // allocated on demand, and kept for the next file
+        size_t              m_AllocationSize;
+        Slot*               m_Slots;
+        u64                 m_BlockCount;
+        u64                 m_NextRead;     // the next block to start reading
+        u64                 m_NextConsume;  // the next block to hand out
+        bool                m_Holding;      // the consumer has the block before m_NextConsume
+        bool                m_Direct;       // the file fits in one buffer, Next reads it with no ring or threads
+        volatile i32        m_Failed;
+        volatile i32        m_Stopping;
+        NativeFile          m_File;
+
+        // io_uring
+        IORing*             m_Ring;
+        u32                 m_InFlight;     // reads the kernel has that haven't completed
+
+        // reader threads
+        Worker*             m_Workers;
+        u32                 m_WorkerCount;
+        Helium::Mutex       m_Lock;         // guards m_NextRead
+        Helium::Semaphore   m_Free;         // slots that can take a read
+    };
+}
@@ -1,12 +1,90 @@
-#include "Platform/Windows/Windows.h"
+#ifdef WIN32
+# include "Platform/Windows/Windows.h"
+#else
+# include <dirent.h>
+# include <errno.h>
+# include <fcntl.h>
+# include <string.h>
+# include <unistd.h>
+# include <sys/stat.h>
+# include <sys/syscall.h>
+#endif
+
 #include "Platform/Exception.h"
+#include "Platform/Error.h"
+#include "Platform/Atomic.h"
+#include "Platform/Mutex.h"
+#include "Platform/Platform.h"
+#include "Platform/Semaphore.h"
+#include "Platform/Thread.h"
 
 #include "Directory.h"
 
+#include "Foundation/Log.h"
+
 #include "Platform/Assert.h"
 
+#include <deque>
+
 using namespace Helium;
 
+//
+// Wildcard match for directory specs (* and ?), case insensitive on windows like FindFirstFile
+//
+
+static inline bool MatchCharacter( tchar lhs, tchar rhs )
+{
+#ifdef WIN32
+    return _totlower( lhs ) == _totlower( rhs );
+#else
+    return lhs == rhs;
+#endif
+}
+
+static bool MatchSpec( const tchar* name, const tchar* nameEnd, const tchar* spec )
+{
+    // "*.*" is the windows idiom for everything, extension or not
+    if ( spec[ 0 ] == '*' && ( spec[ 1 ] == '\0' || ( spec[ 1 ] == '.' && spec[ 2 ] == '*' && spec[ 3 ] == '\0' ) ) )
+    {
+        return true;
+    }
+
+    const tchar* star = NULL;
+    const tchar* resume = NULL;
+
+    while ( name < nameEnd )
+    {
+        if ( *spec == '*' )
+        {
+            star = spec++;
+            resume = name;
+        }
+        else if ( *spec && ( *spec == '?' || MatchCharacter( *spec, *name ) ) )
+        {
+            ++spec;
+            ++name;
+        }
+        else if ( star )
+        {
+            spec = star + 1;
+            name = ++resume;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while ( *spec == '*' )
+    {
+        ++spec;
+    }
+
+    return *spec == '\0';
+}
+
+#ifdef WIN32
+
 Directory::Directory()
 : m_Done( true )
 , m_Handle ( INVALID_HANDLE_VALUE )
@@ -21,9 +99,37 @@ Directory::Directory(const tstring &path, const tstring &spec, u32 flags)
     Open( path, spec, flags );
 }
 
+#else
+
+Directory::Directory()
+: m_Handle( -1 )
+, m_Buffer( NULL )
+, m_BufferLength( 0 )
+, m_BufferOffset( 0 )
+, m_Done( true )
+{
+
+}
+
+Directory::Directory(const tstring &path, const tstring &spec, u32 flags)
+: m_Handle( -1 )
+, m_Buffer( NULL )
+, m_BufferLength( 0 )
+, m_BufferOffset( 0 )
+, m_Done( true )
+{
+    Open( path, spec, flags );
+}
+
+#endif
+
 Directory::~Directory()
 {
     Close();
+
+#ifndef WIN32
+    delete[] m_Buffer;
+#endif
 }
 
 bool Directory::IsDone()
@@ -69,11 +175,13 @@ bool Directory::Open(const tstring &path, const tstring &spec /* = TXT( "" ) */,
 
     tstring query = m_Path + m_Spec;
 
+#ifdef WIN32
     // check that the input is not larger than allowed
     if ( query.size() > MAX_PATH )
     {
         throw Helium::Exception( TXT( "Query string is too long (max buffer length is %d): %s" ), ( int ) MAX_PATH, query.c_str() );
     }
+#endif
 
     return Find(query);
 }
@@ -100,6 +208,8 @@ void Directory::GetFiles( std::set< Helium::Path >& paths, const tstring& spec,
     GetFiles( m_Path, paths, spec, recursive );
 }
 
+#ifdef WIN32
+
 bool Directory::Find(const tstring& query)
 {
     DWORD error = 0x0;
@@ -109,7 +219,13 @@ bool Directory::Find(const tstring& query)
 
     if (!query.empty())
     {
-        if ( (m_Handle = ::FindFirstFile( query.c_str(), &foundFile )) == INVALID_HANDLE_VALUE )
+#if _WIN32_WINNT >= 0x0601
+        // skip the short names and have the file system hand back entries in large batches
+        m_Handle = ::FindFirstFileEx( query.c_str(), FindExInfoBasic, &foundFile, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH );
+#else
+        m_Handle = ::FindFirstFile( query.c_str(), &foundFile );
+#endif
+        if ( m_Handle == INVALID_HANDLE_VALUE )
         {
             m_Done = true;
 
@@ -236,20 +352,536 @@ void Directory::Close()
     m_Item.Clear(); 
 }
 
+#else // WIN32
+
+// the kernel's record layout for getdents64, glibc does not export one
+struct LinuxDirectoryEntry
+{
+    u64             d_ino;
+    i64             d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[ 1 ];
+};
+
+struct EntryStat
+{
+    bool    m_Directory;
+    u64     m_CreateTime;   // 0 where the file system doesn't record when the file was created
+    u64     m_ModTime;
+    u64     m_Size;
+};
+
+// stat an entry relative to the open directory, statx gives us the birth time where the kernel and file system have it
+static bool StatEntry( int directory, const char* name, EntryStat& entry )
+{
+#ifdef STATX_BTIME
+    // the walker's threads all get here, any of them may find out first
+    static volatile i32 s_HaveStatx = 1;
+    if ( AtomicLoad( &s_HaveStatx, MemoryOrders::Relaxed ) )
+    {
+        struct statx info;
+        if ( ::statx( directory, name, AT_SYMLINK_NOFOLLOW, STATX_TYPE | STATX_MTIME | STATX_SIZE | STATX_BTIME, &info ) == 0 )
+        {
+            entry.m_Directory = S_ISDIR( info.stx_mode );
+            entry.m_CreateTime = ( info.stx_mask & STATX_BTIME ) ? (u64)info.stx_btime.tv_sec * 1000000000ULL + info.stx_btime.tv_nsec : 0;
+            entry.m_ModTime = (u64)info.stx_mtime.tv_sec * 1000000000ULL + info.stx_mtime.tv_nsec;
+            entry.m_Size = info.stx_size;
+            return true;
+        }
+
+        if ( errno != ENOSYS )
+        {
+            return false;
+        }
+
+        // an older kernel, stat tells us everything but the birth time
+        AtomicStore( &s_HaveStatx, 0, MemoryOrders::Relaxed );
+    }
+#endif
+
+    struct stat info;
+    if ( ::fstatat( directory, name, &info, AT_SYMLINK_NOFOLLOW ) != 0 )
+    {
+        return false;
+    }
+
+    // st_ctime is when the inode last changed, not when the file was created, so we have no creation time
+    entry.m_Directory = S_ISDIR( info.st_mode );
+    entry.m_CreateTime = 0;
+    entry.m_ModTime = (u64)info.st_mtim.tv_sec * 1000000000ULL + info.st_mtim.tv_nsec;
+    entry.m_Size = info.st_size;
+    return true;
+}
+
+bool Directory::Find(const tstring& query)
+{
+    m_Done = false;
+
+    if (!query.empty())
+    {
+        m_Handle = ::open( m_Path.empty() ? "." : m_Path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+        if ( m_Handle < 0 )
+        {
+            int error = errno;
+
+            m_Done = true;
+
+            Close();
+
+            if ( error != ENOENT && error != ENOTDIR )
+            {
+                throw Exception( TXT( "Error opening directory %s (%s)" ), m_Path.c_str(), strerror( error ) );
+            }
+
+            return false;
+        }
+
+        if ( !m_Buffer )
+        {
+            m_Buffer = new char[ DIRECTORY_BUFFER_SIZE ];
+        }
+
+        m_BufferLength = 0;
+        m_BufferOffset = 0;
+    }
+
+    while ( !m_Done )
+    {
+        if ( m_BufferOffset >= m_BufferLength )
+        {
+            // read as many entries as fit in the buffer at once, rather than one per readdir
+            long length = ::syscall( SYS_getdents64, m_Handle, m_Buffer, DIRECTORY_BUFFER_SIZE );
+            if ( length <= 0 )
+            {
+                int error = errno;
+
+                m_Done = true;
+
+                Close();
+
+                if ( length < 0 )
+                {
+                    throw Exception( TXT( "Error reading directory %s (%s)" ), m_Path.c_str(), strerror( error ) );
+                }
+
+                break;
+            }
+
+            m_BufferLength = (int)length;
+            m_BufferOffset = 0;
+        }
+
+        const LinuxDirectoryEntry* entry = (const LinuxDirectoryEntry*)( m_Buffer + m_BufferOffset );
+        m_BufferOffset += entry->d_reclen;
+
+        const char* name = entry->d_name;
+
+        // skip relative path directories if fileName is "." or ".."
+        if ( name[ 0 ] == '.' && ( name[ 1 ] == '\0' || ( name[ 1 ] == '.' && name[ 2 ] == '\0' ) ) )
+        {
+            continue;
+        }
+
+        size_t nameLength = strlen( name );
+        if ( !MatchSpec( name, name + nameLength, m_Spec.c_str() ) )
+        {
+            continue;
+        }
+
+        // d_type saves a stat per entry, only file systems that don't fill it in (or callers that want times) pay for one
+        bool isDirectory = entry->d_type == DT_DIR;
+        bool needStat = entry->d_type == DT_UNKNOWN || !( m_Flags & DirectoryFlags::NoStat );
+
+        EntryStat info;
+        if ( needStat )
+        {
+            if ( !StatEntry( m_Handle, name, info ) )
+            {
+                // deleted out from under us
+                continue;
+            }
+
+            isDirectory = info.m_Directory;
+        }
+
+        if ( isDirectory ? ( m_Flags & DirectoryFlags::SkipDirectories ) != 0 : ( m_Flags & DirectoryFlags::SkipFiles ) != 0 )
+        {
+            continue;
+        }
+
+        // It's a keeper! store the data and format the file name
+        m_Item.Clear();
+
+        if ( !(m_Flags & DirectoryFlags::RelativePath) )
+        {
+            m_Item.m_Path = m_Path;
+        }
+        m_Item.m_Path.append( name, nameLength );
+
+        m_Item.m_Inode = entry->d_ino;
+
+        if ( needStat )
+        {
+            m_Item.m_CreateTime = info.m_CreateTime;
+            m_Item.m_ModTime = info.m_ModTime;
+            m_Item.m_Size = info.m_Size;
+        }
+
+        // flag this item as a directory if it is one
+        if ( isDirectory )
+        {
+            m_Item.m_Flags |= DirectoryItemFlags::Directory;
+            m_Item.m_Path += TXT( "/" );
+        }
+
+        break;
+    }
+
+    return !m_Done;
+}
+
+void Directory::Close()
+{
+    if ( m_Handle >= 0 )
+    {
+        ::close( m_Handle );
+        m_Handle = -1;
+    }
+
+    m_Done = true;
+    m_Item.Clear(); 
+}
+
+#endif // WIN32
+
+// should an item found while walking be reported, given the spec and flags the caller asked for
+static bool MatchItem( const DirectoryItem& item, size_t directoryLength, const tstring& spec, u32 flags )
+{
+    bool isDirectory = ( item.m_Flags & DirectoryItemFlags::Directory ) != 0;
+    if ( isDirectory ? ( flags & DirectoryFlags::SkipDirectories ) != 0 : ( flags & DirectoryFlags::SkipFiles ) != 0 )
+    {
+        return false;
+    }
+
+    const tchar* name = item.m_Path.c_str() + directoryLength;
+    const tchar* nameEnd = item.m_Path.c_str() + item.m_Path.length() - ( isDirectory ? 1 : 0 );
+
+    return MatchSpec( name, nameEnd, spec.c_str() );
+}
+
 void Helium::RecurseDirectories( DirectoryItemSignature::Delegate delegate, const tstring &path, const tstring &spec, u32 flags )
 {
-    // contents
-    for ( Directory dir ( path, spec, flags ); !dir.IsDone(); dir.Next() )
+    std::vector< tstring > directories;
+    DirectoryItem relative;
+
+    // one pass over each directory both reports matching items and finds the subdirectories to recurse into
+    for ( Directory dir ( path, TXT( "*" ), flags & DirectoryFlags::NoStat ); !dir.IsDone(); dir.Next() )
     {
-        delegate.Invoke( dir.GetItem() );
+        const DirectoryItem& item = dir.GetItem();
+
+        if ( item.m_Flags & DirectoryItemFlags::Directory )
+        {
+            directories.push_back( item.m_Path );
+        }
+
+        if ( !MatchItem( item, path.length(), spec, flags ) )
+        {
+            continue;
+        }
+
+        if ( flags & DirectoryFlags::RelativePath )
+        {
+            relative = item;
+            relative.m_Path.erase( 0, path.length() );
+            delegate.Invoke( relative );
+        }
+        else
+        {
+            delegate.Invoke( item );
+        }
     }
 
     // recurse
-    for ( Directory dir ( path, TXT( "*.*" ), DirectoryFlags::SkipFiles ); !dir.IsDone(); dir.Next() )
+    for ( std::vector< tstring >::const_iterator itr = directories.begin(), end = directories.end(); itr != end; ++itr )
     {
-        if ( dir.GetItem().m_Flags & DirectoryItemFlags::Directory )
+        RecurseDirectories( delegate, *itr, spec, flags );
+    }
+}
+
+//
+// Parallel walk: each worker owns a queue of directories to read, pushing the subdirectories it finds
+//  onto the back of its own queue and popping from the back (so it stays depth first and near the
+//  directories it just read), while idle workers steal from the front of everyone else's queue.
+//  Items are collected into per worker chunks and handed to the delegate under a lock.
+//
+
+namespace Helium
+{
+    class DirectoryWalker
+    {
+    public:
+        struct Worker
         {
-            RecurseDirectories( delegate, dir.GetItem().m_Path, spec, flags );
+            DirectoryWalker*            m_Walker;
+            u32                         m_Index;
+            Helium::Mutex               m_Lock;         // guards m_Directories
+            std::deque< tstring >       m_Directories;
+            std::vector< DirectoryItem > m_Chunk;       // never shrinks, so item strings keep their storage
+            u32                         m_Count;
+            Helium::Thread              m_Thread;
+
+            void Run()
+            {
+                m_Walker->Run( *this );
+            }
+        };
+
+        DirectoryWalker( const DirectoryItemsSignature::Delegate& delegate, const tstring& spec, u32 flags, u32 threads );
+        ~DirectoryWalker();
+
+        void Walk( const tstring& path );
+
+    private:
+        void Run( Worker& worker );
+        void Push( Worker& worker, const tstring& directory );
+        bool Pop( Worker& worker, tstring& directory );
+        void Read( Worker& worker, const tstring& directory );
+        void Emit( Worker& worker, const DirectoryItem& item, size_t directoryLength );
+        void Flush( Worker& worker );
+
+        DirectoryItemsSignature::Delegate   m_Delegate;
+        Helium::Mutex                       m_DelegateLock;
+        tstring                             m_Spec;
+        u32                                 m_Flags;
+        std::vector< Worker* >              m_Workers;
+        Helium::Semaphore                   m_Wakeup;
+        volatile i32                        m_Outstanding;  // directories queued or being read, the walk is done at zero
+        volatile i32                        m_Sleeping;
+    };
+}
+
+DirectoryWalker::DirectoryWalker( const DirectoryItemsSignature::Delegate& delegate, const tstring& spec, u32 flags, u32 threads )
+: m_Delegate( delegate )
+, m_Spec( spec )
+, m_Flags( flags )
+, m_Outstanding( 0 )
+, m_Sleeping( 0 )
+{
+    for ( u32 i = 0; i < threads; ++i )
+    {
+        Worker* worker = new Worker;
+        worker->m_Walker = this;
+        worker->m_Index = i;
+        worker->m_Chunk.resize( DIRECTORY_CHUNK_SIZE );
+        worker->m_Count = 0;
+        m_Workers.push_back( worker );
+    }
+}
+
+DirectoryWalker::~DirectoryWalker()
+{
+    for ( std::vector< Worker* >::const_iterator itr = m_Workers.begin(), end = m_Workers.end(); itr != end; ++itr )
+    {
+        delete *itr;
+    }
+}
+
+void DirectoryWalker::Walk( const tstring& path )
+{
+    Push( *m_Workers[ 0 ], path );
+
+    // the calling thread is the first worker
+    for ( u32 i = 1; i < m_Workers.size(); ++i )
+    {
+        Worker* worker = m_Workers[ i ];
+        if ( !worker->m_Thread.Create( &Thread::EntryHelper< Worker, &Worker::Run >, worker, "Directory Walker", ThreadPriorities::Normal ) )
+        {
+            // carry on with the workers we have, nothing will be queued for this one
+            Log::Warning( TXT( "Failed to create directory walker thread %d\n" ), i );
+        }
+    }
+
+    Run( *m_Workers[ 0 ] );
+
+    for ( u32 i = 1; i < m_Workers.size(); ++i )
+    {
+        if ( m_Workers[ i ]->m_Thread.Valid() )
+        {
+            m_Workers[ i ]->m_Thread.Wait();
+            m_Workers[ i ]->m_Thread.Close();
         }
     }
-}
\ No newline at end of file
+}
+
+void DirectoryWalker::Run( Worker& worker )
+{
+    tstring directory;
+
+    while ( true )
+    {
+        if ( Pop( worker, directory ) )
+        {
+            Read( worker, directory );
+
+            if ( AtomicDecrement( &m_Outstanding ) == 0 )
+            {
+                // that was the last one, wake everyone so they can leave
+                for ( u32 i = 0; i < m_Workers.size(); ++i )
+                {
+                    m_Wakeup.Increment();
+                }
+            }
+
+            continue;
+        }
+
+        if ( AtomicLoad( &m_Outstanding ) == 0 )
+        {
+            break;
+        }
+
+        // announce we are going to sleep, then look once more so a push we raced with isn't missed
+        AtomicIncrement( &m_Sleeping );
+        if ( Pop( worker, directory ) )
+        {
+            AtomicDecrement( &m_Sleeping );
+            Read( worker, directory );
+
+            if ( AtomicDecrement( &m_Outstanding ) == 0 )
+            {
+                for ( u32 i = 0; i < m_Workers.size(); ++i )
+                {
+                    m_Wakeup.Increment();
+                }
+            }
+
+            continue;
+        }
+
+        if ( AtomicLoad( &m_Outstanding ) != 0 )
+        {
+            m_Wakeup.Decrement();
+        }
+        AtomicDecrement( &m_Sleeping );
+    }
+
+    Flush( worker );
+}
+
+void DirectoryWalker::Push( Worker& worker, const tstring& directory )
+{
+    AtomicIncrement( &m_Outstanding );
+
+    {
+        Helium::TakeMutex lock ( worker.m_Lock );
+        worker.m_Directories.push_back( directory );
+    }
+
+    if ( AtomicLoad( &m_Sleeping, MemoryOrders::Sequential ) > 0 )
+    {
+        m_Wakeup.Increment();
+    }
+}
+
+bool DirectoryWalker::Pop( Worker& worker, tstring& directory )
+{
+    {
+        Helium::TakeMutex lock ( worker.m_Lock );
+        if ( !worker.m_Directories.empty() )
+        {
+            directory = worker.m_Directories.back();
+            worker.m_Directories.pop_back();
+            return true;
+        }
+    }
+
+    // steal the oldest (and so probably biggest) piece of someone else's work
+    for ( u32 i = 1; i < m_Workers.size(); ++i )
+    {
+        Worker& victim = *m_Workers[ ( worker.m_Index + i ) % m_Workers.size() ];
+
+        Helium::TakeMutex lock ( victim.m_Lock );
+        if ( !victim.m_Directories.empty() )
+        {
+            directory = victim.m_Directories.front();
+            victim.m_Directories.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DirectoryWalker::Read( Worker& worker, const tstring& directory )
+{
+    try
+    {
+        for ( Directory dir ( directory, TXT( "*" ), m_Flags & DirectoryFlags::NoStat ); !dir.IsDone(); dir.Next() )
+        {
+            const DirectoryItem& item = dir.GetItem();
+
+            if ( item.m_Flags & DirectoryItemFlags::Directory )
+            {
+                Push( worker, item.m_Path );
+            }
+
+            if ( MatchItem( item, directory.length(), m_Spec, m_Flags ) )
+            {
+                Emit( worker, item, directory.length() );
+            }
+        }
+    }
+    catch ( const Helium::Exception& ex )
+    {
+        // no one to throw to on a worker thread, skip the directory and keep walking
+        Log::Warning( TXT( "%s\n" ), ex.What() );
+    }
+}
+
+void DirectoryWalker::Emit( Worker& worker, const DirectoryItem& item, size_t directoryLength )
+{
+    DirectoryItem& slot = worker.m_Chunk[ worker.m_Count++ ];
+
+    if ( m_Flags & DirectoryFlags::RelativePath )
+    {
+        slot.m_Path.assign( item.m_Path, directoryLength, tstring::npos );
+    }
+    else
+    {
+        slot.m_Path.assign( item.m_Path );
+    }
+
+    slot.m_CreateTime = item.m_CreateTime;
+    slot.m_ModTime = item.m_ModTime;
+    slot.m_Size = item.m_Size;
+    slot.m_Inode = item.m_Inode;
+    slot.m_Flags = item.m_Flags;
+
+    if ( worker.m_Count == worker.m_Chunk.size() )
+    {
+        Flush( worker );
+    }
+}
+
+void DirectoryWalker::Flush( Worker& worker )
+{
+    if ( worker.m_Count )
+    {
+        Helium::TakeMutex lock ( m_DelegateLock );
+        m_Delegate.Invoke( DirectoryItemsArgs( &worker.m_Chunk[ 0 ], worker.m_Count ) );
+    }
+
+    worker.m_Count = 0;
+}
+
+void Helium::RecurseDirectories( DirectoryItemsSignature::Delegate delegate, const tstring &path, const tstring &spec, u32 flags, u32 threads )
+{
+    if ( threads == 0 )
+    {
+        threads = Helium::GetProcessorCount();
+    }
+
+    DirectoryWalker walker ( delegate, spec, flags, threads );
+    walker.Walk( path );
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "Platform/Types.h"
 
 #include "Foundation/API.h"
@@ -15,6 +17,7 @@ namespace Helium
             SkipFiles         = 1 << 0,          // Skip files
             SkipDirectories   = 1 << 1,          // Skip directories
             RelativePath      = 1 << 3,          // Don't preped each file with the root path
+            NoStat            = 1 << 4,          // Don't fill in times and sizes where that costs a stat per item (posix)
         };
 
         const u32 Default = 0;
@@ -22,6 +25,12 @@ namespace Helium
 
     typedef void* DirectoryHandle;
 
+// bytes of directory entries read per system call on posix
+#define DIRECTORY_BUFFER_SIZE   ( 32 * 1024 )
+
+// items handed to a DirectoryItemsSignature listener at once
+#define DIRECTORY_CHUNK_SIZE    256
+
     namespace DirectoryItemFlags
     {
         enum Flags
@@ -38,6 +47,7 @@ namespace Helium
             : m_CreateTime ( 0x0 )
             , m_ModTime ( 0x0 )
             , m_Size( 0x0 )
+            , m_Inode( 0x0 )
             , m_Flags ( 0x0 )
         {
 
@@ -49,12 +59,15 @@ namespace Helium
             m_CreateTime = 0x0;
             m_ModTime = 0x0;
             m_Size = 0x0;
+            m_Inode = 0x0;
+            m_Flags = 0x0;
         }
 
         tstring         m_Path;
-        u64                 m_CreateTime;
+        u64                 m_CreateTime;       // times are FILETIMEs on windows, nanoseconds since the epoch on posix (0 if the file system has no birth time)
         u64                 m_ModTime;
         u64                 m_Size;
+        u64                 m_Inode;            // file serial number where listing the directory provides it (posix), otherwise 0
         u32                 m_Flags;
     };
 
@@ -82,7 +95,14 @@ namespace Helium
         tstring         m_Path;
         tstring         m_Spec;
         u32                 m_Flags;
+#ifdef WIN32
         DirectoryHandle     m_Handle;
+#else
+        int                 m_Handle;           // open directory descriptor
+        char*               m_Buffer;           // entries from the last getdents
+        int                 m_BufferLength;
+        int                 m_BufferOffset;
+#endif
         DirectoryItem       m_Item;
         bool                m_Done;
     };
@@ -90,4 +110,23 @@ namespace Helium
     typedef Helium::Signature< const DirectoryItem&> DirectoryItemSignature;
 
     FOUNDATION_API void RecurseDirectories( DirectoryItemSignature::Delegate delegate, const tstring &path, const tstring &spec = TXT( "*.*" ), u32 flags = DirectoryFlags::Default);
+
+    // a chunk of items found by a parallel walk, only valid for the duration of the callback
+    struct FOUNDATION_API DirectoryItemsArgs
+    {
+        const DirectoryItem*    m_Items;
+        u32                     m_Count;
+
+        DirectoryItemsArgs( const DirectoryItem* items, u32 count )
+            : m_Items( items )
+            , m_Count( count )
+        {
+        }
+    };
+
+    typedef Helium::Signature< const DirectoryItemsArgs& > DirectoryItemsSignature;
+
+    // walk the tree with a pool of threads (0 is one per processor), the delegate is called with chunks
+    //  of items from one thread at a time, in no particular order
+    FOUNDATION_API void RecurseDirectories( DirectoryItemsSignature::Delegate delegate, const tstring &path, const tstring &spec = TXT( "*.*" ), u32 flags = DirectoryFlags::Default, u32 threads = 0 );
 }
\ No newline at end of file
@@ -1,12 +1,649 @@
 #include "FileWatcher.h"
 
 #include "Foundation/Log.h"
+#include "Foundation/File/Directory.h"
+#include "Platform/Exception.h"
+#include "Platform/Profile.h"
+#include "Platform/Stat.h"
+
+#include <algorithm>
+#include <time.h>
+
+#ifdef WIN32
+# include "Platform/Windows/Windows.h"
+#else
+# include <errno.h>
+# include <string.h>
+# include <dirent.h>
+# include <poll.h>
+# include <unistd.h>
+# include <sys/inotify.h>
+# include <sys/stat.h>
+#endif
 
-#include "Platform/Windows/Windows.h"
 #include "Path.h"
 
 using namespace Helium;
 
+FileWatch* FileWatcher::Open( const tstring& path, bool watchSubtree )
+{
+    M_PathToFileWatch::iterator itr = m_Watches.find( path );
+    if ( itr != m_Watches.end() )
+    {
+        return &itr->second;
+    }
+
+    FileWatch& watch = m_Watches[ path ];
+    watch.m_Path.Set( path );
+    watch.m_WatchSubtree = watchSubtree;
+
+    if ( !StartWatch( path, watch ) )
+    {
+        m_Watches.erase( path );
+        return NULL;
+    }
+
+    return &watch;
+}
+
+void FileWatcher::Close( M_PathToFileWatch::iterator watch )
+{
+    if ( watch->second.m_Event.Count() == 0 && watch->second.m_BatchEvent.Count() == 0 )
+    {
+        StopWatch( watch->first, watch->second );
+        m_Watches.erase( watch );
+    }
+}
+
+bool FileWatcher::Add( const tstring& path, FileChangedSignature::Delegate& listener, bool watchSubtree )
+{
+    FileWatch* watch = Open( path, watchSubtree );
+    if ( !watch )
+    {
+        return false;
+    }
+
+    watch->m_Event.Add( listener );
+
+    return true;
+}
+
+bool FileWatcher::Add( const tstring& path, FileChangesSignature::Delegate& listener, bool watchSubtree )
+{
+    FileWatch* watch = Open( path, watchSubtree );
+    if ( !watch )
+    {
+        return false;
+    }
+
+    watch->m_BatchEvent.Add( listener );
+
+    return true;
+}
+
+bool FileWatcher::Remove( const tstring& path, FileChangedSignature::Delegate& listener )
+{
+    M_PathToFileWatch::iterator itr = m_Watches.find( path );
+    if ( itr == m_Watches.end() )
+    {
+        return false;
+    }
+
+    itr->second.m_Event.Remove( listener );
+    Close( itr );
+
+    return true;
+}
+
+bool FileWatcher::Remove( const tstring& path, FileChangesSignature::Delegate& listener )
+{
+    M_PathToFileWatch::iterator itr = m_Watches.find( path );
+    if ( itr == m_Watches.end() )
+    {
+        return false;
+    }
+
+    itr->second.m_BatchEvent.Remove( listener );
+    Close( itr );
+
+    return true;
+}
+
+void FileWatcher::Flush()
+{
+    Deliver( true );
+}
+
+//
+// Merge a change into whatever is already pending for its path, so a burst of writes is delivered as
+//  a single change reflecting the net effect:
+//
+//  Added    + Modified -> Added        Modified + Removed  -> Removed
+//  Added    + Removed  -> (nothing)    Removed  + Added    -> Modified
+//  Renamed  + anything -> Removed old path, then the new operation as if the file were new
+//
+
+void FileWatcher::Queue( const tstring& watch, const FileChangedArgs& change )
+{
+    M_PathToFileWatch::iterator found = m_Watches.find( watch );
+    if ( found == m_Watches.end() )
+    {
+        return;
+    }
+
+    M_PendingFileChanges& pending = found->second.m_Pending;
+    u64 now = Helium::TimerGetClock();
+
+    FileChangedArgs merged = change;
+
+    if ( change.m_Operation == FileOperations::Renamed )
+    {
+        // a rename of something that changed during the window carries that change with it
+        M_PendingFileChanges::iterator source = pending.find( change.m_OldPath );
+        if ( source != pending.end() )
+        {
+            FileChangedArgs previous = source->second.m_Change;
+            pending.erase( source );
+
+            switch ( previous.m_Operation )
+            {
+            case FileOperations::Renamed:
+                {
+                    // renamed twice, report the whole move (or nothing but a change, if it came back)
+                    merged.m_OldPath = previous.m_OldPath;
+                    if ( merged.m_OldPath == merged.m_Path )
+                    {
+                        merged = FileChangedArgs( change.m_Path, FileOperations::Modified );
+                    }
+                    break;
+                }
+
+            case FileOperations::Modified:
+                {
+                    // the content changed too, so the new path needs the full treatment
+                    pending.insert( M_PendingFileChanges::value_type( change.m_OldPath, PendingFileChange( FileChangedArgs( change.m_OldPath, FileOperations::Removed ), m_Sequence++, now ) ) );
+                    merged = FileChangedArgs( change.m_Path, FileOperations::Added );
+                    break;
+                }
+
+            default:
+                {
+                    merged = FileChangedArgs( change.m_Path, FileOperations::Added );
+                    break;
+                }
+            }
+        }
+    }
+
+    M_PendingFileChanges::iterator existing = pending.find( merged.m_Path );
+    if ( existing == pending.end() )
+    {
+        pending.insert( M_PendingFileChanges::value_type( merged.m_Path, PendingFileChange( merged, m_Sequence++, now ) ) );
+        return;
+    }
+
+    PendingFileChange& entry = existing->second;
+    entry.m_Time = now;
+
+    FileOperation previous = entry.m_Change.m_Operation;
+    FileOperation next = merged.m_Operation;
+
+    if ( previous == FileOperations::Unknown || next == FileOperations::Unknown )
+    {
+        // the whole path needs rescanning, nothing more specific is worth keeping
+        entry.m_Change = FileChangedArgs( merged.m_Path, FileOperations::Unknown );
+        return;
+    }
+
+    if ( next == FileOperations::Renamed )
+    {
+        // something was moved over the top of this path
+        entry.m_Change = merged;
+        return;
+    }
+
+    if ( previous == FileOperations::Renamed )
+    {
+        // changed after being renamed, report the old path gone and this one as new
+        const tstring& oldPath = entry.m_Change.m_OldPath;
+        if ( pending.find( oldPath ) == pending.end() )
+        {
+            pending.insert( M_PendingFileChanges::value_type( oldPath, PendingFileChange( FileChangedArgs( oldPath, FileOperations::Removed ), entry.m_Sequence, now ) ) );
+        }
+
+        previous = FileOperations::Added;
+    }
+
+    switch ( previous )
+    {
+    case FileOperations::Added:
+        {
+            if ( next == FileOperations::Removed )
+            {
+                // came and went inside the window, nobody needs to know
+                pending.erase( existing );
+                return;
+            }
+
+            entry.m_Change = FileChangedArgs( merged.m_Path, FileOperations::Added );
+            break;
+        }
+
+    case FileOperations::Removed:
+        {
+            entry.m_Change = FileChangedArgs( merged.m_Path, next == FileOperations::Removed ? FileOperations::Removed : FileOperations::Modified );
+            break;
+        }
+
+    default:
+        {
+            entry.m_Change = FileChangedArgs( merged.m_Path, next == FileOperations::Removed ? FileOperations::Removed : FileOperations::Modified );
+            break;
+        }
+    }
+}
+
+static bool CompareSequence( const PendingFileChange* lhs, const PendingFileChange* rhs )
+{
+    return lhs->m_Sequence < rhs->m_Sequence;
+}
+
+void FileWatcher::Deliver( bool force )
+{
+    u64 now = Helium::TimerGetClock();
+
+    // gather everything first, listeners are free to add and remove watches while we raise
+    std::vector< std::pair< tstring, V_FileChangedArgs > > batches;
+
+    for ( M_PathToFileWatch::iterator itr = m_Watches.begin(), end = m_Watches.end(); itr != end; ++itr )
+    {
+        M_PendingFileChanges& pending = itr->second.m_Pending;
+        if ( pending.empty() )
+        {
+            continue;
+        }
+
+        std::vector< const PendingFileChange* > ready;
+        for ( M_PendingFileChanges::const_iterator change = pending.begin(), changeEnd = pending.end(); change != changeEnd; ++change )
+        {
+            if ( force || Helium::CyclesToMillis( now - change->second.m_Time ) >= m_QuietTime )
+            {
+                ready.push_back( &change->second );
+            }
+        }
+
+        if ( ready.empty() )
+        {
+            continue;
+        }
+
+        std::sort( ready.begin(), ready.end(), &CompareSequence );
+
+        batches.push_back( std::make_pair( itr->first, V_FileChangedArgs() ) );
+        V_FileChangedArgs& changes = batches.back().second;
+        changes.reserve( ready.size() );
+
+        for ( std::vector< const PendingFileChange* >::const_iterator change = ready.begin(), changeEnd = ready.end(); change != changeEnd; ++change )
+        {
+            changes.push_back( (*change)->m_Change );
+        }
+
+        for ( V_FileChangedArgs::const_iterator change = changes.begin(), changeEnd = changes.end(); change != changeEnd; ++change )
+        {
+            pending.erase( change->m_Path );
+        }
+    }
+
+    for ( std::vector< std::pair< tstring, V_FileChangedArgs > >::const_iterator batch = batches.begin(), batchEnd = batches.end(); batch != batchEnd; ++batch )
+    {
+        M_PathToFileWatch::iterator watch = m_Watches.find( batch->first );
+        if ( watch == m_Watches.end() )
+        {
+            continue;
+        }
+
+        watch->second.m_BatchEvent.Raise( batch->second );
+
+        // the watch may have gone away while the batch listeners ran
+        watch = m_Watches.find( batch->first );
+        if ( watch == m_Watches.end() )
+        {
+            continue;
+        }
+
+        for ( V_FileChangedArgs::const_iterator change = batch->second.begin(), changeEnd = batch->second.end(); change != changeEnd; ++change )
+        {
+            watch->second.m_Event.Raise( *change );
+        }
+    }
+}
+
+int FileWatcher::GetWaitTimeout( int timeout )
+{
+    u64 now = Helium::TimerGetClock();
+
+    // wake up in time to deliver the first change that goes quiet
+    for ( M_PathToFileWatch::const_iterator itr = m_Watches.begin(), end = m_Watches.end(); itr != end; ++itr )
+    {
+        for ( M_PendingFileChanges::const_iterator change = itr->second.m_Pending.begin(), changeEnd = itr->second.m_Pending.end(); change != changeEnd; ++change )
+        {
+            f32 elapsed = Helium::CyclesToMillis( now - change->second.m_Time );
+            int remaining = elapsed >= m_QuietTime ? 0 : (int)( m_QuietTime - elapsed ) + 1;
+
+            if ( timeout < 0 || remaining < timeout )
+            {
+                timeout = remaining;
+            }
+        }
+    }
+
+    // and in time for the scanner to do its next bit of work
+    if ( !m_Scanned.empty() )
+    {
+        int remaining = 0;
+
+        f32 budget = m_ScanBudget + Helium::CyclesToMillis( now - m_ScanClock ) * m_ScanRate / 1000.f;
+        if ( budget <= 0.f )
+        {
+            // wait until the debt is paid off, and then some, so we don't wake for every single operation
+            remaining = (int)( -budget * 1000.f / m_ScanRate ) + FILE_WATCHER_SCAN_GRANULARITY;
+        }
+        else if ( m_ScanQueue.empty() )
+        {
+            f32 elapsed = Helium::CyclesToMillis( now - m_ScanPassClock );
+            remaining = elapsed >= m_ScanInterval ? 0 : (int)( m_ScanInterval - elapsed ) + 1;
+        }
+
+        if ( timeout < 0 || remaining < timeout )
+        {
+            timeout = remaining;
+        }
+    }
+
+    return timeout;
+}
+
+//
+// Fallback scanning: once the native watch limits (64 wait handles on windows, the per-user inotify
+//  watch limit on linux) run out, the remaining directories are indexed and periodically rescanned.
+//  Every indexed directory is stat'd each pass, but only those whose modification time moved are
+//  listed again; in unchanged directories just the known files are stat'd to catch in place writes.
+//  Each stat or listed entry costs one operation, and operations are paid for out of a budget that
+//  refills at m_ScanRate per second, so a large tree is spread out rather than hammering the disk.
+//
+
+void FileWatcher::AddScannedDirectory( const tstring& watch, const tstring& directory, bool reportContents )
+{
+    std::pair< M_ScannedDirectories::iterator, bool > inserted = m_Scanned.insert( M_ScannedDirectories::value_type( directory, ScannedDirectory() ) );
+
+    ScannedDirectory& scanned = inserted.first->second;
+    scanned.m_Watch = watch;
+    scanned.m_Report = reportContents;
+
+    if ( inserted.second )
+    {
+        // index it as soon as the budget allows rather than waiting for the next pass
+        m_ScanQueue.push_back( directory );
+    }
+}
+
+static bool StartsWith( const tstring& path, const tstring& prefix )
+{
+    return path.compare( 0, prefix.length(), prefix ) == 0;
+}
+
+void FileWatcher::RemoveScannedDirectories( const tstring& watch, const tstring& directory )
+{
+    M_ScannedDirectories::iterator itr = m_Scanned.lower_bound( directory );
+    while ( itr != m_Scanned.end() && StartsWith( itr->first, directory ) )
+    {
+        if ( itr->second.m_Watch == watch )
+        {
+            m_Scanned.erase( itr++ );
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+}
+
+void FileWatcher::MoveScannedDirectories( const tstring& oldDirectory, const tstring& newDirectory )
+{
+    M_ScannedDirectories moved;
+
+    M_ScannedDirectories::iterator itr = m_Scanned.lower_bound( oldDirectory );
+    while ( itr != m_Scanned.end() && StartsWith( itr->first, oldDirectory ) )
+    {
+        tstring directory = newDirectory + itr->first.substr( oldDirectory.length() );
+        moved.insert( M_ScannedDirectories::value_type( directory, itr->second ) );
+        m_Scanned.erase( itr++ );
+    }
+
+    m_Scanned.insert( moved.begin(), moved.end() );
+}
+
+void FileWatcher::Scan()
+{
+    if ( m_Scanned.empty() )
+    {
+        m_ScanQueue.clear();
+        return;
+    }
+
+    // refill the budget, but never bank more than a second's worth
+    u64 now = Helium::TimerGetClock();
+    m_ScanBudget += Helium::CyclesToMillis( now - m_ScanClock ) * m_ScanRate / 1000.f;
+    if ( m_ScanBudget > (f32)m_ScanRate )
+    {
+        m_ScanBudget = (f32)m_ScanRate;
+    }
+    m_ScanClock = now;
+
+    while ( m_ScanBudget > 0.f )
+    {
+        if ( m_ScanQueue.empty() )
+        {
+            if ( Helium::CyclesToMillis( now - m_ScanPassClock ) < m_ScanInterval )
+            {
+                break;
+            }
+
+            // the map is sorted, so parents are visited before their children
+            m_ScanPassClock = now;
+            for ( M_ScannedDirectories::const_iterator itr = m_Scanned.begin(), end = m_Scanned.end(); itr != end; ++itr )
+            {
+                m_ScanQueue.push_back( itr->first );
+            }
+        }
+
+        tstring directory = m_ScanQueue.front();
+        m_ScanQueue.pop_front();
+
+        m_ScanBudget -= ScanDirectory( directory );
+    }
+}
+
+// a directory modified within the last second may change again without its stat'd time moving
+static bool IsRacy( u64 modifiedTime )
+{
+    return modifiedTime + 1 >= (u64)time( NULL );
+}
+
+u32 FileWatcher::ScanDirectory( const tstring& directory )
+{
+    M_ScannedDirectories::iterator found = m_Scanned.find( directory );
+    if ( found == m_Scanned.end() )
+    {
+        // removed since it was queued
+        return 0;
+    }
+
+    ScannedDirectory& scanned = found->second;
+
+    Helium::Stat stat;
+    if ( !Helium::StatPath( directory.c_str(), stat ) || !( stat.m_Mode & ModeFlags::Directory ) )
+    {
+        // gone, whoever contains it reports that
+        tstring watch = scanned.m_Watch;
+        RemoveScannedDirectories( watch, directory );
+        return 1;
+    }
+
+    if ( !scanned.m_Listed || stat.m_ModifiedTime != scanned.m_ModifiedTime )
+    {
+        // if it was touched within the last second, look again next pass in case it is touched again
+        scanned.m_ModifiedTime = IsRacy( stat.m_ModifiedTime ) ? 0 : stat.m_ModifiedTime;
+        return 1 + ListDirectory( directory, scanned );
+    }
+
+    u32 cost = 1;
+
+    M_ScannedFiles::iterator itr = scanned.m_Files.begin();
+    while ( itr != scanned.m_Files.end() )
+    {
+        tstring path = directory + itr->first;
+
+        Helium::Stat fileStat;
+        ++cost;
+
+        if ( !Helium::StatPath( path.c_str(), fileStat ) )
+        {
+            // removed within the same second as another change to the directory
+            Queue( scanned.m_Watch, FileChangedArgs( path, FileOperations::Removed ) );
+            scanned.m_Files.erase( itr++ );
+            continue;
+        }
+
+        if ( fileStat.m_ModifiedTime != itr->second.m_ModifiedTime || fileStat.m_Size != itr->second.m_Size )
+        {
+            Queue( scanned.m_Watch, FileChangedArgs( path, FileOperations::Modified ) );
+            itr->second.m_ModifiedTime = fileStat.m_ModifiedTime;
+            itr->second.m_Size = fileStat.m_Size;
+        }
+
+        ++itr;
+    }
+
+    return cost;
+}
+
+u32 FileWatcher::ListDirectory( const tstring& directory, ScannedDirectory& scanned )
+{
+    bool report = scanned.m_Listed || scanned.m_Report;
+    bool watchSubtree = false;
+
+    M_PathToFileWatch::const_iterator watch = m_Watches.find( scanned.m_Watch );
+    if ( watch != m_Watches.end() )
+    {
+        watchSubtree = watch->second.m_WatchSubtree;
+    }
+
+    std::set< tstring > present;
+    u32 cost = 0;
+
+    try
+    {
+        for ( Directory dir( directory, TXT( "*" ), DirectoryFlags::RelativePath | DirectoryFlags::NoStat ); !dir.IsDone(); dir.Next() )
+        {
+            const DirectoryItem& item = dir.GetItem();
+            tstring path = directory + item.m_Path;
+
+            present.insert( item.m_Path );
+            ++cost;
+
+            if ( item.m_Flags & DirectoryItemFlags::Directory )
+            {
+                if ( scanned.m_Directories.insert( item.m_Path ).second )
+                {
+                    if ( report )
+                    {
+                        Queue( scanned.m_Watch, FileChangedArgs( path, FileOperations::Added ) );
+                    }
+
+                    if ( watchSubtree )
+                    {
+                        AddScannedDirectory( scanned.m_Watch, path, report );
+                    }
+                }
+
+                continue;
+            }
+
+            Helium::Stat stat;
+            ++cost;
+
+            if ( !Helium::StatPath( path.c_str(), stat ) )
+            {
+                continue;
+            }
+
+            M_ScannedFiles::iterator file = scanned.m_Files.find( item.m_Path );
+            if ( file == scanned.m_Files.end() )
+            {
+                ScannedFile& added = scanned.m_Files[ item.m_Path ];
+                added.m_ModifiedTime = stat.m_ModifiedTime;
+                added.m_Size = stat.m_Size;
+
+                if ( report )
+                {
+                    Queue( scanned.m_Watch, FileChangedArgs( path, FileOperations::Added ) );
+                }
+            }
+            else if ( stat.m_ModifiedTime != file->second.m_ModifiedTime || stat.m_Size != file->second.m_Size )
+            {
+                file->second.m_ModifiedTime = stat.m_ModifiedTime;
+                file->second.m_Size = stat.m_Size;
+
+                Queue( scanned.m_Watch, FileChangedArgs( path, FileOperations::Modified ) );
+            }
+        }
+    }
+    catch ( const Helium::Exception& ex )
+    {
+        // leave the index as it was and try again next pass
+        Log::Warning( TXT( "Failed to scan '%s' for changes: %s\n" ), directory.c_str(), ex.What() );
+        scanned.m_ModifiedTime = 0;
+        return cost;
+    }
+
+    M_ScannedFiles::iterator file = scanned.m_Files.begin();
+    while ( file != scanned.m_Files.end() )
+    {
+        if ( present.find( file->first ) == present.end() )
+        {
+            Queue( scanned.m_Watch, FileChangedArgs( directory + file->first, FileOperations::Removed ) );
+            scanned.m_Files.erase( file++ );
+        }
+        else
+        {
+            ++file;
+        }
+    }
+
+    std::set< tstring >::iterator subdirectory = scanned.m_Directories.begin();
+    while ( subdirectory != scanned.m_Directories.end() )
+    {
+        if ( present.find( *subdirectory ) == present.end() )
+        {
+            tstring path = directory + *subdirectory;
+            Queue( scanned.m_Watch, FileChangedArgs( path, FileOperations::Removed ) );
+            RemoveScannedDirectories( scanned.m_Watch, path );
+            scanned.m_Directories.erase( subdirectory++ );
+        }
+        else
+        {
+            ++subdirectory;
+        }
+    }
+
+    scanned.m_Listed = true;
+
+    return cost;
+}
+
+#ifdef WIN32
+
 void EmitLastError()
 {
     DWORD error = GetLastError();
@@ -27,6 +664,13 @@ void EmitLastError()
 }
 
 FileWatcher::FileWatcher()
+: m_QuietTime( 0 )
+, m_Sequence( 0 )
+, m_ScanRate( FILE_WATCHER_SCAN_RATE )
+, m_ScanInterval( FILE_WATCHER_SCAN_INTERVAL )
+, m_ScanBudget( 0.f )
+, m_ScanClock( Helium::TimerGetClock() )
+, m_ScanPassClock( 0 )
 {
 }
 
@@ -34,76 +678,99 @@ FileWatcher::~FileWatcher()
 {
 }
 
-bool FileWatcher::Add( const tstring& path, FileChangedSignature::Delegate& listener, bool watchSubtree )
+bool FileWatcher::StartWatch( const tstring& path, FileWatch& watch )
 {
-    M_PathToFileWatch::const_iterator itr = m_Watches.find( path );
+    u32 handles = 0;
+    for ( M_PathToFileWatch::const_iterator itr = m_Watches.begin(), end = m_Watches.end(); itr != end; ++itr )
+    {
+        if ( itr->second.m_ChangeHandle )
+        {
+            ++handles;
+        }
+    }
 
-    if ( itr == m_Watches.end() )
+    if ( handles >= MAXIMUM_WAIT_OBJECTS )
     {
+        // WaitForMultipleObjects can't take any more, fall back to scanning this one
+        Log::Warning( TXT( "Too many file watches, scanning '%s' for changes instead\n" ), watch.m_Path.c_str() );
 
-        m_Watches[ path ].m_Path.Set( path );
-        m_Watches[ path ].m_ChangeHandle = FindFirstChangeNotification( 
-            m_Watches[ path ].m_Path.c_str(),
-            watchSubtree,
-            FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE ); // watch for writes
+        tstring directory = watch.m_Path.Get();
+        Path::GuaranteeSeparator( directory );
+        AddScannedDirectory( path, directory, false );
 
+        return true;
+    }
 
-        if ( m_Watches[ path ].m_ChangeHandle == NULL || m_Watches[ path ].m_ChangeHandle == INVALID_HANDLE_VALUE )
-        {
-            EmitLastError();
+    watch.m_ChangeHandle = FindFirstChangeNotification( 
+        watch.m_Path.c_str(),
+        watch.m_WatchSubtree,
+        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE ); // watch for writes
 
-            m_Watches.erase( path );
-            return false;
-        }
+    if ( watch.m_ChangeHandle == NULL || watch.m_ChangeHandle == INVALID_HANDLE_VALUE )
+    {
+        EmitLastError();
+        return false;
     }
 
-    m_Watches[ path ].m_Event.Add( listener );
-
     return true;
 }
 
-bool FileWatcher::Remove( const tstring& path, FileChangedSignature::Delegate& listener )
+void FileWatcher::StopWatch( const tstring& path, FileWatch& watch )
 {
-    m_Watches[ path ].m_Event.Remove( listener );
-
-    if ( m_Watches[ path ].m_Event.Count() == 0 )
+    if ( watch.m_ChangeHandle )
     {
-        FindCloseChangeNotification( m_Watches[ path ].m_ChangeHandle );
-        m_Watches.erase( path );
+        FindCloseChangeNotification( watch.m_ChangeHandle );
+    }
+    else
+    {
+        tstring directory = watch.m_Path.Get();
+        Path::GuaranteeSeparator( directory );
+        RemoveScannedDirectories( path, directory );
     }
-
-    return true;
 }
 
 bool FileWatcher::Watch( int timeout )
 {
     HANDLE changeHandles[ MAXIMUM_WAIT_OBJECTS ];
     //    FILE_NOTIFY_INFORMATION notificationInformation[1024];
-    FileWatch* watches[ MAXIMUM_WAIT_OBJECTS ];
+    M_PathToFileWatch::iterator watches[ MAXIMUM_WAIT_OBJECTS ];
 
     for ( u32 i = 0; i < MAXIMUM_WAIT_OBJECTS; ++i )
     {
         changeHandles[ i ] = NULL;
-        watches[ i ] = NULL;
     }
 
     u32 handleIndex = 0;
-    for ( M_PathToFileWatch::iterator itr = m_Watches.begin(), end = m_Watches.end(); itr != end; ++itr )
+    for ( M_PathToFileWatch::iterator itr = m_Watches.begin(), end = m_Watches.end(); itr != end && handleIndex < MAXIMUM_WAIT_OBJECTS; ++itr )
     {
-        changeHandles[ handleIndex ] = (*itr).second.m_ChangeHandle;
-        watches[ handleIndex ] = &( (*itr).second );
-        ++handleIndex;
+        // scanned watches have no handle
+        if ( (*itr).second.m_ChangeHandle )
+        {
+            changeHandles[ handleIndex ] = (*itr).second.m_ChangeHandle;
+            watches[ handleIndex ] = itr;
+            ++handleIndex;
+        }
     }
 
     if ( handleIndex == 0 )
     {
-        // nothing to watch
+        if ( m_Scanned.empty() )
+        {
+            // nothing to watch
+            return true;
+        }
+
+        Sleep( GetWaitTimeout( timeout ) );
+        Scan();
+        Deliver( false );
         return true;
     }
 
-    DWORD changedObject = WaitForMultipleObjects( handleIndex, changeHandles, FALSE, timeout );
+    DWORD changedObject = WaitForMultipleObjects( handleIndex, changeHandles, FALSE, GetWaitTimeout( timeout ) );
     if ( changedObject == WAIT_TIMEOUT )
     {
+        Scan();
+        Deliver( false );
         return true;
     }
 
@@ -113,14 +780,13 @@ bool FileWatcher::Watch( int timeout )
         return false;
     }
 
-    FileWatch* watch = watches[ changedObject ];
+    M_PathToFileWatch::iterator watch = watches[ changedObject ];
 
     //memset( notificationInformation, 0, sizeof( notificationInformation ) );
     //LPDWORD bytesReturned = 0;
     //ReadDirectoryChangesW( handleIndex, &notificationInformation, sizeof(notificationInformation), watch->m_WatchSubtree, FILE_NOTIFY_ALL, &bytesReturned, NULL, NULL );  
 
-    FileChangedArgs changeEvent( watch->m_Path.c_str(), FileOperations::Unknown );
-    watch->m_Event.Raise( changeEvent );
+    Queue( watch->first, FileChangedArgs( watch->second.m_Path.c_str(), FileOperations::Unknown ) );
 
     if ( FindNextChangeNotification( changeHandles[ changedObject ] ) == FALSE )
     {
@@ -128,5 +794,410 @@ bool FileWatcher::Watch( int timeout )
         return false;
     }
 
+    Scan();
+    Deliver( false );
+
+    return true;
+}
+
+#else // WIN32
+
+//
+// inotify backend: every directory in a watched tree gets its own watch descriptor, events carry the
+//  file name so we can report the exact operation and path rather than just "something changed"
+//
+
+static const u32 s_NotifyMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+FileWatcher::FileWatcher()
+: m_QuietTime( 0 )
+, m_Sequence( 0 )
+, m_ScanRate( FILE_WATCHER_SCAN_RATE )
+, m_ScanInterval( FILE_WATCHER_SCAN_INTERVAL )
+, m_ScanBudget( 0.f )
+, m_ScanClock( Helium::TimerGetClock() )
+, m_ScanPassClock( 0 )
+{
+    m_Notify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if ( m_Notify < 0 )
+    {
+        Log::Error( TXT( "Failed to create inotify instance: %s\n" ), strerror( errno ) );
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    if ( m_Notify >= 0 )
+    {
+        close( m_Notify );
+    }
+}
+
+bool FileWatcher::StartWatch( const tstring& path, FileWatch& watch )
+{
+    if ( m_Notify < 0 )
+    {
+        return false;
+    }
+
+    tstring directory = watch.m_Path.Get();
+    Path::GuaranteeSeparator( directory );
+
+    if ( !AddDirectory( path, directory, watch.m_WatchSubtree, false ) )
+    {
+        RemoveDirectories( path, directory );
+        return false;
+    }
+
+    return true;
+}
+
+void FileWatcher::StopWatch( const tstring& path, FileWatch& watch )
+{
+    tstring directory = watch.m_Path.Get();
+    Path::GuaranteeSeparator( directory );
+
+    RemoveDirectories( path, directory );
+}
+
+bool FileWatcher::AddDirectory( const tstring& watch, const tstring& directory, bool watchSubtree, bool reportContents )
+{
+    int descriptor = inotify_add_watch( m_Notify, directory.c_str(), s_NotifyMask );
+    if ( descriptor < 0 )
+    {
+        // the directory may have been deleted before we got to it, we will hear about that from its parent
+        if ( errno == ENOENT )
+        {
+            return true;
+        }
+
+        // out of watches (see fs.inotify.max_user_watches), fall back to scanning this subtree
+        if ( errno == ENOSPC || errno == ENOMEM )
+        {
+            Log::Warning( TXT( "Out of inotify watches, scanning '%s' for changes instead\n" ), directory.c_str() );
+            AddScannedDirectory( watch, directory, reportContents );
+            return true;
+        }
+
+        Log::Error( TXT( "Failed to watch '%s': %s\n" ), directory.c_str(), strerror( errno ) );
+        return false;
+    }
+
+    // overlapping watches share descriptors, each one holds a reference until it is removed
+    NotifyDirectory& notifyDirectory = m_Directories[ descriptor ];
+    notifyDirectory.m_Path = directory;
+    notifyDirectory.m_Owners.insert( watch );
+
+    if ( !watchSubtree && !reportContents )
+    {
+        return true;
+    }
+
+    DIR* handle = opendir( directory.c_str() );
+    if ( !handle )
+    {
+        return true;
+    }
+
+    bool result = true;
+    while ( dirent* entry = readdir( handle ) )
+    {
+        if ( strcmp( entry->d_name, "." ) == 0 || strcmp( entry->d_name, ".." ) == 0 )
+        {
+            continue;
+        }
+
+        tstring path = directory + entry->d_name;
+
+        bool isDirectory = entry->d_type == DT_DIR;
+        if ( entry->d_type == DT_UNKNOWN )
+        {
+            struct stat info;
+            isDirectory = lstat( path.c_str(), &info ) == 0 && S_ISDIR( info.st_mode );
+        }
+
+        if ( isDirectory )
+        {
+            path += s_InternalPathSeparator;
+        }
+
+        // this directory appeared after we started watching its parent, so anything already in it was missed
+        if ( reportContents )
+        {
+            Queue( watch, FileChangedArgs( path, FileOperations::Added ) );
+        }
+
+        if ( isDirectory && watchSubtree )
+        {
+            result &= AddDirectory( watch, path, watchSubtree, reportContents );
+        }
+    }
+
+    closedir( handle );
+
+    return result;
+}
+
+void FileWatcher::RemoveDirectories( const tstring& watch, const tstring& directory )
+{
+    M_NotifyDirectories::iterator itr = m_Directories.begin();
+    while ( itr != m_Directories.end() )
+    {
+        if ( StartsWith( itr->second.m_Path, directory ) && itr->second.m_Owners.erase( watch ) && itr->second.m_Owners.empty() )
+        {
+            inotify_rm_watch( m_Notify, itr->first );
+            m_Directories.erase( itr++ );
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+
+    RemoveScannedDirectories( watch, directory );
+}
+
+void FileWatcher::MoveDirectories( const tstring& oldDirectory, const tstring& newDirectory )
+{
+    // descriptors follow the directory, so just fix up the paths we report for them
+    for ( M_NotifyDirectories::iterator itr = m_Directories.begin(), end = m_Directories.end(); itr != end; ++itr )
+    {
+        if ( StartsWith( itr->second.m_Path, oldDirectory ) )
+        {
+            itr->second.m_Path.replace( 0, oldDirectory.length(), newDirectory );
+        }
+    }
+
+    MoveScannedDirectories( oldDirectory, newDirectory );
+}
+
+bool FileWatcher::Watch( int timeout )
+{
+    if ( m_Notify < 0 )
+    {
+        return false;
+    }
+
+    if ( m_Watches.empty() )
+    {
+        // nothing to watch
+        return true;
+    }
+
+    pollfd notify;
+    notify.fd = m_Notify;
+    notify.events = POLLIN;
+    notify.revents = 0;
+
+    int ready = poll( &notify, 1, GetWaitTimeout( timeout ) );
+    if ( ready == 0 || ( ready < 0 && errno == EINTR ) )
+    {
+        Scan();
+        Deliver( false );
+        return true;
+    }
+
+    if ( ready < 0 )
+    {
+        Log::Error( TXT( "Failed to wait for file changes: %s\n" ), strerror( errno ) );
+        return false;
+    }
+
+    // the first half of a rename, waiting to be paired with its IN_MOVED_TO
+    struct PendingMove
+    {
+        u32                 m_Cookie;
+        tstring             m_Path;
+        std::set< tstring > m_Owners;
+        bool                m_Directory;
+    } move;
+    move.m_Cookie = 0;
+
+    char buffer[ 64 * 1024 ] __attribute__(( aligned( __alignof__( inotify_event ) ) ));
+
+    while ( true )
+    {
+        ssize_t length = read( m_Notify, buffer, sizeof( buffer ) );
+        if ( length < 0 && errno == EINTR )
+        {
+            continue;
+        }
+
+        if ( length <= 0 )
+        {
+            break;
+        }
+
+        for ( char* cursor = buffer; cursor < buffer + length; )
+        {
+            const inotify_event* event = (const inotify_event*)cursor;
+            cursor += sizeof( inotify_event ) + event->len;
+
+            if ( event->mask & IN_Q_OVERFLOW )
+            {
+                // we lost events, all anyone can do is rescan
+                Log::Warning( TXT( "File change queue overflowed, changes have been lost\n" ) );
+                for ( M_PathToFileWatch::iterator itr = m_Watches.begin(), end = m_Watches.end(); itr != end; ++itr )
+                {
+                    Queue( itr->first, FileChangedArgs( itr->second.m_Path.Get(), FileOperations::Unknown ) );
+                }
+                continue;
+            }
+
+            M_NotifyDirectories::iterator found = m_Directories.find( event->wd );
+            if ( found == m_Directories.end() )
+            {
+                continue;
+            }
+
+            if ( event->mask & IN_IGNORED )
+            {
+                // the directory was deleted, or we removed the watch
+                m_Directories.erase( found );
+                continue;
+            }
+
+            // copy, since handling the event can change m_Directories
+            NotifyDirectory directory = found->second;
+            bool isDirectory = ( event->mask & IN_ISDIR ) != 0;
+
+            tstring path = directory.m_Path;
+            if ( event->len )
+            {
+                path += event->name;
+                if ( isDirectory )
+                {
+                    path += s_InternalPathSeparator;
+                }
+            }
+
+            // an IN_MOVED_FROM not immediately followed by its IN_MOVED_TO left our watched directories
+            if ( move.m_Cookie && !( ( event->mask & IN_MOVED_TO ) && event->cookie == move.m_Cookie ) )
+            {
+                for ( std::set< tstring >::const_iterator owner = move.m_Owners.begin(), end = move.m_Owners.end(); owner != end; ++owner )
+                {
+                    if ( move.m_Directory )
+                    {
+                        RemoveDirectories( *owner, move.m_Path );
+                    }
+
+                    Queue( *owner, FileChangedArgs( move.m_Path, FileOperations::Removed ) );
+                }
+
+                move.m_Cookie = 0;
+            }
+
+            if ( event->mask & IN_MOVED_FROM )
+            {
+                move.m_Cookie = event->cookie;
+                move.m_Path = path;
+                move.m_Owners = directory.m_Owners;
+                move.m_Directory = isDirectory;
+                continue;
+            }
+
+            if ( ( event->mask & IN_MOVED_TO ) && move.m_Cookie )
+            {
+                // watches that only saw the source lost the item, the rest see a rename
+                for ( std::set< tstring >::const_iterator owner = move.m_Owners.begin(), end = move.m_Owners.end(); owner != end; ++owner )
+                {
+                    if ( directory.m_Owners.find( *owner ) == directory.m_Owners.end() )
+                    {
+                        if ( move.m_Directory )
+                        {
+                            RemoveDirectories( *owner, move.m_Path );
+                        }
+
+                        Queue( *owner, FileChangedArgs( move.m_Path, FileOperations::Removed ) );
+                    }
+                }
+
+                if ( isDirectory )
+                {
+                    MoveDirectories( move.m_Path, path );
+                }
+            }
+
+            for ( std::set< tstring >::const_iterator owner = directory.m_Owners.begin(), end = directory.m_Owners.end(); owner != end; ++owner )
+            {
+                // the watch was removed, but its events were already queued
+                M_PathToFileWatch::const_iterator watch = m_Watches.find( *owner );
+                if ( watch == m_Watches.end() )
+                {
+                    continue;
+                }
+
+                bool watchSubtree = watch->second.m_WatchSubtree;
+
+                if ( event->mask & IN_CREATE )
+                {
+                    Queue( *owner, FileChangedArgs( path, FileOperations::Added ) );
+
+                    if ( isDirectory && watchSubtree )
+                    {
+                        AddDirectory( *owner, path, true, true );
+                    }
+                }
+                else if ( event->mask & IN_DELETE )
+                {
+                    Queue( *owner, FileChangedArgs( path, FileOperations::Removed ) );
+                }
+                else if ( event->mask & ( IN_MODIFY | IN_CLOSE_WRITE ) )
+                {
+                    // writes arrive as a burst of IN_MODIFY, Queue coalesces them into one change
+                    Queue( *owner, FileChangedArgs( path, FileOperations::Modified ) );
+                }
+                else if ( event->mask & IN_MOVED_TO )
+                {
+                    if ( move.m_Cookie && move.m_Owners.find( *owner ) != move.m_Owners.end() )
+                    {
+                        Queue( *owner, FileChangedArgs( path, FileOperations::Renamed, move.m_Path ) );
+                    }
+                    else
+                    {
+                        // moved in from another watch, or from outside anything we are watching
+                        Queue( *owner, FileChangedArgs( path, FileOperations::Added ) );
+
+                        if ( isDirectory && watchSubtree )
+                        {
+                            AddDirectory( *owner, path, true, true );
+                        }
+                    }
+                }
+                else if ( event->mask & IN_DELETE_SELF )
+                {
+                    // the parent reports deletes of subdirectories, only the root needs reporting here
+                    if ( StartsWith( watch->second.m_Path.Get(), directory.m_Path.substr( 0, directory.m_Path.length() - 1 ) ) )
+                    {
+                        Queue( *owner, FileChangedArgs( directory.m_Path, FileOperations::Removed ) );
+                    }
+                }
+            }
+
+            if ( event->mask & IN_MOVED_TO )
+            {
+                move.m_Cookie = 0;
+            }
+        }
+    }
+
+    if ( move.m_Cookie )
+    {
+        for ( std::set< tstring >::const_iterator owner = move.m_Owners.begin(), end = move.m_Owners.end(); owner != end; ++owner )
+        {
+            if ( move.m_Directory )
+            {
+                RemoveDirectories( *owner, move.m_Path );
+            }
+
+            Queue( *owner, FileChangedArgs( move.m_Path, FileOperations::Removed ) );
+        }
+    }
+
+    Scan();
+    Deliver( false );
+
     return true;
 }
+
+#endif // WIN32
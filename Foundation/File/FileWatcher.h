@@ -1,12 +1,24 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <deque>
+#include <vector>
 
 #include "Foundation/API.h"
 #include "Foundation/Automation/Event.h"
 
 #include "Path.h"
 
+// default number of stats and directory entries per second the fallback scanner may touch
+#define FILE_WATCHER_SCAN_RATE          500
+
+// default milliseconds between the starts of fallback scan passes
+#define FILE_WATCHER_SCAN_INTERVAL      5000
+
+// minimum milliseconds the fallback scanner sleeps between bursts of work
+#define FILE_WATCHER_SCAN_GRANULARITY   10
+
 namespace Helium
 {
     namespace FileOperations
@@ -39,13 +51,34 @@ namespace Helium
     };
     typedef Helium::Signature< const FileChangedArgs& > FileChangedSignature;
 
+    typedef std::vector< FileChangedArgs > V_FileChangedArgs;
+    typedef Helium::Signature< const V_FileChangedArgs& > FileChangesSignature;
+
+    // a change waiting out the quiet time before it is delivered, later events for the same path merge into it
+    struct FOUNDATION_API PendingFileChange
+    {
+        FileChangedArgs m_Change;
+        u64             m_Sequence; // when the path first changed, batches are delivered in this order
+        u64             m_Time;     // clock of the most recent event for the path
+
+        PendingFileChange( const FileChangedArgs& change, u64 sequence, u64 time )
+            : m_Change( change )
+            , m_Sequence( sequence )
+            , m_Time( time )
+        {
+        }
+    };
+    typedef std::map< tstring, PendingFileChange > M_PendingFileChanges;
+
     typedef void* HANDLE;
     struct FOUNDATION_API FileWatch
     {
         HANDLE                      m_ChangeHandle;
         FileChangedSignature::Event m_Event;
+        FileChangesSignature::Event m_BatchEvent;
         Path                        m_Path;
         bool                        m_WatchSubtree;
+        M_PendingFileChanges        m_Pending;
 
 
         FileWatch()
@@ -57,19 +90,125 @@ namespace Helium
 
     typedef std::map< tstring, FileWatch > M_PathToFileWatch;
 
+    // a file in a scanned directory, as it looked the last time we checked
+    struct FOUNDATION_API ScannedFile
+    {
+        u64 m_ModifiedTime;
+        i64 m_Size;
+
+        ScannedFile()
+            : m_ModifiedTime( 0 )
+            , m_Size( 0 )
+        {
+        }
+    };
+    typedef std::map< tstring, ScannedFile > M_ScannedFiles;
+
+    // a directory we could not get native notifications for, indexed so periodic scans can find what changed
+    struct FOUNDATION_API ScannedDirectory
+    {
+        tstring             m_Watch;            // key of the FileWatch in m_Watches that owns this directory
+        u64                 m_ModifiedTime;     // the listing is only re-read when this changes
+        bool                m_Listed;           // false until the first listing
+        bool                m_Report;           // report the contents found by the first listing as added
+        M_ScannedFiles      m_Files;            // file name -> last known state
+        std::set< tstring > m_Directories;      // subdirectory names, with a trailing separator
+
+        ScannedDirectory()
+            : m_ModifiedTime( 0 )
+            , m_Listed( false )
+            , m_Report( false )
+        {
+        }
+    };
+    typedef std::map< tstring, ScannedDirectory > M_ScannedDirectories;
+
     typedef void* HANDLE;
 
     class FOUNDATION_API FileWatcher
     {
     private:
         M_PathToFileWatch m_Watches;
+        u32               m_QuietTime;  // milliseconds a path must go unchanged before its change is delivered
+        u64               m_Sequence;
+
+        // directories beyond the native watch limits, scanned instead
+        M_ScannedDirectories    m_Scanned;
+        std::deque< tstring >   m_ScanQueue;        // directories left to visit this pass
+        u32                     m_ScanRate;
+        u32                     m_ScanInterval;
+        f32                     m_ScanBudget;       // operations we may spend now, negative while paying off a large listing
+        u64                     m_ScanClock;
+        u64                     m_ScanPassClock;
+
+#ifndef WIN32
+        // a directory watched through inotify, one per directory in a watched subtree
+        struct NotifyDirectory
+        {
+            tstring             m_Path;     // directory path, with a trailing separator
+            std::set< tstring > m_Owners;   // keys of the FileWatches in m_Watches that cover this directory
+        };
+        typedef std::map< int, NotifyDirectory > M_NotifyDirectories;
+
+        int                 m_Notify;       // inotify instance
+        M_NotifyDirectories m_Directories;  // watch descriptor -> directory
+#endif
 
     public:
         FileWatcher();
         ~FileWatcher();
 
         bool Add( const tstring& path, FileChangedSignature::Delegate& listener, bool watchSubtree = false  );
+        bool Add( const tstring& path, FileChangesSignature::Delegate& listener, bool watchSubtree = false  );
         bool Remove( const tstring& path, FileChangedSignature::Delegate& listener );
+        bool Remove( const tstring& path, FileChangesSignature::Delegate& listener );
         bool Watch( int timeout = 0xFFFFFFFF );
+
+        // changes to a path are held until it has been quiet this long, then delivered merged into one
+        void SetQuietTime( u32 milliseconds )
+        {
+            m_QuietTime = milliseconds;
+        }
+        u32 GetQuietTime() const
+        {
+            return m_QuietTime;
+        }
+
+        // deliver everything pending without waiting for the quiet time
+        void Flush();
+
+        // once the native watch limits are exhausted, directories are scanned for changes instead;
+        //  the rate caps how many entries per second the scan may touch so it stays in the background
+        void SetScanRate( u32 operationsPerSecond )
+        {
+            m_ScanRate = operationsPerSecond ? operationsPerSecond : 1;
+        }
+        void SetScanInterval( u32 milliseconds )
+        {
+            m_ScanInterval = milliseconds;
+        }
+
+    private:
+        FileWatch* Open( const tstring& path, bool watchSubtree );
+        void Close( M_PathToFileWatch::iterator watch );
+        bool StartWatch( const tstring& path, FileWatch& watch );
+        void StopWatch( const tstring& path, FileWatch& watch );
+
+        void Queue( const tstring& watch, const FileChangedArgs& change );
+        void Deliver( bool force );
+        int GetWaitTimeout( int timeout );
+
+        void AddScannedDirectory( const tstring& watch, const tstring& directory, bool reportContents );
+        void RemoveScannedDirectories( const tstring& watch, const tstring& directory );
+        void MoveScannedDirectories( const tstring& oldDirectory, const tstring& newDirectory );
+        void Scan();
+        u32 ScanDirectory( const tstring& directory );
+        u32 ListDirectory( const tstring& directory, ScannedDirectory& scanned );
+
+#ifndef WIN32
+        bool AddDirectory( const tstring& watch, const tstring& directory, bool watchSubtree, bool reportContents );
+        void RemoveDirectories( const tstring& watch, const tstring& directory );
+        void MoveDirectories( const tstring& oldDirectory, const tstring& newDirectory );
+#endif
     };
 }
\ No newline at end of file
@@ -0,0 +1,311 @@
+#ifdef WIN32
+# include "Platform/Windows/Windows.h"
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#include "Platform/Error.h"
+
+#include "MappedFile.h"
+
+#include "Foundation/Log.h"
+
+#include <algorithm>
+
+using namespace Helium;
+
+MappedFile::MappedFile()
+: m_Size( 0 )
+, m_WindowSize( 0 )
+, m_Granularity( 1 )
+, m_Hint( MappedFileHints::Normal )
+, m_View( NULL )
+, m_ViewOffset( 0 )
+, m_ViewSize( 0 )
+#ifdef WIN32
+, m_File( INVALID_HANDLE_VALUE )
+, m_Mapping( NULL )
+#else
+, m_File( -1 )
+#endif
+{
+
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedSpan MappedFile::GetSpan( u64 offset, u64 length )
+{
+    if ( !IsOpen() || offset >= m_Size )
+    {
+        return MappedSpan();
+    }
+
+    length = std::min( std::min( length, m_Size - offset ), m_WindowSize );
+    if ( length == 0 )
+    {
+        return MappedSpan();
+    }
+
+    if ( !m_View || offset < m_ViewOffset || offset + length > m_ViewOffset + m_ViewSize )
+    {
+        // start the window at the aligned offset below, and make it long enough that a full window's worth
+        //  is still there after the slack
+        u64 aligned = offset - offset % m_Granularity;
+        if ( !Map( aligned, std::min( m_Size - aligned, m_WindowSize + ( offset - aligned ) ) ) )
+        {
+            return MappedSpan();
+        }
+    }
+
+    return MappedSpan( m_View + ( offset - m_ViewOffset ), (size_t)length );
+}
+
+#ifdef WIN32
+
+bool MappedFile::Open( const tstring& path, MappedFileHint hint, u64 windowSize )
+{
+    Close();
+
+    m_Path = path;
+    m_Hint = hint;
+
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    switch ( m_Hint )
+    {
+    case MappedFileHints::Sequential:
+        flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+        break;
+
+    case MappedFileHints::Random:
+        flags |= FILE_FLAG_RANDOM_ACCESS;
+        break;
+
+    case MappedFileHints::Normal:
+        break;
+    }
+
+    m_File = ::CreateFile( path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, flags, NULL );
+    if ( m_File == INVALID_HANDLE_VALUE )
+    {
+        Log::Warning( TXT( "Unable to open %s for read (%s)\n" ), path.c_str(), Helium::GetErrorString().c_str() );
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if ( !::GetFileSizeEx( m_File, &size ) )
+    {
+        Log::Warning( TXT( "Unable to get the size of %s (%s)\n" ), path.c_str(), Helium::GetErrorString().c_str() );
+        Close();
+        return false;
+    }
+    m_Size = size.QuadPart;
+
+    SYSTEM_INFO info;
+    ::GetSystemInfo( &info );
+    m_Granularity = info.dwAllocationGranularity;
+    m_WindowSize = std::max< u64 >( windowSize - windowSize % m_Granularity, m_Granularity );
+
+    // an empty file can't be mapped, but it is open, it just has no spans
+    if ( m_Size )
+    {
+        m_Mapping = ::CreateFileMapping( m_File, NULL, PAGE_READONLY, 0, 0, NULL );
+        if ( !m_Mapping )
+        {
+            Log::Warning( TXT( "Unable to map %s (%s)\n" ), path.c_str(), Helium::GetErrorString().c_str() );
+            Close();
+            return false;
+        }
+
+        if ( m_Size <= m_WindowSize && !Map( 0, m_Size ) )
+        {
+            Close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    Unmap();
+
+    if ( m_Mapping )
+    {
+        ::CloseHandle( m_Mapping );
+        m_Mapping = NULL;
+    }
+
+    if ( m_File != INVALID_HANDLE_VALUE )
+    {
+        ::CloseHandle( m_File );
+        m_File = INVALID_HANDLE_VALUE;
+    }
+
+    m_Size = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+    return m_File != INVALID_HANDLE_VALUE;
+}
+
+void MappedFile::SetHint( MappedFileHint hint )
+{
+    // the cache manager only takes hints as flags on CreateFile
+    m_Hint = hint;
+}
+
+bool MappedFile::Map( u64 offset, u64 length )
+{
+    Unmap();
+
+    m_View = (u8*)::MapViewOfFile( m_Mapping, FILE_MAP_READ, (DWORD)( offset >> 32 ), (DWORD)offset, (SIZE_T)length );
+    if ( !m_View )
+    {
+        Log::Warning( TXT( "Unable to map a view of %s (%s)\n" ), m_Path.c_str(), Helium::GetErrorString().c_str() );
+        return false;
+    }
+
+    m_ViewOffset = offset;
+    m_ViewSize = (size_t)length;
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+    if ( m_View )
+    {
+        ::UnmapViewOfFile( m_View );
+        m_View = NULL;
+        m_ViewOffset = 0;
+        m_ViewSize = 0;
+    }
+}
+
+#else
+
+bool MappedFile::Open( const tstring& path, MappedFileHint hint, u64 windowSize )
+{
+    Close();
+
+    m_Path = path;
+    m_Hint = hint;
+
+    m_File = open( path.c_str(), O_RDONLY );
+    if ( m_File < 0 )
+    {
+        Log::Warning( TXT( "Unable to open %s for read (%s)\n" ), path.c_str(), Helium::GetErrorString().c_str() );
+        return false;
+    }
+
+    struct stat info;
+    if ( fstat( m_File, &info ) != 0 )
+    {
+        Log::Warning( TXT( "Unable to get the size of %s (%s)\n" ), path.c_str(), Helium::GetErrorString().c_str() );
+        Close();
+        return false;
+    }
+    m_Size = info.st_size;
+
+    m_Granularity = (u32)sysconf( _SC_PAGESIZE );
+    m_WindowSize = std::max< u64 >( windowSize - windowSize % m_Granularity, m_Granularity );
+
+    // an empty file can't be mapped, but it is open, it just has no spans
+    if ( m_Size && m_Size <= m_WindowSize && !Map( 0, m_Size ) )
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    Unmap();
+
+    if ( m_File >= 0 )
+    {
+        close( m_File );
+        m_File = -1;
+    }
+
+    m_Size = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+    return m_File >= 0;
+}
+
+void MappedFile::SetHint( MappedFileHint hint )
+{
+    m_Hint = hint;
+    Advise();
+}
+
+bool MappedFile::Map( u64 offset, u64 length )
+{
+    Unmap();
+
+    void* view = mmap( NULL, (size_t)length, PROT_READ, MAP_SHARED, m_File, (off_t)offset );
+    if ( view == MAP_FAILED )
+    {
+        Log::Warning( TXT( "Unable to map a view of %s (%s)\n" ), m_Path.c_str(), Helium::GetErrorString().c_str() );
+        return false;
+    }
+
+    m_View = (u8*)view;
+    m_ViewOffset = offset;
+    m_ViewSize = (size_t)length;
+
+    Advise();
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+    if ( m_View )
+    {
+        munmap( m_View, m_ViewSize );
+        m_View = NULL;
+        m_ViewOffset = 0;
+        m_ViewSize = 0;
+    }
+}
+
+void MappedFile::Advise()
+{
+    if ( !m_View )
+    {
+        return;
+    }
+
+    int advice = MADV_NORMAL;
+    switch ( m_Hint )
+    {
+    case MappedFileHints::Sequential:
+        advice = MADV_SEQUENTIAL;
+        break;
+
+    case MappedFileHints::Random:
+        advice = MADV_RANDOM;
+        break;
+
+    case MappedFileHints::Normal:
+        break;
+    }
+
+    // only a hint, the mapping works the same if it's ignored
+    madvise( m_View, m_ViewSize, advice );
+}
+
+#endif
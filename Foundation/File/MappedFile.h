@@ -0,0 +1,143 @@
+#pragma once
+
+#include <string>
+
+#include "Platform/Types.h"
+#include "Platform/Compiler.h"
+
+#include "Foundation/API.h"
+
+// the most of a file mapped at once, files no bigger than this are mapped whole; 32 bit processes keep
+//  it small so a few open files don't exhaust the address space
+#ifndef MAPPED_FILE_WINDOW_SIZE
+# ifdef X64
+#  define MAPPED_FILE_WINDOW_SIZE   ( 1024 * 1024 * 1024 )
+# else
+#  define MAPPED_FILE_WINDOW_SIZE   ( 64 * 1024 * 1024 )
+# endif
+#endif
+
+namespace Helium
+{
+    namespace MappedFileHints
+    {
+        enum MappedFileHint
+        {
+            Normal,
+            Sequential,     // read ahead aggressively and drop pages behind the reader
+            Random,         // don't read ahead
+        };
+    }
+    typedef MappedFileHints::MappedFileHint MappedFileHint;
+
+    //
+    // A range of mapped bytes, valid until the MappedFile it came from maps another window or closes
+    //
+
+    struct MappedSpan
+    {
+        const u8*   m_Data;
+        size_t      m_Size;
+
+        MappedSpan()
+            : m_Data( NULL )
+            , m_Size( 0 )
+        {
+        }
+
+        MappedSpan( const u8* data, size_t size )
+            : m_Data( data )
+            , m_Size( size )
+        {
+        }
+
+        bool IsEmpty() const
+        {
+            return m_Size == 0;
+        }
+
+        const u8* Begin() const
+        {
+            return m_Data;
+        }
+
+        const u8* End() const
+        {
+            return m_Data + m_Size;
+        }
+
+        const u8& operator[]( size_t index ) const
+        {
+            return m_Data[ index ];
+        }
+    };
+
+    //
+    // Read-only memory mapping of a file, so readers take bytes straight from the page cache instead of
+    //  copying them through stdio.  Files that fit in the window are mapped once, larger ones a window at a
+    //  time around whatever range is asked for.
+    //
+
+    class FOUNDATION_API MappedFile
+    {
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        bool Open( const tstring& path, MappedFileHint hint = MappedFileHints::Normal, u64 windowSize = MAPPED_FILE_WINDOW_SIZE );
+        void Close();
+
+        bool IsOpen() const;
+
+        const tstring& GetPath() const
+        {
+            return m_Path;
+        }
+
+        u64 GetSize() const
+        {
+            return m_Size;
+        }
+
+        // the longest span GetSpan can hand back at any offset
+        u64 GetWindowSize() const
+        {
+            return m_WindowSize;
+        }
+
+        // change how the kernel reads ahead for the mapping, only applied on open on Windows
+        void SetHint( MappedFileHint hint );
+
+        // length bytes from offset, clipped to the end of the file and to the window size, remapping if the
+        //  range isn't in the current window; empty if it couldn't be mapped
+        MappedSpan GetSpan( u64 offset, u64 length );
+
+        // everything from offset up to the end of the window, for walking a file front to back
+        MappedSpan GetSpan( u64 offset )
+        {
+            return GetSpan( offset, m_Size );
+        }
+
+    private:
+        bool Map( u64 offset, u64 length );
+        void Unmap();
+#ifndef WIN32
+        void Advise();
+#endif
+
+        tstring         m_Path;
+        u64             m_Size;
+        u64             m_WindowSize;
+        u32             m_Granularity;      // mapping offsets have to be a multiple of this
+        MappedFileHint  m_Hint;
+        u8*             m_View;
+        u64             m_ViewOffset;
+        size_t          m_ViewSize;
+#ifdef WIN32
+        void*           m_File;
+        void*           m_Mapping;
+#else
+        int             m_File;
+#endif
+    };
+}
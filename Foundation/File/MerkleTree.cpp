@@ -0,0 +1,601 @@
+#include "MerkleTree.h"
+
+#include "Platform/Exception.h"
+#include "Platform/Path.h"
+#include "Platform/String.h"
+
+#include "Foundation/Checksum/MD5.h"
+#include "Foundation/File/Directory.h"
+#include "Foundation/File/Path.h"
+#include "Foundation/File/Snapshot.h"
+#include "Foundation/Log.h"
+
+#include <algorithm>
+
+using namespace Helium;
+
+static tstring Join( const tstring& directory, const tstring& name )
+{
+    if ( directory.empty() )
+    {
+        return name;
+    }
+
+    return directory + Helium::s_InternalPathSeparator + name;
+}
+
+// internal separators and no trailing one, so the same node always has the same key
+static tstring Clean( const tstring& path )
+{
+    tstring result = path;
+    std::replace( result.begin(), result.end(), Helium::PathSeparator, Helium::s_InternalPathSeparator );
+
+    while ( !result.empty() && *result.rbegin() == Helium::s_InternalPathSeparator )
+    {
+        result.erase( result.length() - 1 );
+    }
+
+    return result;
+}
+
+static bool CompareName( const MerkleEntry& lhs, const MerkleEntry& rhs )
+{
+    return lhs.m_Name < rhs.m_Name;
+}
+
+MerkleNode::MerkleNode( MerkleNode* parent, const tstring& name, u32 mode )
+: m_Parent( parent )
+, m_Name( name )
+, m_Mode( mode & MERKLE_MODE_MASK )
+, m_Dirty( ( mode & ModeFlags::Directory ) != 0 )
+{
+
+}
+
+MerkleNode::~MerkleNode()
+{
+    for ( M_Children::const_iterator itr = m_Children.begin(), end = m_Children.end(); itr != end; ++itr )
+    {
+        delete itr->second;
+    }
+}
+
+MerkleTree::MerkleTree()
+: m_RootNode( new MerkleNode( NULL, TXT( "" ), ModeFlags::Directory ) )
+{
+
+}
+
+MerkleTree::~MerkleTree()
+{
+    delete m_RootNode;
+}
+
+void MerkleTree::Clear()
+{
+    delete m_RootNode;
+    m_RootNode = new MerkleNode( NULL, TXT( "" ), ModeFlags::Directory );
+}
+
+void MerkleTree::SetRoot( const tstring& root )
+{
+    m_Root = root;
+    std::replace( m_Root.begin(), m_Root.end(), Helium::PathSeparator, Helium::s_InternalPathSeparator );
+    Path::GuaranteeSeparator( m_Root );
+}
+
+bool MerkleTree::Build( const tstring& root, SnapshotIndex& index )
+{
+    Clear();
+    SetRoot( root );
+
+    std::vector< DirectoryItem > items;
+    std::vector< tstring > directories;
+    directories.push_back( m_Root );
+
+    try
+    {
+        while ( !directories.empty() )
+        {
+            tstring directory = directories.back();
+            directories.pop_back();
+
+            // directories get a node as they're found, so empty ones are part of the tree too
+            tstring relative;
+            GetRelativePath( directory, relative );
+            Lookup( relative, true );
+
+            for ( Directory dir ( directory, TXT( "*" ) ); !dir.IsDone(); dir.Next() )
+            {
+                const DirectoryItem& item = dir.GetItem();
+                if ( item.m_Flags & DirectoryItemFlags::Directory )
+                {
+                    directories.push_back( item.m_Path );
+                }
+                else
+                {
+                    items.push_back( item );
+                }
+            }
+        }
+    }
+    catch ( const Helium::Exception& ex )
+    {
+        Log::Warning( TXT( "Failed to scan '%s': %s\n" ), m_Root.c_str(), ex.What() );
+        return false;
+    }
+
+    // only the files whose stat moved since the index last saw them are read
+    SnapshotDiff diff;
+    index.Refresh( items, diff );
+
+    for ( std::vector< DirectoryItem >::const_iterator itr = items.begin(), end = items.end(); itr != end; ++itr )
+    {
+        const SnapshotEntry* entry = index.Find( Helium::Path( itr->m_Path ).Hash() );
+        tstring relative;
+        if ( entry && GetRelativePath( itr->m_Path, relative ) )
+        {
+            Update( relative, entry->m_Digest, ModeFlags::File );
+        }
+    }
+
+    return true;
+}
+
+void MerkleTree::Update( const tstring& path, const Digest128& digest, u32 mode )
+{
+    tstring clean = Clean( path );
+    if ( clean.empty() )
+    {
+        return;
+    }
+
+    MerkleNode* node = Lookup( clean, true );
+
+    // a directory replaced by a file
+    for ( MerkleNode::M_Children::const_iterator itr = node->m_Children.begin(), end = node->m_Children.end(); itr != end; ++itr )
+    {
+        delete itr->second;
+    }
+    node->m_Children.clear();
+
+    node->m_Digest = digest;
+    node->m_Mode = mode & MERKLE_MODE_MASK;
+    node->m_Dirty = false;
+
+    Invalidate( node->m_Parent );
+}
+
+bool MerkleTree::Remove( const tstring& path )
+{
+    tstring clean = Clean( path );
+    if ( clean.empty() )
+    {
+        Clear();
+        return true;
+    }
+
+    MerkleNode* node = Detach( clean );
+    delete node;
+    return node != NULL;
+}
+
+bool MerkleTree::Rename( const tstring& oldPath, const tstring& newPath )
+{
+    tstring clean = Clean( newPath );
+    if ( clean.empty() )
+    {
+        return false;
+    }
+
+    MerkleNode* node = Detach( Clean( oldPath ) );
+    if ( !node )
+    {
+        return false;
+    }
+
+    tstring name = clean;
+    MerkleNode* parent = m_RootNode;
+
+    size_t slash = clean.rfind( Helium::s_InternalPathSeparator );
+    if ( slash != tstring::npos )
+    {
+        name = clean.substr( slash + 1 );
+        parent = Lookup( clean.substr( 0, slash ), true );
+    }
+
+    MerkleNode::M_Children::iterator found = parent->m_Children.find( name );
+    if ( found != parent->m_Children.end() )
+    {
+        delete found->second;
+        parent->m_Children.erase( found );
+    }
+
+    node->m_Name = name;
+    node->m_Parent = parent;
+    parent->m_Children[ name ] = node;
+
+    Invalidate( parent );
+    return true;
+}
+
+void MerkleTree::Apply( const V_FileChangedArgs& changes )
+{
+    for ( V_FileChangedArgs::const_iterator itr = changes.begin(), end = changes.end(); itr != end; ++itr )
+    {
+        const FileChangedArgs& change = *itr;
+
+        tstring relative;
+        if ( !GetRelativePath( change.m_Path, relative ) )
+        {
+            continue;
+        }
+
+        if ( change.m_Operation & FileOperations::Removed )
+        {
+            Remove( relative );
+            continue;
+        }
+
+        if ( change.m_Operation & FileOperations::Renamed )
+        {
+            tstring oldRelative;
+            if ( GetRelativePath( change.m_OldPath, oldRelative ) && Rename( oldRelative, relative ) )
+            {
+                continue;
+            }
+
+            // moved in from outside the root, so there's nothing to carry over
+        }
+
+        Stat stat;
+        if ( !Helium::StatPath( change.m_Path.c_str(), stat ) )
+        {
+            // already gone again
+            Remove( relative );
+            continue;
+        }
+
+        if ( stat.m_Mode & ModeFlags::Directory )
+        {
+            // a modified directory only means its listing changed, and its entries report that themselves
+            if ( change.m_Operation & ( FileOperations::Added | FileOperations::Renamed ) )
+            {
+                Remove( relative );
+
+                tstring directory = change.m_Path;
+                std::replace( directory.begin(), directory.end(), Helium::PathSeparator, Helium::s_InternalPathSeparator );
+                Path::GuaranteeSeparator( directory );
+                Scan( directory );
+            }
+            continue;
+        }
+
+        try
+        {
+            Digest128 digest;
+            Helium::FileMD5( change.m_Path, digest );
+            Update( relative, digest, ModeFlags::File );
+        }
+        catch ( const Helium::Exception& ex )
+        {
+            Log::Warning( TXT( "Failed to hash '%s': %s\n" ), change.m_Path.c_str(), ex.What() );
+            Remove( relative );
+        }
+    }
+}
+
+const MerkleNode* MerkleTree::Find( const tstring& path )
+{
+    MerkleNode* node = Lookup( Clean( path ), false );
+    if ( node )
+    {
+        Rehash( node );
+    }
+
+    return node;
+}
+
+const Digest128& MerkleTree::GetRootDigest()
+{
+    Rehash( m_RootNode );
+    return m_RootNode->m_Digest;
+}
+
+bool MerkleTree::GetEntries( const tstring& directory, V_MerkleEntry& entries )
+{
+    entries.clear();
+
+    MerkleNode* node = Lookup( Clean( directory ), false );
+    if ( !node || !node->IsDirectory() )
+    {
+        return false;
+    }
+
+    Rehash( node );
+    GetEntries( node, entries );
+    return true;
+}
+
+void MerkleTree::Compare( const tstring& directory, const V_MerkleEntry& remote, std::vector< tstring >& differences )
+{
+    tstring clean = Clean( directory );
+
+    V_MerkleEntry local;
+    GetEntries( clean, local );
+
+    V_MerkleEntry sorted ( remote );
+    std::sort( sorted.begin(), sorted.end(), &CompareName );
+
+    // both lists are in name order, so one pass pairs them up
+    V_MerkleEntry::const_iterator l = local.begin(), lEnd = local.end();
+    V_MerkleEntry::const_iterator r = sorted.begin(), rEnd = sorted.end();
+    while ( l != lEnd || r != rEnd )
+    {
+        if ( r == rEnd || ( l != lEnd && l->m_Name < r->m_Name ) )
+        {
+            differences.push_back( Join( clean, l->m_Name ) );
+            ++l;
+        }
+        else if ( l == lEnd || r->m_Name < l->m_Name )
+        {
+            differences.push_back( Join( clean, r->m_Name ) );
+            ++r;
+        }
+        else
+        {
+            if ( l->m_Digest != r->m_Digest || l->m_Mode != r->m_Mode )
+            {
+                differences.push_back( Join( clean, l->m_Name ) );
+            }
+            ++l;
+            ++r;
+        }
+    }
+}
+
+void MerkleTree::Compare( MerkleTree& other, std::vector< tstring >& differences )
+{
+    Rehash( m_RootNode );
+    Rehash( other.m_RootNode );
+
+    Compare( TXT( "" ), m_RootNode, other.m_RootNode, differences );
+}
+
+MerkleNode* MerkleTree::Lookup( const tstring& path, bool create )
+{
+    MerkleNode* node = m_RootNode;
+
+    size_t start = 0;
+    while ( start < path.length() )
+    {
+        size_t slash = path.find( Helium::s_InternalPathSeparator, start );
+        if ( slash == tstring::npos )
+        {
+            slash = path.length();
+        }
+
+        tstring name = path.substr( start, slash - start );
+        start = slash + 1;
+
+        if ( name.empty() )
+        {
+            continue;
+        }
+
+        MerkleNode::M_Children::iterator found = node->m_Children.find( name );
+        if ( found != node->m_Children.end() )
+        {
+            node = found->second;
+
+            // a file in the way of a path through it has been replaced by a directory
+            if ( create && start < path.length() && !node->IsDirectory() )
+            {
+                node->m_Mode = ModeFlags::Directory;
+                Invalidate( node );
+            }
+            continue;
+        }
+
+        if ( !create )
+        {
+            return NULL;
+        }
+
+        MerkleNode* child = new MerkleNode( node, name, ModeFlags::Directory );
+        node->m_Children[ name ] = child;
+        Invalidate( node );
+
+        node = child;
+    }
+
+    return node;
+}
+
+MerkleNode* MerkleTree::Detach( const tstring& path )
+{
+    MerkleNode* node = Lookup( path, false );
+    if ( !node || node == m_RootNode )
+    {
+        return NULL;
+    }
+
+    MerkleNode* parent = node->m_Parent;
+    parent->m_Children.erase( node->m_Name );
+    Invalidate( parent );
+
+    node->m_Parent = NULL;
+    return node;
+}
+
+void MerkleTree::Invalidate( MerkleNode* node )
+{
+    for ( ; node; node = node->m_Parent )
+    {
+        node->m_Dirty = true;
+    }
+}
+
+void MerkleTree::Rehash( MerkleNode* node )
+{
+    if ( !node->m_Dirty )
+    {
+        return;
+    }
+
+    md5_state_t state;
+    md5_init( &state );
+
+    for ( MerkleNode::M_Children::const_iterator itr = node->m_Children.begin(), end = node->m_Children.end(); itr != end; ++itr )
+    {
+        MerkleNode* child = itr->second;
+        Rehash( child );
+
+        // names go in as narrow strings so builds with either character width agree
+        std::string name;
+        Helium::ConvertString( child->m_Name, name );
+        md5_append( &state, (const md5_byte_t*)name.c_str(), (int)name.length() + 1 );
+
+        md5_append( &state, child->m_Digest.m_Bytes, sizeof( child->m_Digest.m_Bytes ) );
+
+        md5_byte_t mode[ 4 ] = { (md5_byte_t)child->m_Mode, (md5_byte_t)( child->m_Mode >> 8 ), (md5_byte_t)( child->m_Mode >> 16 ), (md5_byte_t)( child->m_Mode >> 24 ) };
+        md5_append( &state, mode, sizeof( mode ) );
+    }
+
+    md5_finish( &state, node->m_Digest.m_Bytes );
+    node->m_Dirty = false;
+}
+
+void MerkleTree::Scan( const tstring& directory )
+{
+    tstring relative;
+    if ( !GetRelativePath( directory, relative ) )
+    {
+        return;
+    }
+
+    Lookup( relative, true );
+
+    try
+    {
+        for ( Directory dir ( directory, TXT( "*" ) ); !dir.IsDone(); dir.Next() )
+        {
+            const DirectoryItem& item = dir.GetItem();
+            if ( item.m_Flags & DirectoryItemFlags::Directory )
+            {
+                Scan( item.m_Path );
+                continue;
+            }
+
+            tstring file;
+            if ( GetRelativePath( item.m_Path, file ) )
+            {
+                Digest128 digest;
+                Helium::FileMD5( item.m_Path, digest );
+                Update( file, digest, ModeFlags::File );
+            }
+        }
+    }
+    catch ( const Helium::Exception& ex )
+    {
+        // what was found so far stays, the watcher will report the rest as it settles
+        Log::Warning( TXT( "Failed to scan '%s': %s\n" ), directory.c_str(), ex.What() );
+    }
+}
+
+bool MerkleTree::GetRelativePath( const tstring& path, tstring& relative ) const
+{
+    tstring clean = Clean( path );
+
+    if ( m_Root.empty() )
+    {
+        relative = clean;
+        return true;
+    }
+
+    if ( clean + Helium::s_InternalPathSeparator == m_Root )
+    {
+        relative.clear();
+        return true;
+    }
+
+    if ( clean.compare( 0, m_Root.length(), m_Root ) != 0 )
+    {
+        return false;
+    }
+
+    relative = clean.substr( m_Root.length() );
+    return true;
+}
+
+void MerkleTree::GetEntries( MerkleNode* node, V_MerkleEntry& entries )
+{
+    entries.reserve( node->m_Children.size() );
+
+    for ( MerkleNode::M_Children::const_iterator itr = node->m_Children.begin(), end = node->m_Children.end(); itr != end; ++itr )
+    {
+        MerkleEntry entry;
+        entry.m_Name = itr->first;
+        entry.m_Digest = itr->second->m_Digest;
+        entry.m_Mode = itr->second->m_Mode;
+        entries.push_back( entry );
+    }
+}
+
+void MerkleTree::Compare( const tstring& path, MerkleNode* local, MerkleNode* remote, std::vector< tstring >& differences )
+{
+    if ( local->m_Digest == remote->m_Digest && local->m_Mode == remote->m_Mode )
+    {
+        return;
+    }
+
+    if ( !local->IsDirectory() && !remote->IsDirectory() )
+    {
+        differences.push_back( path );
+        return;
+    }
+
+    if ( !local->IsDirectory() || !remote->IsDirectory() )
+    {
+        // a file on one side where the other has a directory
+        AddFiles( path, local, differences );
+        AddFiles( path, remote, differences );
+        return;
+    }
+
+    MerkleNode::M_Children::const_iterator l = local->m_Children.begin(), lEnd = local->m_Children.end();
+    MerkleNode::M_Children::const_iterator r = remote->m_Children.begin(), rEnd = remote->m_Children.end();
+    while ( l != lEnd || r != rEnd )
+    {
+        if ( r == rEnd || ( l != lEnd && l->first < r->first ) )
+        {
+            AddFiles( Join( path, l->first ), l->second, differences );
+            ++l;
+        }
+        else if ( l == lEnd || r->first < l->first )
+        {
+            AddFiles( Join( path, r->first ), r->second, differences );
+            ++r;
+        }
+        else
+        {
+            Compare( Join( path, l->first ), l->second, r->second, differences );
+            ++l;
+            ++r;
+        }
+    }
+}
+
+void MerkleTree::AddFiles( const tstring& path, MerkleNode* node, std::vector< tstring >& files )
+{
+    if ( !node->IsDirectory() )
+    {
+        files.push_back( path );
+        return;
+    }
+
+    for ( MerkleNode::M_Children::const_iterator itr = node->m_Children.begin(), end = node->m_Children.end(); itr != end; ++itr )
+    {
+        AddFiles( Join( path, itr->first ), itr->second, files );
+    }
+}
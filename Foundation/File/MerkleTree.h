@@ -0,0 +1,154 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "Platform/Types.h"
+#include "Platform/Stat.h"
+
+#include "Foundation/API.h"
+#include "Foundation/Checksum/Digest.h"
+#include "Foundation/File/FileWatcher.h"
+
+// the ModeFlags that take part in a node's hash, permissions differ too much between platforms to be
+//  compared so only the type of the node does
+#define MERKLE_MODE_MASK    ( ModeFlags::File | ModeFlags::Directory )
+
+namespace Helium
+{
+    class SnapshotIndex;
+
+    //
+    // What one replica tells another about a child of a directory
+    //
+
+    struct FOUNDATION_API MerkleEntry
+    {
+        tstring     m_Name;     // no separators, directories don't have a trailing one
+        Digest128   m_Digest;   // MD5 of a file's contents, or the hash of a directory's entries
+        u32         m_Mode;     // ModeFlags, masked by MERKLE_MODE_MASK
+
+        bool IsDirectory() const
+        {
+            return ( m_Mode & ModeFlags::Directory ) != 0;
+        }
+    };
+
+    typedef std::vector< MerkleEntry > V_MerkleEntry;
+
+    class FOUNDATION_API MerkleNode
+    {
+    public:
+        typedef std::map< tstring, MerkleNode* > M_Children;
+
+        MerkleNode( MerkleNode* parent, const tstring& name, u32 mode );
+        ~MerkleNode();
+
+        const tstring& GetName() const
+        {
+            return m_Name;
+        }
+
+        const Digest128& GetDigest() const
+        {
+            return m_Digest;
+        }
+
+        u32 GetMode() const
+        {
+            return m_Mode;
+        }
+
+        bool IsDirectory() const
+        {
+            return ( m_Mode & ModeFlags::Directory ) != 0;
+        }
+
+        const M_Children& GetChildren() const
+        {
+            return m_Children;
+        }
+
+    private:
+        friend class MerkleTree;
+
+        MerkleNode* m_Parent;
+        tstring     m_Name;
+        Digest128   m_Digest;
+        u32         m_Mode;
+        bool        m_Dirty;        // a directory whose digest is out of date, so are all of its parents
+        M_Children  m_Children;     // sorted by name, which is the order they are hashed in
+    };
+
+    //
+    // A hash tree over a directory: a file's node carries the MD5 of its contents, and a directory's node
+    //  the MD5 of its children's (name, digest, mode) in name order.  Equal roots mean equal trees, and
+    //  where roots differ, comparing children level by level leads straight to the changes, so two
+    //  replicas exchange a few listings instead of every file's digest.  Changes only mark the directories
+    //  above them, which are rehashed the next time a digest is asked for.
+    //
+
+    class FOUNDATION_API MerkleTree
+    {
+    public:
+        MerkleTree();
+        ~MerkleTree();
+
+        void Clear();
+
+        // the absolute directory the tree describes, relative paths below are taken from here
+        const tstring& GetRoot() const
+        {
+            return m_Root;
+        }
+
+        void SetRoot( const tstring& root );
+
+        // scan the root, using and refreshing the index so only files whose stat changed are rehashed
+        bool Build( const tstring& root, SnapshotIndex& index );
+
+        // set a file's digest and mode, creating the directories above it
+        void Update( const tstring& path, const Digest128& digest, u32 mode = ModeFlags::File );
+
+        // remove a file or a directory and everything below it
+        bool Remove( const tstring& path );
+
+        // move a node, digests and all, so a rename doesn't need anything rehashed
+        bool Rename( const tstring& oldPath, const tstring& newPath );
+
+        // bring the tree up to date with changes from a FileWatcher on the root: removes and renames are
+        //  applied as is, added and modified files are rehashed and added directories scanned
+        void Apply( const V_FileChangedArgs& changes );
+
+        // the node at a relative path, the empty path is the root
+        const MerkleNode* Find( const tstring& path );
+
+        const Digest128& GetRootDigest();
+
+        // what to send the other replica about a directory, false if it's not one of ours
+        bool GetEntries( const tstring& directory, V_MerkleEntry& entries );
+
+        // compare the other replica's entries for a directory with ours, collecting the relative paths of
+        //  the children that only one side has or that differ; directories on both sides among them are
+        //  the ones to descend into
+        void Compare( const tstring& directory, const V_MerkleEntry& remote, std::vector< tstring >& differences );
+
+        // the relative paths of files that differ between two trees, descending only where digests differ
+        void Compare( MerkleTree& other, std::vector< tstring >& differences );
+
+    private:
+        MerkleNode* Lookup( const tstring& path, bool create );
+        MerkleNode* Detach( const tstring& path );
+        void Invalidate( MerkleNode* node );
+        void Rehash( MerkleNode* node );
+        void Scan( const tstring& directory );
+        bool GetRelativePath( const tstring& path, tstring& relative ) const;
+
+        static void GetEntries( MerkleNode* node, V_MerkleEntry& entries );
+        static void Compare( const tstring& path, MerkleNode* local, MerkleNode* remote, std::vector< tstring >& differences );
+        static void AddFiles( const tstring& path, MerkleNode* node, std::vector< tstring >& files );
+
+        tstring     m_Root;     // with a trailing separator
+        MerkleNode* m_RootNode;
+    };
+}
@@ -5,9 +5,9 @@
 #include "Platform/Path.h"
 
 #include "Platform/Exception.h"
-#include "Foundation/Checksum/Crc32.h"
+#include "Foundation/Checksum/CRC32.h"
 #include "Foundation/Checksum/MD5.h"
-#include "Foundation/Checksum/MurmurHash2.h"
+#include "Foundation/Checksum/XXH3.h"
 
 #include <algorithm>
 #include <sstream>
@@ -263,9 +263,9 @@ bool Path::Create() const
     return true;
 }
 
-bool Path::Copy( const Helium::Path& target, bool overwrite ) const
+bool Path::Copy( const Helium::Path& target, bool overwrite, CopyStrategy* strategy ) const
 {
-    return Helium::Copy( Native().c_str(), target.Native().c_str(), overwrite );
+    return Helium::Copy( Native().c_str(), target.Native().c_str(), overwrite, strategy );
 }
 
 bool Path::Move( const Helium::Path& target ) const 
@@ -492,12 +492,19 @@ tstring Path::Normalized() const
 
 u64 Path::Hash() const
 {
-    return Helium::MurmurHash2( m_Path );
+    return Helium::XXH3_64( m_Path );
 }
 
 tstring Path::Signature()
 {
-    return Helium::MD5( m_Path );
+    return SignatureDigest().ToString();
+}
+
+Digest128 Path::SignatureDigest() const
+{
+    Digest128 digest;
+    Helium::MD5( m_Path, digest );
+    return digest;
 }
 
 Helium::Path Path::GetAbsolutePath( const Helium::Path& basisPath ) const
@@ -574,24 +581,67 @@ const tchar* Path::c_str() const
 
 tstring Path::FileCRC() const
 {
-    u32 crc = Helium::FileCrc32( m_Path.c_str() );
+    return FileCRCDigest().ToString();
+}
 
-    tstringstream str;
-    str << std::hex << std::uppercase << crc;
-    return str.str();
+Digest32 Path::FileCRCDigest() const
+{
+    return Digest32( Helium::FileCrc32( m_Path.c_str() ) );
 }
 
 bool Path::VerifyFileCRC( const tstring& hash ) const
 {
-    return FileCRC().compare( hash ) == 0;
+    Digest32 expected;
+    return expected.FromString( hash ) && VerifyFileCRC( expected );
+}
+
+bool Path::VerifyFileCRC( const Digest32& hash ) const
+{
+    return FileCRCDigest() == hash;
 }
 
 tstring Path::FileMD5() const
 {
-    return Helium::FileMD5( m_Path.c_str() );
+    return FileMD5Digest().ToString();
+}
+
+Digest128 Path::FileMD5Digest() const
+{
+    Digest128 digest;
+    Helium::FileMD5( m_Path, digest );
+    return digest;
 }
 
 bool Path::VerifyFileMD5( const tstring& hash ) const
 {
-    return FileMD5().compare( hash ) == 0;
+    Digest128 expected;
+    return expected.FromString( hash ) && VerifyFileMD5( expected );
+}
+
+bool Path::VerifyFileMD5( const Digest128& hash ) const
+{
+    return FileMD5Digest() == hash;
+}
+
+tstring Path::FileHash() const
+{
+    return FileHashDigest().ToString();
+}
+
+Digest128 Path::FileHashDigest() const
+{
+    Digest128 digest;
+    Helium::FileXXH3( m_Path, digest );
+    return digest;
+}
+
+bool Path::VerifyFileHash( const tstring& hash ) const
+{
+    Digest128 expected;
+    return expected.FromString( hash ) && VerifyFileHash( expected );
+}
+
+bool Path::VerifyFileHash( const Digest128& hash ) const
+{
+    return FileHashDigest() == hash;
 }
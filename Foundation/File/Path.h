@@ -4,8 +4,10 @@
 #include <vector>
 
 #include "Foundation/API.h"
+#include "Foundation/Checksum/Digest.h"
 #include "Foundation/Memory/SmartPtr.h"
 #include "Foundation/String/Utilities.h"
+#include "Platform/Path.h"
 #include "Platform/String.h"
 
 namespace Helium
@@ -78,6 +80,7 @@ namespace Helium
 
         u64 Hash() const;
         tstring Signature();
+        Digest128 SignatureDigest() const;
 
         bool Exists() const;
         bool Stat( Helium::Stat& stat ) const;
@@ -95,15 +98,25 @@ namespace Helium
 
         bool MakePath() const;
         bool Create() const;
-        bool Copy( const Helium::Path& target, bool overwrite = true ) const;
+        bool Copy( const Helium::Path& target, bool overwrite = true, CopyStrategy* strategy = NULL ) const;
         bool Move( const Helium::Path& target ) const;
         bool Delete() const;
 
         tstring FileCRC() const;
+        Digest32 FileCRCDigest() const;
         bool VerifyFileCRC( const tstring& hash ) const;
+        bool VerifyFileCRC( const Digest32& hash ) const;
 
         tstring FileMD5() const;
+        Digest128 FileMD5Digest() const;
         bool VerifyFileMD5( const tstring& hash ) const;
+        bool VerifyFileMD5( const Digest128& hash ) const;
+
+        // XXH3, much faster than MD5 but only good for noticing the file changed
+        tstring FileHash() const;
+        Digest128 FileHashDigest() const;
+        bool VerifyFileHash( const tstring& hash ) const;
+        bool VerifyFileHash( const Digest128& hash ) const;
 
     public:
 
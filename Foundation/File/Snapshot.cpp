@@ -0,0 +1,366 @@
+#include "Snapshot.h"
+
+#ifdef WIN32
+# include "Platform/Windows/Windows.h"
+#else
+# include <time.h>
+#endif
+
+#include "Platform/Path.h"
+
+#include "Foundation/Checksum/MD5Batch.h"
+#include "Foundation/File/Path.h"
+#include "Foundation/Log.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+using namespace Helium;
+
+// how close to now a modification has to be for the file system's time resolution (2 seconds on FAT)
+//  to hide a second write, in DirectoryItem units
+#ifdef WIN32
+static const u64 s_RacyWindow = 2 * 10000000ULL;
+#else
+static const u64 s_RacyWindow = 2 * 1000000000ULL;
+#endif
+
+struct SnapshotHeader
+{
+    u32 m_Magic;
+    u32 m_Version;
+    u32 m_EntrySize;
+    u32 m_Reserved;
+    u64 m_Count;
+};
+
+static u64 GetCurrentItemTime()
+{
+#ifdef WIN32
+    FILETIME now;
+    ::GetSystemTimeAsFileTime( &now );
+    return ( (u64)now.dwHighDateTime << 32 ) | now.dwLowDateTime;
+#else
+    timespec now;
+    clock_gettime( CLOCK_REALTIME, &now );
+    return (u64)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+static bool CompareHash( const SnapshotEntry& lhs, const SnapshotEntry& rhs )
+{
+    return lhs.m_Hash < rhs.m_Hash;
+}
+
+static void Fill( SnapshotEntry& entry, u64 hash, const DirectoryItem& item, const Digest128& digest, u64 now )
+{
+    entry.m_Hash = hash;
+    entry.m_Size = item.m_Size;
+    entry.m_ModifiedTime = item.m_ModTime;
+    entry.m_Inode = item.m_Inode;
+    entry.m_Flags = 0;
+    entry.m_Reserved = 0;
+    entry.m_Digest = digest;
+
+    if ( item.m_ModTime + s_RacyWindow >= now )
+    {
+        entry.m_Flags |= SnapshotEntryFlags::Racy;
+    }
+}
+
+bool SnapshotEntry::Matches( const DirectoryItem& item ) const
+{
+    if ( m_Flags & SnapshotEntryFlags::Racy )
+    {
+        return false;
+    }
+
+    // not every platform hands back an inode, but when both sides have one a replaced file shows up here
+    if ( m_Inode && item.m_Inode && m_Inode != item.m_Inode )
+    {
+        return false;
+    }
+
+    return m_Size == item.m_Size && m_ModifiedTime == item.m_ModTime;
+}
+
+SnapshotIndex::SnapshotIndex()
+{
+
+}
+
+bool SnapshotIndex::Load( const tstring& file )
+{
+    Clear();
+
+    FILE* f = _tfopen( file.c_str(), TXT( "rb" ) );
+    if ( !f )
+    {
+        return false;
+    }
+
+    SnapshotHeader header;
+    bool result = fread( &header, sizeof( header ), 1, f ) == 1
+        && header.m_Magic == SNAPSHOT_MAGIC
+        && header.m_Version == SNAPSHOT_VERSION
+        && header.m_EntrySize == sizeof( SnapshotEntry );
+
+    if ( result )
+    {
+        m_Entries.resize( (size_t)header.m_Count );
+        result = header.m_Count == 0 || fread( &m_Entries[ 0 ], sizeof( SnapshotEntry ), m_Entries.size(), f ) == m_Entries.size();
+    }
+
+    fclose( f );
+
+    if ( !result )
+    {
+        // we will just have to hash everything again
+        Log::Warning( TXT( "Ignoring unreadable snapshot index %s\n" ), file.c_str() );
+        Clear();
+        return false;
+    }
+
+    // stable, so if a path was somehow written twice the later entry wins
+    std::stable_sort( m_Entries.begin(), m_Entries.end(), &CompareHash );
+
+    V_SnapshotEntry::iterator last = m_Entries.begin();
+    for ( V_SnapshotEntry::iterator itr = m_Entries.begin(), end = m_Entries.end(); itr != end; ++itr )
+    {
+        if ( last != m_Entries.begin() && ( last - 1 )->m_Hash == itr->m_Hash )
+        {
+            *( last - 1 ) = *itr;
+        }
+        else
+        {
+            *last++ = *itr;
+        }
+    }
+    m_Entries.erase( last, m_Entries.end() );
+
+    return true;
+}
+
+bool SnapshotIndex::Save( const tstring& file )
+{
+    Merge();
+
+    tstring temp = file + TXT( ".tmp" );
+
+    FILE* f = _tfopen( temp.c_str(), TXT( "wb" ) );
+    if ( !f )
+    {
+        Log::Error( TXT( "Unable to open %s for write\n" ), temp.c_str() );
+        return false;
+    }
+
+    SnapshotHeader header;
+    header.m_Magic = SNAPSHOT_MAGIC;
+    header.m_Version = SNAPSHOT_VERSION;
+    header.m_EntrySize = sizeof( SnapshotEntry );
+    header.m_Reserved = 0;
+    header.m_Count = m_Entries.size();
+
+    bool result = fwrite( &header, sizeof( header ), 1, f ) == 1
+        && ( m_Entries.empty() || fwrite( &m_Entries[ 0 ], sizeof( SnapshotEntry ), m_Entries.size(), f ) == m_Entries.size() );
+
+    result = ( fclose( f ) == 0 ) && result;
+
+    if ( !result )
+    {
+        Log::Error( TXT( "Failed to write snapshot index %s\n" ), temp.c_str() );
+        Helium::Delete( temp.c_str() );
+        return false;
+    }
+
+    // a crash before here leaves the old index intact, and the replace itself is atomic
+    if ( !Helium::Replace( temp.c_str(), file.c_str() ) )
+    {
+        Log::Error( TXT( "Failed to replace snapshot index %s\n" ), file.c_str() );
+        Helium::Delete( temp.c_str() );
+        return false;
+    }
+
+    return true;
+}
+
+void SnapshotIndex::Clear()
+{
+    m_Entries.clear();
+    m_Added.clear();
+}
+
+const SnapshotEntry* SnapshotIndex::Find( u64 hash )
+{
+    return Lookup( hash );
+}
+
+void SnapshotIndex::Update( const DirectoryItem& item, const Digest128& digest )
+{
+    u64 hash = Helium::Path( item.m_Path ).Hash();
+
+    SnapshotEntry* entry = Lookup( hash );
+    if ( !entry )
+    {
+        entry = &m_Added[ hash ];
+    }
+
+    Fill( *entry, hash, item, digest, GetCurrentItemTime() );
+}
+
+void SnapshotIndex::Remove( u64 hash )
+{
+    if ( m_Added.erase( hash ) )
+    {
+        return;
+    }
+
+    SnapshotEntry key;
+    key.m_Hash = hash;
+
+    V_SnapshotEntry::iterator found = std::lower_bound( m_Entries.begin(), m_Entries.end(), key, &CompareHash );
+    if ( found != m_Entries.end() && found->m_Hash == hash )
+    {
+        m_Entries.erase( found );
+    }
+}
+
+void SnapshotIndex::Diff( const std::vector< DirectoryItem >& items, SnapshotDiff& diff )
+{
+    diff.Clear();
+
+    Merge();
+
+    // which entries the scan accounted for, the rest were removed
+    std::vector< bool > seen ( m_Entries.size(), false );
+
+    for ( u32 i = 0; i < items.size(); ++i )
+    {
+        const DirectoryItem& item = items[ i ];
+        if ( item.m_Flags & DirectoryItemFlags::Directory )
+        {
+            continue;
+        }
+
+        SnapshotEntry* entry = Lookup( Helium::Path( item.m_Path ).Hash() );
+        if ( entry )
+        {
+            seen[ entry - &m_Entries[ 0 ] ] = true;
+        }
+
+        if ( entry && entry->Matches( item ) )
+        {
+            diff.m_Unchanged.push_back( i );
+        }
+        else
+        {
+            diff.m_Changed.push_back( i );
+        }
+    }
+
+    for ( size_t i = 0; i < m_Entries.size(); ++i )
+    {
+        if ( !seen[ i ] )
+        {
+            diff.m_Removed.push_back( m_Entries[ i ].m_Hash );
+        }
+    }
+}
+
+void SnapshotIndex::Refresh( const std::vector< DirectoryItem >& items, SnapshotDiff& diff )
+{
+    Diff( items, diff );
+
+    u64 now = GetCurrentItemTime();
+
+    std::vector< u64 > removed ( diff.m_Removed );
+
+    // small files hash several at a time
+    std::vector< tstring > files;
+    files.reserve( diff.m_Changed.size() );
+    for ( std::vector< u32 >::const_iterator itr = diff.m_Changed.begin(), end = diff.m_Changed.end(); itr != end; ++itr )
+    {
+        files.push_back( items[ *itr ].m_Path );
+    }
+
+    std::vector< Digest128 > digests;
+    Helium::FileMD5Batch( files, digests );
+
+    for ( u32 i = 0; i < diff.m_Changed.size(); ++i )
+    {
+        const DirectoryItem& item = items[ diff.m_Changed[ i ] ];
+        u64 hash = Helium::Path( item.m_Path ).Hash();
+
+        if ( digests[ i ].IsZero() )
+        {
+            // it went away or can't be read, forget it so the next scan tries again
+            removed.push_back( hash );
+            continue;
+        }
+
+        SnapshotEntry* entry = Lookup( hash );
+        if ( !entry )
+        {
+            entry = &m_Added[ hash ];
+        }
+
+        Fill( *entry, hash, item, digests[ i ], now );
+    }
+
+    if ( !removed.empty() )
+    {
+        std::sort( removed.begin(), removed.end() );
+
+        V_SnapshotEntry::iterator last = m_Entries.begin();
+        for ( V_SnapshotEntry::iterator itr = m_Entries.begin(), end = m_Entries.end(); itr != end; ++itr )
+        {
+            if ( !std::binary_search( removed.begin(), removed.end(), itr->m_Hash ) )
+            {
+                *last++ = *itr;
+            }
+        }
+        m_Entries.erase( last, m_Entries.end() );
+    }
+
+    Merge();
+}
+
+SnapshotEntry* SnapshotIndex::Lookup( u64 hash )
+{
+    std::map< u64, SnapshotEntry >::iterator added = m_Added.find( hash );
+    if ( added != m_Added.end() )
+    {
+        return &added->second;
+    }
+
+    SnapshotEntry key;
+    key.m_Hash = hash;
+
+    V_SnapshotEntry::iterator found = std::lower_bound( m_Entries.begin(), m_Entries.end(), key, &CompareHash );
+    if ( found != m_Entries.end() && found->m_Hash == hash )
+    {
+        return &*found;
+    }
+
+    return NULL;
+}
+
+void SnapshotIndex::Merge()
+{
+    if ( m_Added.empty() )
+    {
+        return;
+    }
+
+    // the map hands the new entries back in hash order, and they are never in m_Entries already, so one merge
+    //  pass keeps everything sorted
+    size_t count = m_Entries.size();
+    m_Entries.reserve( count + m_Added.size() );
+    for ( std::map< u64, SnapshotEntry >::const_iterator itr = m_Added.begin(), end = m_Added.end(); itr != end; ++itr )
+    {
+        m_Entries.push_back( itr->second );
+    }
+    m_Added.clear();
+
+    std::inplace_merge( m_Entries.begin(), m_Entries.begin() + count, m_Entries.end(), &CompareHash );
+}
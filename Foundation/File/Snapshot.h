@@ -0,0 +1,106 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "Platform/Types.h"
+
+#include "Foundation/API.h"
+#include "Foundation/Checksum/Digest.h"
+#include "Foundation/File/Directory.h"
+
+// identifies a snapshot index file, and the layout of its entries
+#define SNAPSHOT_MAGIC      0x504E5348 // 'HSNP'
+#define SNAPSHOT_VERSION    2   // 2: path hashes are XXH3
+
+namespace Helium
+{
+    namespace SnapshotEntryFlags
+    {
+        enum SnapshotEntryFlag
+        {
+            Racy = 1 << 0,  // recorded so soon after it was modified that another write may not have moved its time
+        };
+    }
+    typedef SnapshotEntryFlags::SnapshotEntryFlag SnapshotEntryFlag;
+
+    //
+    // What we knew about a file the last time we hashed it, written to disk as is
+    //
+
+    struct FOUNDATION_API SnapshotEntry
+    {
+        u64         m_Hash;             // Path::Hash of the file's path
+        u64         m_Size;
+        u64         m_ModifiedTime;     // in DirectoryItem units
+        u64         m_Inode;            // 0 where the platform doesn't provide one
+        u32         m_Flags;
+        u32         m_Reserved;
+        Digest128   m_Digest;           // MD5 of the contents
+
+        // is the digest still good for the file the scan found?
+        bool Matches( const DirectoryItem& item ) const;
+    };
+
+    typedef std::vector< SnapshotEntry > V_SnapshotEntry;
+
+    //
+    // The result of comparing a scan with the index
+    //
+
+    struct FOUNDATION_API SnapshotDiff
+    {
+        std::vector< u32 >  m_Changed;      // indices of scanned items that are new or modified, these need hashing
+        std::vector< u32 >  m_Unchanged;    // indices of scanned items whose indexed digest is still good
+        std::vector< u64 >  m_Removed;      // path hashes in the index that the scan didn't find
+
+        void Clear()
+        {
+            m_Changed.clear();
+            m_Unchanged.clear();
+            m_Removed.clear();
+        }
+    };
+
+    //
+    // A compact on-disk record of the stat tuple (size, modified time, inode) and digest of every file we
+    //  have hashed, keyed by path hash, so a fresh scan only needs to rehash files whose tuple moved
+    //
+
+    class FOUNDATION_API SnapshotIndex
+    {
+    public:
+        SnapshotIndex();
+
+        // read an index written by Save(), a missing or unreadable index just leaves this one empty
+        bool Load( const tstring& file );
+
+        // write the index, replacing the file only once the new one is complete
+        bool Save( const tstring& file );
+
+        size_t Count() const
+        {
+            return m_Entries.size() + m_Added.size();
+        }
+
+        void Clear();
+
+        const SnapshotEntry* Find( u64 hash );
+        void Update( const DirectoryItem& item, const Digest128& digest );
+        void Remove( u64 hash );
+
+        // compare the items from a scan (made without DirectoryFlags::NoStat) with the index
+        void Diff( const std::vector< DirectoryItem >& items, SnapshotDiff& diff );
+
+        // diff, rehash the changed files, and drop the removed ones, leaving the index current
+        void Refresh( const std::vector< DirectoryItem >& items, SnapshotDiff& diff );
+
+    private:
+        SnapshotEntry* Lookup( u64 hash );
+        void Merge();
+
+        V_SnapshotEntry                     m_Entries;  // sorted by hash
+        std::map< u64, SnapshotEntry >      m_Added;    // new entries, kept aside until Merge() so adding doesn't re-sort
+
+    };
+}
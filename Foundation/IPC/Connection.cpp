@@ -45,7 +45,12 @@ Connection::Connection()
 , m_ConnectCount (0)
 , m_RemotePlatform ((Helium::Platform::Type)-1)
 , m_NextTransaction (0)
+, m_HostFlags (0)
+, m_RemoteHostFlags (0)
+, m_Pool (new MessagePool)
 {
+    m_Pool->AddRef();
+
     SetState(ConnectionStates::Closed);
 
     if ( !s_RegisteredStringTable )
@@ -65,6 +70,8 @@ Connection::Connection()
 
 Connection::~Connection()
 {
+    // messages still out there keep the pool alive until they are deleted
+    m_Pool->Release();
 }
 
 bool Connection::Initialize(bool server, const tchar* name)
@@ -89,7 +96,7 @@ void Connection::Cleanup()
     if (!m_Terminating)
     {
         m_Terminating = true;
-        m_Terminate.Signal();
+        SetTerminate(true);
 
         if (m_ConnectThread.Valid())
         {
@@ -106,7 +113,7 @@ void Connection::Cleanup()
         SetState(ConnectionStates::Closed);
 
         m_Terminating = false;
-        m_Terminate.Reset();
+        SetTerminate(false);
     }
 }
 
@@ -169,7 +176,7 @@ Message* Connection::CreateMessage(u32 id, u32 size, i32 trans, u32 type)
         }
     }
 
-    IPC::Message* msg = new Message (id, trans, size, type);
+    IPC::Message* msg = new (m_Pool) Message (m_Pool, id, trans, size, type);
 
     if (!msg)
     {
@@ -246,6 +253,18 @@ void Connection::CleanupThread()
     // nothing to do by default
 }
 
+void Connection::SetTerminate(bool terminate)
+{
+    if (terminate)
+    {
+        m_Terminate.Signal();
+    }
+    else
+    {
+        m_Terminate.Reset();
+    }
+}
+
 bool Connection::ReadPump()
 {
     Message* msg = NULL;
@@ -283,18 +302,43 @@ bool Connection::WritePump()
 {
     bool result = false;
 
+    Message* msgs[IPC_WRITE_BATCH_MESSAGES];
+    u32 count = 0;
+    u32 bytes = 0;
+    bool woken = false;
+
     Message* msg = m_WriteQueue.Remove();
-    if (msg)
+    while (msg)
+    {
+        msgs[count++] = msg;
+        bytes += sizeof(MessageHeader) + msg->GetSize();
+
+        // don't wait for more, just pick up whatever was queued while we were waiting or writing
+        if (count == IPC_WRITE_BATCH_MESSAGES || bytes >= IPC_WRITE_BATCH_SIZE || m_WriteQueue.Count() == 0)
+        {
+            break;
+        }
+
+        msg = m_WriteQueue.Remove();
+
+        // a null message is someone waking us to notice a disconnect, finish the batch first
+        woken = msg == NULL;
+    }
+
+    if (count)
     {
         // the result will be true unless there was heinous breakage
-        result = WriteMessage(msg);
+        result = WriteMessages(msgs, count) && !woken;
 
+        for (u32 i=0; i<count; i++)
+        {
 #ifdef IPC_CONNECTION_DEBUG
-        Helium::Print("%s: Put message %d, id '%d', transaction '%d', size '%d'\n", m_Name, msg->GetNumber(), msg->GetID(), msg->GetTransaction(), msg->GetSize());
+            Helium::Print("%s: Put message %d, id '%d', transaction '%d', size '%d'\n", m_Name, msgs[i]->GetNumber(), msgs[i]->GetID(), msgs[i]->GetTransaction(), msgs[i]->GetSize());
 #endif
 
-        // free the memory
-        delete msg;
+            // free the memory
+            delete msgs[i];
+        }
     }
 
     // there was a failure
@@ -307,6 +351,19 @@ bool Connection::WritePump()
     return result;
 }
 
+bool Connection::WriteMessages(Message** msgs, u32 count)
+{
+    for (u32 i=0; i<count; i++)
+    {
+        if (!WriteMessage(msgs[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void Connection::ReadThread()
 {
     while (1)
@@ -469,14 +526,15 @@ bool Connection::ReadHostType()
         return false;
     }
 
-    m_RemotePlatform = (Helium::Platform::Type)byte;
+    m_RemotePlatform = (Helium::Platform::Type)(byte & ~HostFlags::All);
+    m_RemoteHostFlags = byte & HostFlags::All;
 
     return true;
 }
 
 bool Connection::WriteHostType()
 {
-    u8 byte = (u8)Helium::Platform::GetType();
+    u8 byte = (u8)Helium::Platform::GetType() | m_HostFlags;
     if (!Write(&byte, sizeof(byte)))
     {
         Localization::Statement stmt( "Helium::IPC::Connection", "RemotePlatformTypeWriteFailed" );
@@ -8,6 +8,11 @@
 
 #include "Foundation/Localization.h"
 
+// the most the write pump hands to the connection at once, it only takes what is already queued so a lone
+//  message is never held back waiting for company
+#define IPC_WRITE_BATCH_MESSAGES    32
+#define IPC_WRITE_BATCH_SIZE        ( 256 << 10 )
+
 namespace Helium
 {
     namespace IPC
@@ -35,6 +40,17 @@ namespace Helium
         }
         typedef MessageTypes::MessageType MessageType;
 
+        // capabilities carried in the high bit(s) of the host type byte, only sent to peers known to understand them
+        namespace HostFlags
+        {
+            enum HostFlag
+            {
+                Duplex  = 1 << 7,   // reads and writes share one stream
+                All     = Duplex,
+            };
+        }
+        typedef HostFlags::HostFlag HostFlag;
+
         class FOUNDATION_API Connection
         {
         protected:
@@ -50,10 +66,13 @@ namespace Helium
             u32                     m_ConnectCount;       // track the number of connection that have occured
             Helium::Platform::Type  m_RemotePlatform;     // the platform of the end point on the other side
             i32                     m_NextTransaction;    // next transaction id for this connection endpoint
+            u8                      m_HostFlags;          // HostFlags we send in the host type handshake
+            u8                      m_RemoteHostFlags;    // HostFlags the other end sent
 
             Helium::Mutex           m_Mutex;              // mutex to protect access to this class
+            MessagePool*            m_Pool;               // where this connection's messages come from and go back to
             MessageQueue            m_ReadQueue;          // incoming messages
-            MessageQueue            m_WriteQueue;         // outgoing messages
+            LockFreeMessageQueue    m_WriteQueue;         // outgoing messages, any thread sends but only the write thread takes
 
             Helium::Thread          m_ConnectThread;      // handle of the core thread that manages the connection, once
             Helium::Thread          m_ReadThread;         // handle of the thread reads from the pipe (incomming)
@@ -115,6 +134,12 @@ namespace Helium
             // did this endpoint create the specified transaction
             bool CreatedMessage(i32 transaction);
 
+            // how well the message pool is keeping up, misses after startup mean allocations in steady state
+            void GetPoolStats(MessagePoolStats& stats)
+            {
+                m_Pool->GetStats(stats);
+            }
+
             // wait in the calling thread for a message
             void Wait();
 
@@ -137,7 +162,8 @@ namespace Helium
             //  Receive
             //
             //  Gets a message from the input queue, the pointer is filled in with the address and once
-            //  you have it you own it and must delete it when you are finished with it. If there are no
+            //  you have it you own it and must delete it when you are finished with it (which recycles
+            //  it into the connection's pool). If there are no
             //  messages in the queue or the connection is not active the pointer is set to NULL.
             //
             virtual ConnectionState Receive(Message** msg, bool wait = false);
@@ -151,10 +177,16 @@ namespace Helium
             // Do any necessary cleanup on the current thread
             virtual void CleanupThread();
 
+            // Signal or reset m_Terminate, override to also wake up anything else the connection threads block on
+            virtual void SetTerminate(bool terminate);
+
             // These synchronously perform a single message read or write operation
             virtual bool ReadMessage(Message** msg) = 0;
             virtual bool WriteMessage(Message* msg) = 0;
 
+            // Writes a batch of messages in queue order, by default one at a time through WriteMessage
+            virtual bool WriteMessages(Message** msgs, u32 count);
+
             // These synchronously read or write data through the connection
             virtual bool Read(void* buffer, u32 bytes) = 0;
             virtual bool Write(void* buffer, u32 bytes) = 0;
@@ -162,7 +194,8 @@ namespace Helium
             // ReadPump blocks on incoming data for message creation
             bool ReadPump();
 
-            // WritePump blocks on messages being appended to the write queue
+            // WritePump blocks on messages being appended to the write queue, then writes everything
+            //  queued behind the first one (up to the batch limits) together
             bool WritePump();
 
             // ReadThread and WriteThread run the read and write pumps until the
@@ -182,10 +215,10 @@ namespace Helium
             void SendProtocolMessage(u32 message);
 
             // Send host type message
-            bool WriteHostType();
+            virtual bool WriteHostType();
 
             // Receive host type message
-            bool ReadHostType();
+            virtual bool ReadHostType();
         };
     }
 }
\ No newline at end of file
@@ -1,17 +1,18 @@
 #include "Platform/API.h"
 #include "Message.h"
 #include "Platform/Assert.h"
+#include "Platform/Atomic.h"
 
 using namespace Helium::IPC;
 
-Message::Message(u32 id, i32 trn, u32 size, u32 type)
+Message::Message(MessagePool* pool, u32 id, i32 trn, u32 size, u32 type)
 : MessageHeader( id, trn, size, type )
 , m_Next (NULL)
 , m_Number (0)
 {
     if (size)
     {
-        m_Data = new u8[size];
+        m_Data = pool->AllocateData(size);
     }
     else
     {
@@ -23,7 +24,7 @@ Message::~Message()
 {
     if (m_Data)
     {
-        delete [] m_Data;
+        MessagePool::Free(m_Data);
         m_Data = 0;
     }
 }
@@ -162,3 +163,162 @@ void MessageQueue::Wait()
         m_Append.Increment();
     }
 }
+
+LockFreeMessageQueue::LockFreeMessageQueue()
+: m_Incoming (NULL)
+, m_Head (NULL)
+, m_Count (0)
+, m_Total (0)
+, m_Pending (0)
+{
+
+}
+
+LockFreeMessageQueue::~LockFreeMessageQueue()
+{
+    Clear();
+}
+
+void LockFreeMessageQueue::Add(Message* msg)
+{
+    IPC_SCOPE_TIMER("");
+
+    // like MessageQueue a null message still wakes the consumer, that's how it gets told to quit
+    if (msg)
+    {
+        msg->SetNumber( Helium::AtomicIncrement( &m_Total ) );
+        Helium::AtomicIncrement( &m_Count );
+
+        Message* head = Helium::AtomicLoad( &m_Incoming, Helium::MemoryOrders::Relaxed );
+        while (true)
+        {
+            msg->m_Next = head;
+
+            Message* previous = Helium::AtomicCompareExchange( &m_Incoming, msg, head, Helium::MemoryOrders::Release );
+            if (previous == head)
+            {
+                break;
+            }
+
+            head = previous;
+        }
+    }
+
+    Release();
+}
+
+Message* LockFreeMessageQueue::Remove()
+{
+    IPC_SCOPE_TIMER("");
+
+    Acquire();
+
+    if (m_Head == NULL)
+    {
+        // take everything pushed so far, it comes off the stack newest first so reverse it
+        Message* msg = Helium::AtomicExchange( &m_Incoming, (Message*)NULL, Helium::MemoryOrders::Acquire );
+        while (msg)
+        {
+            Message* next = msg->m_Next;
+            msg->m_Next = m_Head;
+            m_Head = msg;
+            msg = next;
+        }
+    }
+
+    Message* result = m_Head;
+    if (result)
+    {
+        m_Head = result->m_Next;
+        result->m_Next = NULL;
+        Helium::AtomicDecrement( &m_Count );
+    }
+
+    return result;
+}
+
+void LockFreeMessageQueue::Clear()
+{
+    IPC_SCOPE_TIMER("");
+
+    Message* msg = m_Head;
+    while (msg)
+    {
+        Message* next = msg->m_Next;
+        delete msg;
+        msg = next;
+    }
+
+    msg = Helium::AtomicExchange( &m_Incoming, (Message*)NULL, Helium::MemoryOrders::Acquire );
+    while (msg)
+    {
+        Message* next = msg->m_Next;
+        delete msg;
+        msg = next;
+    }
+
+    m_Head = NULL;
+    Helium::AtomicStore( &m_Count, 0 );
+    Helium::AtomicStore( &m_Total, 0 );
+
+    // let a parked consumer go, it will find the queue empty
+    if (Helium::AtomicExchange( &m_Pending, 0 ) < 0)
+    {
+        m_Wake.Increment();
+    }
+}
+
+u32 LockFreeMessageQueue::Count()
+{
+    return Helium::AtomicLoad( &m_Count );
+}
+
+u32 LockFreeMessageQueue::Total()
+{
+    return Helium::AtomicLoad( &m_Total );
+}
+
+void LockFreeMessageQueue::Wait()
+{
+    Acquire();
+
+    // this will be zero if the queue was cleared by another thread
+    if ( Helium::AtomicLoad( &m_Total ) )
+    {
+        // give back what we took, so the message is still there for Remove
+        Release();
+    }
+}
+
+void LockFreeMessageQueue::Acquire()
+{
+    // most of the time a producer is about to add something, so poll a little before going to sleep
+    for (u32 i = 0; i < IPC_QUEUE_SPIN_COUNT; ++i)
+    {
+        i32 pending = Helium::AtomicLoad( &m_Pending );
+        if (pending <= 0)
+        {
+            continue;
+        }
+
+        if (Helium::AtomicCompareExchange( &m_Pending, pending - 1, pending ) == pending)
+        {
+            return;
+        }
+    }
+
+    // going negative tells the producers we are (about to be) asleep
+    if (Helium::AtomicDecrement( &m_Pending ) < 0)
+    {
+        m_Wake.Decrement();
+    }
+}
+
+void LockFreeMessageQueue::Release()
+{
+    // only enter the kernel if the consumer parked
+    if (Helium::AtomicIncrement( &m_Pending ) <= 0)
+    {
+        m_Wake.Increment();
+    }
+}
@@ -4,6 +4,10 @@
 #include "Platform/Semaphore.h"
 #include "Foundation/API.h"
 #include "IPC.h"
+#include "MessagePool.h"
+
+// times a consumer polls an empty lock free queue before it parks
+#define IPC_QUEUE_SPIN_COUNT 100
 
 namespace Helium
 {
@@ -44,6 +48,7 @@ namespace Helium
         {
             friend class Connection;
             friend class MessageQueue;
+            friend class LockFreeMessageQueue;
 
         private:
             Message*  m_Next;
@@ -51,11 +56,28 @@ namespace Helium
             u8*       m_Data;
 
         private:
-            Message(u32 id, i32 trans, u32 size, u32 type);
+            Message(MessagePool* pool, u32 id, i32 trans, u32 size, u32 type);
+
+            // messages and their data live in their connection's pool, deleting one recycles both
+            static void* operator new(size_t size, MessagePool* pool)
+            {
+                return pool->AllocateMessage(size);
+            }
+
+            // only called if the constructor throws, the block already knows which pool it came from
+            static void operator delete(void* ptr, MessagePool*)
+            {
+                MessagePool::Free(ptr);
+            }
 
         public:
             ~Message();
 
+            static void operator delete(void* ptr)
+            {
+                MessagePool::Free(ptr);
+            }
+
             u32 GetNumber() const
             {
                 return m_Number;
@@ -91,12 +113,18 @@ namespace Helium
                 return m_Data;
             }
 
+            // the caller owns the data afterward, and must give it back with FreeData (not delete[])
             u8* TakeData()
             {
                 u8* data = m_Data;
                 m_Data = NULL;
                 return data;
             }
+
+            static void FreeData(u8* data)
+            {
+                MessagePool::Free(data);
+            }
         };
 
         class FOUNDATION_API MessageQueue
@@ -121,5 +149,39 @@ namespace Helium
             u32 Total();
             void Wait();
         };
+
+        //
+        // Same interface as MessageQueue, but any number of threads can Add without taking a lock: they push
+        //  onto a stack with a compare exchange, and the one thread allowed to Remove (or Wait) takes the whole
+        //  stack at once and reverses it into arrival order.  The consumer spins briefly on an empty queue and
+        //  then parks on a semaphore that producers only touch when it is actually asleep.
+        //
+
+        class FOUNDATION_API LockFreeMessageQueue
+        {
+        private:
+            Message* volatile m_Incoming;   // messages pushed by producers, newest first
+            Message* m_Head;                // messages taken by the consumer, oldest first
+            volatile i32 m_Count;           // number of messages in queue
+            volatile i32 m_Total;           // number of messages that have passed through the queue since clear
+
+            volatile i32 m_Pending;         // adds not yet consumed, negative while the consumer is parked
+            Helium::Semaphore m_Wake;       // the consumer sleeps on this once spinning gives up
+
+        public:
+            LockFreeMessageQueue();
+            ~LockFreeMessageQueue();
+
+            void Add(Message*);
+            Message* Remove();
+            void Clear();
+            u32 Count();
+            u32 Total();
+            void Wait();
+
+        private:
+            void Acquire();
+            void Release();
+        };
     }
 }
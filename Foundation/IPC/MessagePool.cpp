@@ -0,0 +1,168 @@
+#include "Platform/API.h"
+#include "MessagePool.h"
+
+#include "Platform/Assert.h"
+#include "Platform/Atomic.h"
+
+#include <algorithm>
+
+using namespace Helium;
+using namespace Helium::IPC;
+
+// the class of message objects, and of payloads that didn't fit a class
+#define IPC_POOL_MESSAGE_CLASS      IPC_POOL_SIZE_CLASSES
+#define IPC_POOL_OVERSIZED          0xFFFFFFFF
+
+namespace Helium
+{
+    namespace IPC
+    {
+        // sits in front of every block, 16 bytes so payloads stay 16 byte aligned
+        struct MessageBlock
+        {
+            MessagePool*    m_Pool;
+            u32             m_Class;
+            u8              m_Padding[ 16 - sizeof( MessagePool* ) - sizeof( u32 ) ];
+
+            // while the block is free its first bytes link it to the next one
+            MessageBlock*& Next()
+            {
+                return *(MessageBlock**)( this + 1 );
+            }
+        };
+    }
+}
+
+static inline u32 GetClassSize( u32 sizeClass )
+{
+    return IPC_POOL_MIN_BLOCK_SIZE << ( sizeClass * 2 );
+}
+
+MessagePool::MessagePool()
+: m_References( 0 )
+{
+    for ( u32 i = 0; i <= IPC_POOL_SIZE_CLASSES; ++i )
+    {
+        m_FreeBlocks[ i ] = NULL;
+        m_FreeCounts[ i ] = 0;
+    }
+}
+
+MessagePool::~MessagePool()
+{
+    for ( u32 i = 0; i <= IPC_POOL_SIZE_CLASSES; ++i )
+    {
+        while ( m_FreeBlocks[ i ] )
+        {
+            MessageBlock* block = m_FreeBlocks[ i ];
+            m_FreeBlocks[ i ] = block->Next();
+            delete[] (u8*)block;
+        }
+    }
+}
+
+void MessagePool::AddRef()
+{
+    AtomicIncrement( &m_References );
+}
+
+void MessagePool::Release()
+{
+    if ( AtomicDecrement( &m_References ) == 0 )
+    {
+        delete this;
+    }
+}
+
+void* MessagePool::AllocateMessage( size_t size )
+{
+    return Allocate( IPC_POOL_MESSAGE_CLASS, size );
+}
+
+u8* MessagePool::AllocateData( u32 size )
+{
+    for ( u32 i = 0; i < IPC_POOL_SIZE_CLASSES; ++i )
+    {
+        if ( size <= GetClassSize( i ) )
+        {
+            return (u8*)Allocate( i, GetClassSize( i ) );
+        }
+    }
+
+    return (u8*)Allocate( IPC_POOL_OVERSIZED, size );
+}
+
+void MessagePool::Free( void* data )
+{
+    if ( data )
+    {
+        MessageBlock* block = (MessageBlock*)data - 1;
+        MessagePool* pool = block->m_Pool;
+        pool->Recycle( block );
+        pool->Release();
+    }
+}
+
+void MessagePool::GetStats( MessagePoolStats& stats )
+{
+    Helium::TakeMutex lock ( m_Lock );
+    stats = m_Stats;
+}
+
+void* MessagePool::Allocate( u32 sizeClass, size_t size )
+{
+    MessageBlock* block = NULL;
+
+    {
+        Helium::TakeMutex lock ( m_Lock );
+
+        if ( sizeClass == IPC_POOL_OVERSIZED )
+        {
+            m_Stats.m_Oversized++;
+        }
+        else if ( m_FreeBlocks[ sizeClass ] )
+        {
+            block = m_FreeBlocks[ sizeClass ];
+            m_FreeBlocks[ sizeClass ] = block->Next();
+            m_FreeCounts[ sizeClass ]--;
+            m_Stats.m_Free--;
+            m_Stats.m_Hits++;
+        }
+        else
+        {
+            m_Stats.m_Misses++;
+        }
+    }
+
+    if ( !block )
+    {
+        // the free list link needs room in an empty block too
+        block = (MessageBlock*)new u8[ sizeof( MessageBlock ) + std::max< size_t >( size, sizeof( MessageBlock* ) ) ];
+        block->m_Pool = this;
+        block->m_Class = sizeClass;
+    }
+
+    AddRef();
+    return block + 1;
+}
+
+void MessagePool::Recycle( MessageBlock* block )
+{
+    HELIUM_ASSERT( block->m_Pool == this );
+
+    if ( block->m_Class != IPC_POOL_OVERSIZED )
+    {
+        Helium::TakeMutex lock ( m_Lock );
+
+        if ( m_FreeCounts[ block->m_Class ] < IPC_POOL_MAX_FREE_BLOCKS )
+        {
+            block->Next() = m_FreeBlocks[ block->m_Class ];
+            m_FreeBlocks[ block->m_Class ] = block;
+            m_FreeCounts[ block->m_Class ]++;
+            m_Stats.m_Free++;
+            return;
+        }
+    }
+
+    delete[] (u8*)block;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Platform/Types.h"
+#include "Platform/Mutex.h"
+
+#include "Foundation/API.h"
+
+// payload size classes, each 4 times the one before: 64 bytes up to 64k, bigger payloads are allocated to size
+#define IPC_POOL_MIN_BLOCK_SIZE     64
+#define IPC_POOL_SIZE_CLASSES       6
+
+// free blocks each class holds on to, so a burst of traffic doesn't stay allocated forever
+#define IPC_POOL_MAX_FREE_BLOCKS    64
+
+namespace Helium
+{
+    namespace IPC
+    {
+        struct MessageBlock;
+
+        struct MessagePoolStats
+        {
+            u32 m_Hits;         // allocations served from a free list
+            u32 m_Misses;       // allocations that had to go to the heap
+            u32 m_Oversized;    // payloads too big for any class, these always go to the heap
+            u32 m_Free;         // blocks sitting in the free lists
+
+            MessagePoolStats()
+                : m_Hits( 0 )
+                , m_Misses( 0 )
+                , m_Oversized( 0 )
+                , m_Free( 0 )
+            {
+            }
+        };
+
+        //
+        // Recycles message objects and payloads for a connection, so once traffic settles sending and receiving
+        //  don't touch the heap.  Every block remembers its pool, so deleting a message (or freeing data taken
+        //  from one) on any thread puts it back where it came from.  The connection and each block handed out
+        //  hold a reference, so messages can outlive their connection.
+        //
+
+        class FOUNDATION_API MessagePool
+        {
+        public:
+            MessagePool();
+
+            void AddRef();
+            void Release();
+
+            void* AllocateMessage( size_t size );
+            u8* AllocateData( u32 size );
+
+            // give a block back to whichever pool it came from
+            static void Free( void* data );
+
+            void GetStats( MessagePoolStats& stats );
+
+        private:
+            ~MessagePool();
+
+            void* Allocate( u32 sizeClass, size_t size );
+            void Recycle( MessageBlock* block );
+
+            Helium::Mutex       m_Lock;                                     // guards the free lists and stats
+            MessageBlock*       m_FreeBlocks[ IPC_POOL_SIZE_CLASSES + 1 ];  // the last list is message objects
+            u32                 m_FreeCounts[ IPC_POOL_SIZE_CLASSES + 1 ];
+            MessagePoolStats    m_Stats;
+            volatile i32        m_References;
+        };
+    }
+}
@@ -0,0 +1,731 @@
+#include "Platform/API.h"
+#include "SharedMemory.h"
+
+#ifdef WIN32
+# include "Platform/Windows/Windows.h"
+#else
+# include <errno.h>
+# include <fcntl.h>
+# include <signal.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "Platform/POSIX/Futex.h"
+#endif
+
+#include "Platform/Atomic.h"
+#include "Platform/Error.h"
+#include "Platform/String.h"
+
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+
+using namespace Helium;
+using namespace Helium::IPC;
+
+// 'HeSM', written last by the server so a client never uses a half initialized region
+#define IPC_SHARED_MAGIC            0x4D536548
+
+// the region starts with a page of bookkeeping, then the rings
+#define IPC_SHARED_HEADER_SIZE      4096
+#define IPC_SHARED_REGION_SIZE      ( IPC_SHARED_HEADER_SIZE + 2 * IPC_SHARED_RING_SIZE )
+
+HELIUM_COMPILE_ASSERT( ( IPC_SHARED_RING_SIZE & ( IPC_SHARED_RING_SIZE - 1 ) ) == 0 );
+
+namespace Helium
+{
+    namespace IPC
+    {
+        namespace SharedBells
+        {
+            enum SharedBell
+            {
+                Data,       // rung by the producer after it writes
+                Space,      // rung by the consumer after it reads
+                Count,
+            };
+        }
+        typedef SharedBells::SharedBell SharedBell;
+
+        // each side's index is on its own cache line, so the producer and consumer don't fight over one
+        struct SharedRing
+        {
+            volatile i32    m_Head;                             // bytes ever written (wrapping), stored by the producer
+            u8              m_HeadPadding[ 60 ];
+            volatile i32    m_Tail;                             // bytes ever read (wrapping), stored by the consumer
+            u8              m_TailPadding[ 60 ];
+            volatile i32    m_Bells[ SharedBells::Count ];      // bumped every time the matching bell is rung
+            volatile i32    m_Sleepers[ SharedBells::Count ];   // set while a side is (about to be) asleep on the bell
+            u8              m_BellPadding[ 48 ];
+        };
+
+        struct SharedRegion
+        {
+            volatile i32    m_Magic;
+            u32             m_RingSize;
+            volatile i32    m_ServerProcess;    // process id of the server, zero once it has gone
+            volatile i32    m_ClientProcess;    // process id of the attached client, zero while there isn't one
+            volatile i32    m_Closed;           // one side has left the current connection
+            u8              m_Padding[ 44 ];
+            SharedRing      m_Rings[ 2 ];       // server to client, then client to server
+        };
+    }
+}
+
+HELIUM_COMPILE_ASSERT( sizeof( SharedRegion ) <= IPC_SHARED_HEADER_SIZE );
+
+static i32 GetCurrentProcessID()
+{
+#ifdef WIN32
+    return (i32)::GetCurrentProcessId();
+#else
+    return (i32)getpid();
+#endif
+}
+
+static bool ProcessAlive( i32 process )
+{
+#ifdef WIN32
+    HANDLE handle = ::OpenProcess( SYNCHRONIZE, FALSE, (DWORD)process );
+    if ( !handle )
+    {
+        return false;
+    }
+
+    bool alive = ::WaitForSingleObject( handle, 0 ) == WAIT_TIMEOUT;
+    ::CloseHandle( handle );
+    return alive;
+#else
+    return ::kill( (pid_t)process, 0 ) == 0 || errno == EPERM;
+#endif
+}
+
+static bool RingReady( SharedRing* ring, u32 bell )
+{
+    u32 used = (u32)AtomicLoad( &ring->m_Head ) - (u32)AtomicLoad( &ring->m_Tail );
+    return bell == SharedBells::Data ? used > 0 : used < IPC_SHARED_RING_SIZE;
+}
+
+SharedMemoryConnection::SharedMemoryConnection()
+: m_Region (NULL)
+, m_ReadRing (NULL)
+, m_ReadData (NULL)
+, m_WriteRing (NULL)
+, m_WriteData (NULL)
+, m_RemoteProcess (0)
+#ifdef WIN32
+, m_Mapping (NULL)
+#else
+, m_File (-1)
+#endif
+{
+    m_RegionName[0] = '\0';
+
+#ifdef WIN32
+    for ( u32 i = 0; i < 4; ++i )
+    {
+        m_Events[i] = NULL;
+    }
+#endif
+}
+
+SharedMemoryConnection::~SharedMemoryConnection()
+{
+    // other threads still need our object's virtual functions, so call this in the derived destructor
+    Cleanup();
+}
+
+bool SharedMemoryConnection::Initialize(bool server, const tchar* name, const tchar* region_name)
+{
+    if (!Connection::Initialize(server, name))
+    {
+        return false;
+    }
+
+    _tcscpy(m_RegionName, region_name);
+
+    SetState(ConnectionStates::Waiting);
+
+    Helium::Thread::Entry serverEntry = Helium::Thread::EntryHelper<SharedMemoryConnection, &SharedMemoryConnection::ServerThread>;
+    Helium::Thread::Entry clientEntry = Helium::Thread::EntryHelper<SharedMemoryConnection, &SharedMemoryConnection::ClientThread>;
+    if (!m_ConnectThread.Create(server ? serverEntry : clientEntry, this, "IPC Connection Thread" ))
+    {
+        Helium::Print( TXT( "%s: Failed to create connect thread\n" ), m_Name);
+        SetState(ConnectionStates::Failed);
+        return false;
+    }
+
+    return true;
+}
+
+void SharedMemoryConnection::ServerThread()
+{
+    Helium::Print( TXT( "%s: Starting shared memory server '%s'\n" ), m_Name, m_RegionName);
+
+    if (!Map(true))
+    {
+        SetState(ConnectionStates::Failed);
+        return;
+    }
+
+    // while the server is still running, cycle through connections
+    while (!m_Terminating)
+    {
+        Helium::Print( TXT( "%s: Ready for client\n" ), m_Name);
+
+        // wait for a client to attach
+        while (!m_Terminating)
+        {
+            m_RemoteProcess = AtomicLoad( &m_Region->m_ClientProcess );
+            if (m_RemoteProcess)
+            {
+                break;
+            }
+
+            Helium::Sleep(10);
+        }
+
+        if (!m_Terminating)
+        {
+            // do connection
+            ConnectThread();
+        }
+
+        // tell the client we are done, and wait for it to let go before the rings are reused
+        AtomicStore( &m_Region->m_Closed, 1 );
+        WakeRings();
+
+        while (!m_Terminating && m_RemoteProcess && RemoteAlive())
+        {
+            Helium::Sleep(10);
+        }
+
+        m_RemoteProcess = 0;
+        ResetRings();
+        AtomicStore( &m_Region->m_ClientProcess, 0 );
+        AtomicStore( &m_Region->m_Closed, 0 );
+
+        if (!m_Terminating)
+        {
+            // reset back to waiting for connections
+            SetState(ConnectionStates::Waiting);
+        }
+    }
+
+    AtomicStore( &m_Region->m_ServerProcess, 0 );
+    Unmap();
+
+    Helium::Print( TXT( "%s: Stopping shared memory server '%s'\n" ), m_Name, m_RegionName);
+}
+
+void SharedMemoryConnection::ClientThread()
+{
+    Helium::Print( TXT( "%s: Starting shared memory client '%s'\n" ), m_Name, m_RegionName);
+
+    while (!m_Terminating)
+    {
+        Helium::Print( TXT( "%s: Ready for server\n" ), m_Name);
+
+        // wait for the server to create the region and for it to be free
+        while (!m_Terminating && !Attach())
+        {
+            Helium::Sleep(100);
+        }
+
+        if (!m_Terminating)
+        {
+            // do connection
+            ConnectThread();
+        }
+
+        Detach();
+
+        if (!m_Terminating)
+        {
+            // return to waiting
+            SetState(ConnectionStates::Waiting);
+        }
+    }
+
+    Helium::Print( TXT( "%s: Stopping shared memory client '%s'\n" ), m_Name, m_RegionName);
+}
+
+bool SharedMemoryConnection::ReadMessage(Message** msg)
+{
+    IPC_SCOPE_TIMER("");
+
+    {
+        IPC_SCOPE_TIMER("Read Message Header");
+
+        // both ends are on this machine, so there is no byte order to fix up
+        if (!Read(&m_ReadHeader, sizeof(m_ReadHeader)))
+        {
+            return false;
+        }
+    }
+
+    IPC::Message* message = CreateMessage(m_ReadHeader.m_ID, m_ReadHeader.m_Size, m_ReadHeader.m_TRN, m_ReadHeader.m_Type);
+
+    // out of memory condition
+    if ( message == NULL )
+    {
+        Helium::Print( TXT( "%s: Failed to allocate memory for message\n" ), m_Name);
+        return false;
+    }
+
+    u8* data = message->GetData();
+
+    // out of memory condition #2
+    if ( m_ReadHeader.m_Size > 0 && data == NULL )
+    {
+        Helium::Print( TXT( "%s: Failed to allocate memory for message data\n" ), m_Name);
+        delete message;
+        return false;
+    }
+
+    {
+        IPC_SCOPE_TIMER("Read Message Data");
+
+        if (!Read(data, m_ReadHeader.m_Size))
+        {
+            delete message;
+            return false;
+        }
+    }
+
+    *msg = message;
+
+    return true;
+}
+
+bool SharedMemoryConnection::WriteMessage(Message* msg)
+{
+    IPC_SCOPE_TIMER("");
+
+    m_WriteHeader.m_ID = msg->GetID();
+    m_WriteHeader.m_TRN = msg->GetTransaction();
+    m_WriteHeader.m_Size = msg->GetSize();
+    m_WriteHeader.m_Type = msg->GetType();
+
+    {
+        IPC_SCOPE_TIMER("Write Message Header");
+
+        if (!Write(&m_WriteHeader, sizeof(m_WriteHeader)))
+        {
+            return false;
+        }
+    }
+
+    {
+        IPC_SCOPE_TIMER("Write Message Data");
+
+        if (!Write(msg->GetData(), msg->GetSize()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SharedMemoryConnection::Read(void* buffer, u32 bytes)
+{
+    u8* dest = (u8*)buffer;
+    u32 bytes_left = bytes;
+
+    while (bytes_left > 0)
+    {
+        if (m_Terminating)
+        {
+            return false;
+        }
+
+        u32 tail = (u32)AtomicLoad( &m_ReadRing->m_Tail, MemoryOrders::Relaxed );
+        u32 head = (u32)AtomicLoad( &m_ReadRing->m_Head, MemoryOrders::Acquire );
+        u32 count = std::min( head - tail, bytes_left );
+
+        if (count == 0)
+        {
+            if (!WaitForRing(m_ReadRing, SharedBells::Data))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        // the data may wrap around the end of the ring
+        u32 offset = tail & ( IPC_SHARED_RING_SIZE - 1 );
+        u32 first = std::min( count, IPC_SHARED_RING_SIZE - offset );
+        memcpy( dest, m_ReadData + offset, first );
+        memcpy( dest + first, m_ReadData, count - first );
+
+        AtomicStore( &m_ReadRing->m_Tail, (i32)( tail + count ), MemoryOrders::Release );
+        RingBell(m_ReadRing, SharedBells::Space);
+
+        dest += count;
+        bytes_left -= count;
+    }
+
+    return true;
+}
+
+bool SharedMemoryConnection::Write(void* buffer, u32 bytes)
+{
+    const u8* src = (const u8*)buffer;
+    u32 bytes_left = bytes;
+
+    while (bytes_left > 0)
+    {
+        if (m_Terminating)
+        {
+            return false;
+        }
+
+        u32 head = (u32)AtomicLoad( &m_WriteRing->m_Head, MemoryOrders::Relaxed );
+        u32 tail = (u32)AtomicLoad( &m_WriteRing->m_Tail, MemoryOrders::Acquire );
+        u32 count = std::min( IPC_SHARED_RING_SIZE - ( head - tail ), bytes_left );
+
+        if (count == 0)
+        {
+            if (!WaitForRing(m_WriteRing, SharedBells::Space))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        u32 offset = head & ( IPC_SHARED_RING_SIZE - 1 );
+        u32 first = std::min( count, IPC_SHARED_RING_SIZE - offset );
+        memcpy( m_WriteData + offset, src, first );
+        memcpy( m_WriteData, src + first, count - first );
+
+        AtomicStore( &m_WriteRing->m_Head, (i32)( head + count ), MemoryOrders::Release );
+        RingBell(m_WriteRing, SharedBells::Data);
+
+        src += count;
+        bytes_left -= count;
+    }
+
+    return true;
+}
+
+bool SharedMemoryConnection::Attach()
+{
+    if (!m_Region && !Map(false))
+    {
+        return false;
+    }
+
+    if ( AtomicLoad( &m_Region->m_Magic ) != IPC_SHARED_MAGIC || m_Region->m_RingSize != IPC_SHARED_RING_SIZE )
+    {
+        Unmap();
+        return false;
+    }
+
+    // a region left behind by a server that went away, map again next time in case a new server replaced it
+    i32 server = AtomicLoad( &m_Region->m_ServerProcess );
+    if ( !server || !ProcessAlive( server ) )
+    {
+        Unmap();
+        return false;
+    }
+
+    // the server is still tidying up after the last client
+    if ( AtomicLoad( &m_Region->m_Closed ) )
+    {
+        return false;
+    }
+
+    if ( AtomicCompareExchange( &m_Region->m_ClientProcess, GetCurrentProcessID(), 0 ) != 0 )
+    {
+        return false;
+    }
+
+    m_RemoteProcess = server;
+    return true;
+}
+
+void SharedMemoryConnection::Detach()
+{
+    if (m_Region)
+    {
+        if ( AtomicLoad( &m_Region->m_ClientProcess ) == GetCurrentProcessID() )
+        {
+            // wake the server's threads so they see we are gone, then give up our claim
+            AtomicStore( &m_Region->m_Closed, 1 );
+            WakeRings();
+            AtomicStore( &m_Region->m_ClientProcess, 0 );
+        }
+
+        Unmap();
+    }
+
+    m_RemoteProcess = 0;
+}
+
+void SharedMemoryConnection::SetTerminate(bool terminate)
+{
+    Connection::SetTerminate(terminate);
+
+    // our read and write threads may be asleep on a doorbell, ring just the two only this side waits on
+    if (terminate)
+    {
+        Helium::TakeMutex mutex (m_Mutex);
+
+        if (m_ReadRing)
+        {
+            RingBell(m_ReadRing, SharedBells::Data);
+            RingBell(m_WriteRing, SharedBells::Space);
+        }
+    }
+}
+
+void SharedMemoryConnection::WakeRings()
+{
+    // ringing everything wakes any thread on either side, which will then notice m_Closed
+    RingBell(m_ReadRing, SharedBells::Data);
+    RingBell(m_ReadRing, SharedBells::Space);
+    RingBell(m_WriteRing, SharedBells::Data);
+    RingBell(m_WriteRing, SharedBells::Space);
+}
+
+void SharedMemoryConnection::ResetRings()
+{
+    // only the server does this, once the client has let go
+    AtomicStore( &m_ReadRing->m_Head, 0 );
+    AtomicStore( &m_ReadRing->m_Tail, 0 );
+    AtomicStore( &m_WriteRing->m_Head, 0 );
+    AtomicStore( &m_WriteRing->m_Tail, 0 );
+}
+
+bool SharedMemoryConnection::WaitForRing(SharedRing* ring, u32 bell)
+{
+    // the other side is usually just about to get there, so poll a little before sleeping
+    for (u32 i = 0; i < IPC_SHARED_SPIN_COUNT; ++i)
+    {
+        if (RingReady(ring, bell))
+        {
+            return true;
+        }
+    }
+
+    // sequential so the other side either sees us asleep, or we see what it did before ringing
+    AtomicStore( &ring->m_Sleepers[bell], 1, MemoryOrders::Sequential );
+    i32 seen = AtomicLoad( &ring->m_Bells[bell], MemoryOrders::Sequential );
+
+    bool result = true;
+    if (!RingReady(ring, bell))
+    {
+        if (m_Terminating || AtomicLoad( &m_Region->m_Closed ))
+        {
+            result = false;
+        }
+        else
+        {
+#ifdef WIN32
+            u32 index = (u32)( ring - m_Region->m_Rings ) * SharedBells::Count + bell;
+            bool rung = ::WaitForSingleObject( m_Events[index], IPC_SHARED_WAIT_INTERVAL ) == WAIT_OBJECT_0;
+#else
+            timespec timeout;
+            timeout.tv_sec = 0;
+            timeout.tv_nsec = IPC_SHARED_WAIT_INTERVAL * 1000000;
+            bool rung = FutexWait( &ring->m_Bells[bell], seen, &timeout, true );
+#endif
+
+            // nobody rang for a while, make sure there is still someone there to ring
+            if (!rung && !RemoteAlive())
+            {
+                result = false;
+            }
+        }
+    }
+
+    AtomicStore( &ring->m_Sleepers[bell], 0 );
+    return result;
+}
+
+void SharedMemoryConnection::RingBell(SharedRing* ring, u32 bell)
+{
+    AtomicIncrement( &ring->m_Bells[bell] );
+
+    // only enter the kernel if the other side is asleep
+    if (AtomicLoad( &ring->m_Sleepers[bell], MemoryOrders::Sequential ))
+    {
+#ifdef WIN32
+        u32 index = (u32)( ring - m_Region->m_Rings ) * SharedBells::Count + bell;
+        ::SetEvent( m_Events[index] );
+#else
+        FutexWake( &ring->m_Bells[bell], 1, true );
+#endif
+    }
+}
+
+bool SharedMemoryConnection::RemoteAlive()
+{
+    i32 attached = AtomicLoad( m_Server ? &m_Region->m_ClientProcess : &m_Region->m_ServerProcess );
+    return attached == m_RemoteProcess && ProcessAlive( m_RemoteProcess );
+}
+
+bool SharedMemoryConnection::Map(bool create)
+{
+#ifdef WIN32
+    tstring name = TXT( "Local\\helium_" );
+    name += m_RegionName;
+
+    if (create)
+    {
+        m_Mapping = ::CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, IPC_SHARED_REGION_SIZE, name.c_str() );
+    }
+    else
+    {
+        m_Mapping = ::OpenFileMapping( FILE_MAP_ALL_ACCESS, FALSE, name.c_str() );
+    }
+
+    if (!m_Mapping)
+    {
+        if (create)
+        {
+            Helium::Print( TXT( "%s: Failed to create shared memory '%s' (%s)\n" ), m_Name, name.c_str(), Helium::GetErrorString().c_str());
+        }
+        return false;
+    }
+
+    m_Region = (SharedRegion*)::MapViewOfFile( m_Mapping, FILE_MAP_ALL_ACCESS, 0, 0, IPC_SHARED_REGION_SIZE );
+    if (!m_Region)
+    {
+        Helium::Print( TXT( "%s: Failed to map shared memory '%s' (%s)\n" ), m_Name, name.c_str(), Helium::GetErrorString().c_str());
+        Unmap();
+        return false;
+    }
+
+    // doorbells are named events next to the mapping, whichever side gets there first creates them
+    for ( u32 i = 0; i < 4; ++i )
+    {
+        tostringstream eventName;
+        eventName << name << TXT( "_bell" ) << i;
+
+        m_Events[i] = ::CreateEvent( NULL, FALSE, FALSE, eventName.str().c_str() );
+        if (!m_Events[i])
+        {
+            Helium::Print( TXT( "%s: Failed to create doorbell '%s' (%s)\n" ), m_Name, eventName.str().c_str(), Helium::GetErrorString().c_str());
+            Unmap();
+            return false;
+        }
+    }
+#else
+    std::string name;
+    if (!Helium::ConvertString( m_RegionName, name ))
+    {
+        Helium::Print( TXT( "%s: Failed to convert shared memory name '%s'\n" ), m_Name, m_RegionName);
+        return false;
+    }
+    name = "/helium_" + name;
+
+    if (create)
+    {
+        // anything left by a server that didn't shut down is stale
+        shm_unlink( name.c_str() );
+
+        m_File = shm_open( name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600 );
+        if (m_File < 0 || ftruncate( m_File, IPC_SHARED_REGION_SIZE ) != 0)
+        {
+            Helium::Print( TXT( "%s: Failed to create shared memory '%s' (%s)\n" ), m_Name, name.c_str(), Helium::GetErrorString().c_str());
+            Unmap();
+            return false;
+        }
+    }
+    else
+    {
+        // the server may not have sized it yet
+        struct stat info;
+        m_File = shm_open( name.c_str(), O_RDWR, 0 );
+        if (m_File < 0 || fstat( m_File, &info ) != 0 || info.st_size < IPC_SHARED_REGION_SIZE)
+        {
+            Unmap();
+            return false;
+        }
+    }
+
+    void* view = mmap( NULL, IPC_SHARED_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_File, 0 );
+    if (view == MAP_FAILED)
+    {
+        Helium::Print( TXT( "%s: Failed to map shared memory '%s' (%s)\n" ), m_Name, name.c_str(), Helium::GetErrorString().c_str());
+        Unmap();
+        return false;
+    }
+
+    m_Region = (SharedRegion*)view;
+#endif
+
+    // the server writes the first ring and reads the second
+    u8* rings = (u8*)m_Region + IPC_SHARED_HEADER_SIZE;
+    m_WriteRing = &m_Region->m_Rings[ m_Server ? 0 : 1 ];
+    m_WriteData = rings + ( m_Server ? 0 : IPC_SHARED_RING_SIZE );
+    m_ReadRing = &m_Region->m_Rings[ m_Server ? 1 : 0 ];
+    m_ReadData = rings + ( m_Server ? IPC_SHARED_RING_SIZE : 0 );
+
+    if (create)
+    {
+        memset( m_Region, 0, sizeof( SharedRegion ) );
+        m_Region->m_RingSize = IPC_SHARED_RING_SIZE;
+        m_Region->m_ServerProcess = GetCurrentProcessID();
+        AtomicStore( &m_Region->m_Magic, IPC_SHARED_MAGIC );
+    }
+
+    return true;
+}
+
+void SharedMemoryConnection::Unmap()
+{
+    // SetTerminate may be ringing our doorbells from another thread
+    Helium::TakeMutex mutex (m_Mutex);
+
+#ifdef WIN32
+    for ( u32 i = 0; i < 4; ++i )
+    {
+        if (m_Events[i])
+        {
+            ::CloseHandle( m_Events[i] );
+            m_Events[i] = NULL;
+        }
+    }
+
+    if (m_Region)
+    {
+        ::UnmapViewOfFile( m_Region );
+    }
+
+    if (m_Mapping)
+    {
+        ::CloseHandle( m_Mapping );
+        m_Mapping = NULL;
+    }
+#else
+    if (m_Region)
+    {
+        munmap( m_Region, IPC_SHARED_REGION_SIZE );
+    }
+
+    if (m_File >= 0)
+    {
+        close( m_File );
+        m_File = -1;
+
+        // the name goes with the server, clients that still have it mapped keep their mapping
+        if (m_Server)
+        {
+            std::string name;
+            Helium::ConvertString( m_RegionName, name );
+            shm_unlink( ( "/helium_" + name ).c_str() );
+        }
+    }
+#endif
+
+    m_Region = NULL;
+    m_ReadRing = NULL;
+    m_ReadData = NULL;
+    m_WriteRing = NULL;
+    m_WriteData = NULL;
+}
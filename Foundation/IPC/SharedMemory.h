@@ -0,0 +1,83 @@
+#pragma once
+
+#include "IPC.h"
+#include "Connection.h"
+
+// Debug printing
+//#define IPC_SHARED_DEBUG
+
+// bytes of ring in each direction, a power of two
+#define IPC_SHARED_RING_SIZE        ( 4 << 20 )
+
+// times a read or write polls an empty or full ring before ringing for the other side
+#define IPC_SHARED_SPIN_COUNT       100
+
+// milliseconds between checks that the other process is still there (and we aren't terminating) while waiting
+#define IPC_SHARED_WAIT_INTERVAL    100
+
+namespace Helium
+{
+    namespace IPC
+    {
+        struct SharedRegion;
+        struct SharedRing;
+
+        //
+        // Connection between processes on the same machine through a named shared memory region: one single
+        //  producer, single consumer ring per direction, so a message is copied into the ring by the sender and
+        //  out of it by the receiver without going through the kernel.  A side that finds its ring empty (or
+        //  full) sleeps on a doorbell in the region (a futex on linux, a named event on windows), and the other
+        //  side only rings it when someone is asleep.
+        //
+
+        class FOUNDATION_API SharedMemoryConnection : public Connection
+        {
+        private:
+            tchar           m_RegionName[256];      // name of the region passed in by the user
+
+            SharedRegion*   m_Region;               // the mapped region, NULL while not attached
+            SharedRing*     m_ReadRing;             // the ring we consume
+            u8*             m_ReadData;
+            SharedRing*     m_WriteRing;            // the ring we produce
+            u8*             m_WriteData;
+            i32             m_RemoteProcess;        // process id of the other side
+
+#ifdef WIN32
+            void*           m_Mapping;
+            void*           m_Events[4];            // doorbells, in the same order as the rings' bells
+#else
+            int             m_File;
+#endif
+
+        public:
+            SharedMemoryConnection();
+            virtual ~SharedMemoryConnection();
+
+        public:
+            bool Initialize(bool server, const tchar* name, const tchar* region_name);
+
+        protected:
+            void ServerThread();
+            void ClientThread();
+
+            virtual bool ReadMessage(Message** msg);
+            virtual bool WriteMessage(Message* msg);
+            virtual bool Read(void* buffer, u32 bytes);
+            virtual bool Write(void* buffer, u32 bytes);
+
+            virtual void SetTerminate(bool terminate);
+
+        private:
+            bool Map(bool create);
+            void Unmap();
+            bool Attach();
+            void Detach();
+            void WakeRings();
+            void ResetRings();
+
+            bool WaitForRing(SharedRing* ring, u32 bell);
+            void RingBell(SharedRing* ring, u32 bell);
+            bool RemoteAlive();
+        };
+    }
+}
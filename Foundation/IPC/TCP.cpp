@@ -12,14 +12,40 @@ using namespace Helium::IPC;
 
 #define IPC_TCP_NO_DELAY
 
-// {TIMEOUT_SECS, TIMEOUT_USECS}
-struct timeval g_TimeoutWaiting = {0, 17000};
+static void ConfigureSocket(Helium::Socket& socket)
+{
+    int result;
+    socklen_t buf_size = IPC_TCP_BUFFER_SIZE;
+    socklen_t size_size = sizeof(IPC_TCP_BUFFER_SIZE);
+    result = setsockopt(socket, SOL_SOCKET, SO_RCVBUF, (const char*)&buf_size, size_size);
+    result = setsockopt(socket, SOL_SOCKET, SO_SNDBUF, (const char*)&buf_size, size_size);
+
+#ifdef IPC_TCP_NO_DELAY
+    int flag = 1;
+    result = setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&flag, sizeof(int));
+#endif
+}
+
+// make socket refer to other's connection, on win32 each keeps its own overlapped state so one can read while the other writes
+static void ShareSocket(Helium::Socket& socket, Helium::Socket& other)
+{
+#ifdef WIN32
+    socket.m_Handle = other.m_Handle;
+#else
+    socket = other;
+#endif
+}
 
 TCPConnection::TCPConnection()
 : m_ReadPort (0)
 , m_ReadSocket (0)
 , m_WritePort (0)
 , m_WriteSocket (0)
+, m_ServerWriteSocket (0)
+, m_TryDuplex (true)
+, m_Duplex (false)
+, m_ReadPolled (false)
+, m_WritePolled (false)
 {
     m_IP[0] = '\0';
 }
@@ -30,7 +56,7 @@ TCPConnection::~TCPConnection()
     Cleanup();
 }
 
-bool TCPConnection::Initialize(bool server, const tchar* name, const tchar* server_ip, const u16 server_port)
+bool TCPConnection::Initialize(bool server, const tchar* name, const tchar* server_ip, const u16 server_port, bool duplex)
 {
     if (!Connection::Initialize( server, name ))
     {
@@ -42,6 +68,8 @@ bool TCPConnection::Initialize(bool server, const tchar* name, const tchar* serv
         _tcscpy(m_IP, server_ip);
     }
 
+    m_TryDuplex = duplex;
+
     if (server)
     {
         m_ReadPort = server_port;
@@ -80,8 +108,7 @@ void TCPConnection::ServerThread()
         return;
     }
 
-    Helium::Socket server_write_socket = 0;
-    if (!Helium::CreateSocket(server_write_socket))
+    if (!Helium::CreateSocket(m_ServerWriteSocket))
     {
         SetState(ConnectionStates::Failed);
         return;
@@ -90,15 +117,15 @@ void TCPConnection::ServerThread()
     if (!Helium::BindSocket(server_read_socket, m_ReadPort) || !Helium::ListenSocket(server_read_socket))
     {
         Helium::CloseSocket(server_read_socket);
-        Helium::CloseSocket(server_write_socket);
+        Helium::CloseSocket(m_ServerWriteSocket);
         SetState(ConnectionStates::Failed);
         return;
     }
 
-    if (!Helium::BindSocket(server_write_socket, m_WritePort) || !Helium::ListenSocket(server_write_socket))
+    if (!Helium::BindSocket(m_ServerWriteSocket, m_WritePort) || !Helium::ListenSocket(m_ServerWriteSocket))
     {
         Helium::CloseSocket(server_read_socket);
-        Helium::CloseSocket(server_write_socket);
+        Helium::CloseSocket(m_ServerWriteSocket);
         SetState(ConnectionStates::Failed);
         return;
     }
@@ -108,31 +135,35 @@ void TCPConnection::ServerThread()
     {
         Helium::Print( TXT( "%s: Ready for client\n" ), m_Name);
 
-        // wait for a connection
-        while (!m_Terminating)
+        if (!m_ReadPoller.Add(server_read_socket, Helium::SocketEvents::Read))
         {
-            fd_set read_fd_sock_set;
-            FD_ZERO(&read_fd_sock_set);
-            FD_SET(server_read_socket, &read_fd_sock_set);
-            int readSelectResult = Helium::SelectSocket((int)server_read_socket + 1, &read_fd_sock_set, NULL, &g_TimeoutWaiting);
-
-            fd_set write_fd_sock_set;
-            FD_ZERO(&write_fd_sock_set);
-            FD_SET(server_write_socket, &write_fd_sock_set);
-            int writeSelectResult = Helium::SelectSocket((int)server_write_socket + 1, &write_fd_sock_set, NULL, &g_TimeoutWaiting);
+            Helium::CloseSocket(server_read_socket);
+            Helium::CloseSocket(m_ServerWriteSocket);
+            SetState(ConnectionStates::Failed);
+            return;
+        }
 
-            if (readSelectResult > 0 && writeSelectResult > 0)
-            {
-                HELIUM_ASSERT( FD_ISSET(server_read_socket, &read_fd_sock_set) );
-                HELIUM_ASSERT( FD_ISSET(server_write_socket, &write_fd_sock_set) );
-                break;
-            }
-            else
+        // block until a client connects (or we are woken up to terminate), a two socket client connects
+        //  the write port as well but that isn't accepted until the handshake says what kind of client it is
+        bool readPending = false;
+        while (!m_Terminating && !readPending)
+        {
+            Helium::SocketPoller::Event event;
+            int count = m_ReadPoller.Wait(&event, 1);
+            if (count < 0)
             {
-                Helium::Sleep( 100 );
+                Helium::CloseSocket(server_read_socket);
+                Helium::CloseSocket(m_ServerWriteSocket);
+                SetState(ConnectionStates::Failed);
+                return;
             }
+
+            readPending = count > 0;
         }
 
+        // serving one client at a time, any other pending connections will be reported when we re-register
+        m_ReadPoller.Remove(server_read_socket);
+
         if (!m_Terminating)
         {
             // we should have incoming data, accept the connection
@@ -140,35 +171,30 @@ void TCPConnection::ServerThread()
             if (!Helium::AcceptSocket(m_ReadSocket, server_read_socket, &client_info))
             {
                 Helium::CloseSocket(server_read_socket);
-                Helium::CloseSocket(server_write_socket);
-                SetState(ConnectionStates::Failed);
-                return;
-            }
-            if (!Helium::AcceptSocket(m_WriteSocket, server_write_socket, &client_info))
-            {
-                Helium::CloseSocket(server_read_socket);
-                Helium::CloseSocket(server_write_socket);
+                Helium::CloseSocket(m_ServerWriteSocket);
                 SetState(ConnectionStates::Failed);
                 return;
             }
 
-            int result;
-            socklen_t buf_size = IPC_TCP_BUFFER_SIZE;
-            socklen_t size_size = sizeof(IPC_TCP_BUFFER_SIZE);
-            result = setsockopt(m_ReadSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&buf_size, size_size);
-            result = setsockopt(m_ReadSocket, SOL_SOCKET, SO_SNDBUF, (const char*)&buf_size, size_size);
-            result = setsockopt(m_WriteSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&buf_size, size_size);
-            result = setsockopt(m_WriteSocket, SOL_SOCKET, SO_SNDBUF, (const char*)&buf_size, size_size);
+            ConfigureSocket(m_ReadSocket);
             Helium::Print( TXT( "%s: Accepted connection (%dk/%dk)\n" ), m_Name, IPC_TCP_BUFFER_SIZE >> 10, IPC_TCP_BUFFER_SIZE >> 10);
 
-#ifdef IPC_TCP_NO_DELAY
-            int flag = 1;
-            result = setsockopt(m_ReadSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&flag, sizeof(int));
-            result = setsockopt(m_WriteSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&flag, sizeof(int));
-#endif
+            // write on the accepted socket until the handshake shows the client wants a second one
+            ShareSocket(m_WriteSocket, m_ReadSocket);
+            m_Duplex = true;
+            m_HostFlags = 0;
 
             // do connection
-            ConnectThread();
+            if (PollSockets())
+            {
+                u8 offer = IPC_TCP_DUPLEX_OFFER;
+                if (Write(&offer, sizeof(offer)))
+                {
+                    ConnectThread();
+                }
+            }
+
+            CloseSockets();
         }
 
         if (!m_Terminating)
@@ -179,7 +205,7 @@ void TCPConnection::ServerThread()
     }
 
     Helium::CloseSocket(server_read_socket);
-    Helium::CloseSocket(server_write_socket);
+    Helium::CloseSocket(m_ServerWriteSocket);
 
     Helium::Print( TXT( "%s: Stopping TCP server (ports %d, %d)\n" ), m_Name, m_ReadPort, m_WritePort);
 
@@ -226,58 +252,63 @@ void TCPConnection::ClientThread()
                 return;
             }
 
-            if (!Helium::CreateSocket(m_ReadSocket))
-            {
-                SetState(ConnectionStates::Failed);
-                return;
-            }
-
-            socketsCreated = true;
-
             client_service.sin_port = htons(m_WritePort);
-            bool connectWrite = Helium::ConnectSocket(m_WriteSocket, &client_service);
-
-            client_service.sin_port = htons(m_ReadPort);
-            bool connectRead = Helium::ConnectSocket(m_ReadSocket, &client_service);
-
-            if (connectWrite && connectRead)
-            {
-                break;
-            }
-            else
+            if (Helium::ConnectSocket(m_WriteSocket, &client_service))
             {
-                Helium::CloseSocket(m_WriteSocket);
+                // a server that can run the connection over this socket says so straight away
+                if (m_TryDuplex && ReceiveDuplexOffer())
+                {
+                    ShareSocket(m_ReadSocket, m_WriteSocket);
+                    m_Duplex = true;
+                    socketsCreated = true;
+                    break;
+                }
+
+                if (!Helium::CreateSocket(m_ReadSocket))
+                {
+                    Helium::CloseSocket(m_WriteSocket);
+                    SetState(ConnectionStates::Failed);
+                    return;
+                }
+
+                client_service.sin_port = htons(m_ReadPort);
+                if (Helium::ConnectSocket(m_ReadSocket, &client_service))
+                {
+                    m_Duplex = false;
+                    socketsCreated = true;
+                    break;
+                }
+
                 Helium::CloseSocket(m_ReadSocket);
-                Helium::Sleep( 100 );
-                socketsCreated = false;
             }
+
+            Helium::CloseSocket(m_WriteSocket);
+            Helium::Sleep( 100 );
         }
 
         if (!m_Terminating)
         {
-            int result;
-            socklen_t buf_size = IPC_TCP_BUFFER_SIZE;
-            socklen_t size_size = sizeof(IPC_TCP_BUFFER_SIZE);
-            result = setsockopt(m_ReadSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&buf_size, size_size);
-            result = setsockopt(m_ReadSocket, SOL_SOCKET, SO_SNDBUF, (const char*)&buf_size, size_size);
-            result = setsockopt(m_WriteSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&buf_size, size_size);
-            result = setsockopt(m_WriteSocket, SOL_SOCKET, SO_SNDBUF, (const char*)&buf_size, size_size);
-            Helium::Print( TXT( "%s: Connection established (%dk/%dk)\n" ), m_Name, IPC_TCP_BUFFER_SIZE / 1024, IPC_TCP_BUFFER_SIZE / 1024);
+            ConfigureSocket(m_WriteSocket);
+            if (!m_Duplex)
+            {
+                ConfigureSocket(m_ReadSocket);
+            }
 
-#ifdef IPC_TCP_NO_DELAY
-            int flag = 1;
-            result = setsockopt(m_ReadSocket, IPPROTO_TCP, TCP_NODELAY, (const char*) &flag, sizeof(int));
-            result = setsockopt(m_WriteSocket, IPPROTO_TCP, TCP_NODELAY, (const char*) &flag, sizeof(int));
-#endif
+            Helium::Print( TXT( "%s: Connection established (%dk/%dk%s)\n" ), m_Name, IPC_TCP_BUFFER_SIZE / 1024, IPC_TCP_BUFFER_SIZE / 1024, m_Duplex ? TXT( ", duplex" ) : TXT( "" ));
+
+            // the server confirms duplex in its half of the handshake
+            m_HostFlags = m_Duplex ? HostFlags::Duplex : 0;
 
             // do connection
-            ConnectThread();
+            if (PollSockets())
+            {
+                ConnectThread();
+            }
         }
 
         if (socketsCreated)
         {
-            Helium::CloseSocket(m_WriteSocket);
-            Helium::CloseSocket(m_ReadSocket);
+            CloseSockets();
         }
 
         if (!m_Terminating)
@@ -294,11 +325,172 @@ void TCPConnection::ClientThread()
     Helium::CleanupSockets();
 }
 
+bool TCPConnection::ReceiveDuplexOffer()
+{
+    bool offered = false;
+
+    // older servers say nothing until the second socket connects, so don't wait long
+    if (m_ReadPoller.Add(m_WriteSocket, Helium::SocketEvents::Read))
+    {
+        Helium::SocketPoller::Event event;
+        if (m_ReadPoller.Wait(&event, 1, IPC_TCP_DUPLEX_TIMEOUT) > 0)
+        {
+            u8 offer = 0;
+            u32 bytes_got = 0;
+            offered = Helium::ReadSocket(m_WriteSocket, &offer, sizeof(offer), bytes_got, m_ReadPoller) && bytes_got == sizeof(offer) && offer == IPC_TCP_DUPLEX_OFFER;
+        }
+
+        m_ReadPoller.Remove(m_WriteSocket);
+    }
+
+    return offered;
+}
+
+bool TCPConnection::AcceptWriteSocket()
+{
+    // stop writing on the first socket (the client never reads the offer from it), and wait for the second
+    if (m_WritePolled)
+    {
+        m_WritePoller.Remove(m_WriteSocket);
+        m_WritePolled = false;
+    }
+
+    if (!m_WritePoller.Add(m_ServerWriteSocket, Helium::SocketEvents::Read))
+    {
+        return false;
+    }
+
+    bool writePending = false;
+    while (!m_Terminating && !writePending)
+    {
+        Helium::SocketPoller::Event event;
+        int count = m_WritePoller.Wait(&event, 1);
+        if (count < 0)
+        {
+            break;
+        }
+
+        writePending = count > 0;
+    }
+
+    m_WritePoller.Remove(m_ServerWriteSocket);
+
+    if (!writePending)
+    {
+        return false;
+    }
+
+    sockaddr_in client_info;
+    Helium::Socket socket = 0;
+    if (!Helium::AcceptSocket(socket, m_ServerWriteSocket, &client_info))
+    {
+        return false;
+    }
+
+    ShareSocket(m_WriteSocket, socket);
+    m_Duplex = false;
+
+    ConfigureSocket(m_WriteSocket);
+
+    m_WritePolled = m_WritePoller.Add(m_WriteSocket, Helium::SocketEvents::Write);
+    return m_WritePolled;
+}
+
+bool TCPConnection::PollSockets()
+{
+    m_ReadPolled = m_ReadPoller.Add(m_ReadSocket, Helium::SocketEvents::Read);
+    if (!m_ReadPolled)
+    {
+        return false;
+    }
+
+#ifdef WIN32
+    // WSAEventSelect keeps one registration per socket, so registering a duplex socket again would take it
+    //  from the read poller; writes wait on their own overlapped event and only need the write poller's wakeup
+    if (m_Duplex)
+    {
+        return true;
+    }
+#endif
+
+    m_WritePolled = m_WritePoller.Add(m_WriteSocket, Helium::SocketEvents::Write);
+    return m_WritePolled;
+}
+
+void TCPConnection::CloseSockets()
+{
+    if (m_ReadPolled)
+    {
+        m_ReadPoller.Remove(m_ReadSocket);
+        m_ReadPolled = false;
+    }
+
+    if (m_WritePolled)
+    {
+        m_WritePoller.Remove(m_WriteSocket);
+        m_WritePolled = false;
+    }
+
+    Helium::CloseSocket(m_ReadSocket);
+    if (!m_Duplex)
+    {
+        Helium::CloseSocket(m_WriteSocket);
+    }
+
+    m_Duplex = false;
+}
+
+bool TCPConnection::ReadHostType()
+{
+    if (!Connection::ReadHostType())
+    {
+        return false;
+    }
+
+    if (m_Server)
+    {
+        if (m_RemoteHostFlags & HostFlags::Duplex)
+        {
+            // confirm it in our reply
+            m_HostFlags |= HostFlags::Duplex;
+            return true;
+        }
+
+        // an older or two socket client, it will have connected our write port too
+        return AcceptWriteSocket();
+    }
+
+    if (m_Duplex && !(m_RemoteHostFlags & HostFlags::Duplex))
+    {
+        Helium::Print( TXT( "%s: Server didn't confirm a single socket connection\n" ), m_Name);
+        return false;
+    }
+
+    return true;
+}
+
 void TCPConnection::CleanupThread()
 {
     Helium::CleanupSocketThread();
 }
 
+void TCPConnection::SetTerminate(bool terminate)
+{
+    Connection::SetTerminate(terminate);
+
+    // the read and write threads block in the pollers rather than on m_Terminate
+    if (terminate)
+    {
+        m_ReadPoller.Wakeup();
+        m_WritePoller.Wakeup();
+    }
+    else
+    {
+        m_ReadPoller.Reset();
+        m_WritePoller.Reset();
+    }
+}
+
 bool TCPConnection::ReadMessage(Message** msg)
 {
     IPC_SCOPE_TIMER("");
@@ -367,20 +559,7 @@ bool TCPConnection::WriteMessage(Message* msg)
 {
     IPC_SCOPE_TIMER("");
 
-    m_WriteHeader.m_ID = msg->GetID();
-    m_WriteHeader.m_TRN = msg->GetTransaction();
-    m_WriteHeader.m_Size = msg->GetSize();
-    m_WriteHeader.m_Type = msg->GetType();
-
-#ifdef WIN32
-    if ( m_RemotePlatform != (Helium::Platform::Type)-1 )
-    {
-        m_WriteHeader.m_ID = ConvertEndian(m_WriteHeader.m_ID, m_RemotePlatform != Helium::Platform::Types::Windows);
-        m_WriteHeader.m_TRN = ConvertEndian(m_WriteHeader.m_TRN, m_RemotePlatform != Helium::Platform::Types::Windows);
-        m_WriteHeader.m_Size = ConvertEndian(m_WriteHeader.m_Size, m_RemotePlatform != Helium::Platform::Types::Windows);
-        m_WriteHeader.m_Type = ConvertEndian(m_WriteHeader.m_Type, m_RemotePlatform != Helium::Platform::Types::Windows);
-    }
-#endif
+    PrepareHeader(m_WriteHeader, msg);
 
     {
         IPC_SCOPE_TIMER("Write Message Header");
@@ -409,6 +588,80 @@ bool TCPConnection::WriteMessage(Message* msg)
     return true;
 }
 
+bool TCPConnection::WriteMessages(Message** msgs, u32 count)
+{
+    IPC_SCOPE_TIMER("");
+
+    HELIUM_ASSERT( count <= IPC_WRITE_BATCH_MESSAGES );
+
+    // headers and data interleaved, so with no delay set small messages share packets instead of getting one each
+    Helium::SocketBuffer buffers[IPC_WRITE_BATCH_MESSAGES * 2];
+    for (u32 i=0; i<count; i++)
+    {
+        PrepareHeader(m_WriteHeaders[i], msgs[i]);
+
+        buffers[i * 2].m_Data = &m_WriteHeaders[i];
+        buffers[i * 2].m_Size = sizeof(MessageHeader);
+        buffers[i * 2 + 1].m_Data = msgs[i]->GetData();
+        buffers[i * 2 + 1].m_Size = msgs[i]->GetSize();
+    }
+
+    Helium::SocketBuffer* next = buffers;
+    u32 left = count * 2;
+
+    while (left > 0)
+    {
+        u32 bytes_put = 0;
+
+        if (!Helium::WriteSocketVector( m_WriteSocket, next, std::min<u32>(left, SOCKET_MAX_BUFFERS), bytes_put, m_WritePoller ))
+        {
+#ifdef IPC_TCP_DEBUG_SOCKETS
+            Helium::Print("%s: Failed to write %d messages\n", m_Name, count);
+#endif
+            return false;
+        }
+
+        if (m_Terminating)
+        {
+            return false;
+        }
+
+        // the send can stop anywhere, skip what went and trim the buffer it stopped in
+        while (left > 0 && bytes_put >= next->m_Size)
+        {
+            bytes_put -= next->m_Size;
+            next++;
+            left--;
+        }
+
+        if (bytes_put)
+        {
+            next->m_Data = ((u8*)next->m_Data) + bytes_put;
+            next->m_Size -= bytes_put;
+        }
+    }
+
+    return true;
+}
+
+void TCPConnection::PrepareHeader(MessageHeader& header, Message* msg)
+{
+    header.m_ID = msg->GetID();
+    header.m_TRN = msg->GetTransaction();
+    header.m_Size = msg->GetSize();
+    header.m_Type = msg->GetType();
+
+#ifdef WIN32
+    if ( m_RemotePlatform != (Helium::Platform::Type)-1 )
+    {
+        header.m_ID = ConvertEndian(header.m_ID, m_RemotePlatform != Helium::Platform::Types::Windows);
+        header.m_TRN = ConvertEndian(header.m_TRN, m_RemotePlatform != Helium::Platform::Types::Windows);
+        header.m_Size = ConvertEndian(header.m_Size, m_RemotePlatform != Helium::Platform::Types::Windows);
+        header.m_Type = ConvertEndian(header.m_Type, m_RemotePlatform != Helium::Platform::Types::Windows);
+    }
+#endif
+}
+
 bool TCPConnection::Read(void* buffer, u32 bytes)
 {  
 #ifdef IPC_TCP_DEBUG_SOCKETS_CHUNKS
@@ -426,7 +679,7 @@ bool TCPConnection::Read(void* buffer, u32 bytes)
         Helium::Print(" %s: Receiving %d bytes...\n", m_Name, count);
 #endif
 
-        if (!Helium::ReadSocket( m_ReadSocket, buffer, count, bytes_got, m_Terminate ))
+        if (!Helium::ReadSocket( m_ReadSocket, buffer, count, bytes_got, m_ReadPoller ))
         {
 #ifdef IPC_TCP_DEBUG_SOCKETS
             Helium::Print( "%s: ReadSocket failed\n", m_Name );
@@ -474,7 +727,7 @@ bool TCPConnection::Write(void* buffer, u32 bytes)
         Helium::Print(" %s: Sending %d bytes...\n", m_Name, count);
 #endif
 
-        if (!Helium::WriteSocket( m_WriteSocket, buffer, count, bytes_put, m_Terminate ))
+        if (!Helium::WriteSocket( m_WriteSocket, buffer, count, bytes_put, m_WritePoller ))
         {
             return false;
         }
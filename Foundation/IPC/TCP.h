@@ -15,6 +15,19 @@ namespace Helium
     {
         const static u32 IPC_TCP_BUFFER_SIZE = 32 << 10;
 
+        // a server sends this on the first socket as soon as it accepts it, a client that reads it knows the server
+        //  can run the whole connection over that one socket (older clients never read from it)
+        const static u8 IPC_TCP_DUPLEX_OFFER = 0xD1;
+
+        // milliseconds a client waits for the offer before assuming an older server and connecting the second port
+        const static u32 IPC_TCP_DUPLEX_TIMEOUT = 500;
+
+        //
+        // A connection either uses one socket both ways (duplex), or one socket each way on two consecutive
+        //  ports as older versions did.  Servers accept either; clients try for duplex unless told not to, and
+        //  fall back to two sockets when the server doesn't offer it.
+        //
+
         class FOUNDATION_API TCPConnection : public Connection
         {
         private:
@@ -26,22 +39,43 @@ namespace Helium
             u16               m_WritePort;                    // port number for write operations
             Helium::Socket  m_WriteSocket;                  // socket used for write operations
 
+            Helium::SocketPoller m_ReadPoller;              // readiness of the listening sockets, then the read socket
+            Helium::SocketPoller m_WritePoller;             // readiness of the write socket
+
+            Helium::Socket  m_ServerWriteSocket;            // the server's listener for second sockets from two socket clients
+            bool              m_TryDuplex;                    // the client asks for a single socket
+            bool              m_Duplex;                       // m_WriteSocket is m_ReadSocket's connection
+            bool              m_ReadPolled;                   // m_ReadSocket is registered with m_ReadPoller
+            bool              m_WritePolled;                  // m_WriteSocket is registered with m_WritePoller
+
+            MessageHeader     m_WriteHeaders[IPC_WRITE_BATCH_MESSAGES]; // headers for a batch, they are sent straight from here
+
         public:
             TCPConnection();
             virtual ~TCPConnection();
 
         public:
-            bool Initialize(bool server, const tchar* name, const tchar* server_ip, const u16 server_port_no);
+            bool Initialize(bool server, const tchar* name, const tchar* server_ip, const u16 server_port_no, bool duplex = true);
 
         protected:
             void ServerThread();
             void ClientThread();
 
             virtual void CleanupThread();
+            virtual void SetTerminate(bool terminate);
             virtual bool ReadMessage(Message** msg);
             virtual bool WriteMessage(Message* msg);
+            virtual bool WriteMessages(Message** msgs, u32 count);
             virtual bool Read(void* buffer, u32 bytes);
             virtual bool Write(void* buffer, u32 bytes);
+            virtual bool ReadHostType();
+
+        private:
+            void PrepareHeader(MessageHeader& header, Message* msg);
+            bool ReceiveDuplexOffer();
+            bool AcceptWriteSocket();
+            bool PollSockets();
+            void CloseSockets();
         };
     }
 }
\ No newline at end of file
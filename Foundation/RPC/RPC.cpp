@@ -313,7 +313,7 @@ void Host::Emit(Invoker* invoker, Args* args, u32 size, SwizzleFunc swizzler)
                 }
 
                 // clean up our reply message's memory
-                delete[] frame->m_ReplyData;
+                IPC::Message::FreeData( frame->m_ReplyData );
 
                 // call complete, pop
                 m_Stack.Pop();
@@ -363,11 +363,14 @@ bool Host::Invoke(IPC::Message* msg)
 
     if (args->m_Flags & RPC::Flags::NonBlocking)
     {
-        if (!frame->m_MessageTaken)
+        if (frame->m_MessageTaken)
         {
-            delete msg;
+            // the interface function kept the data, it goes back to the pool when they free it
+            msg->TakeData();
         }
 
+        delete msg;
+
         return true; // async call, we are done
     }
 
@@ -449,11 +452,13 @@ bool Host::Invoke(IPC::Message* msg)
     printf("RPC::Put message id 0x%08x, size %d, transaction %d\n", reply->GetID(), reply->GetSize(), reply->GetTransaction());
 #endif
 
-    if (!frame->m_MessageTaken)
+    if (frame->m_MessageTaken)
     {
-        delete msg;
+        msg->TakeData();
     }
 
+    delete msg;
+
     return true;
 }
 
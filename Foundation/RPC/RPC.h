@@ -183,7 +183,7 @@ namespace Helium
             // process data from the other side
             bool Invoke(IPC::Message* msg);
 
-            // take the message data (call from within an interface function)
+            // take the message data (call from within an interface function), free it with IPC::Message::FreeData
             u8* TakeData();
 
             // Are we connected and ready to do work?
@@ -5,6 +5,7 @@
 #include "Type.h"
 
 #include "Foundation/Atomic.h"
+#include "Foundation/String/Hasher.h"
 
 namespace Helium
 {
@@ -30,8 +31,8 @@ namespace Helium
 
         typedef Helium::SmartPtr<EnumerationElement> EnumerationElementPtr;
         typedef std::vector<EnumerationElementPtr>                    V_EnumerationElement; // order of declaration
-        typedef stdext::hash_map<tstring, EnumerationElementPtr>      M_StrEnumerationElement; // sorted by name
-        typedef stdext::hash_map<i32, EnumerationElementPtr>          M_ValueEnumerationElement; // sorted by value
+        typedef stdext::hash_map<tstring, EnumerationElementPtr, StringHasher>   M_StrEnumerationElement; // sorted by name
+        typedef stdext::hash_map<i32, EnumerationElementPtr>                     M_ValueEnumerationElement; // sorted by value
 
         class FOUNDATION_API Enumeration;
         typedef Helium::SmartPtr<Enumeration> EnumerationPtr;
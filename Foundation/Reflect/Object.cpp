@@ -86,7 +86,7 @@ void Object::IncrRefCount() const
     }
 #endif
 
-    Helium::AtomicIncrement( &m_RefCount );
+    Helium::AtomicIncrement( &m_RefCount, MemoryOrders::Relaxed );
 }
 
 void Object::DecrRefCount() const
@@ -98,9 +98,7 @@ void Object::DecrRefCount() const
     }
 #endif
 
-    Helium::AtomicDecrement( &m_RefCount ); 
-
-    if (m_RefCount == 0)
+    if ( Helium::AtomicDecrement( &m_RefCount, MemoryOrders::AcquireRelease ) == 0 )
     {
         delete this; 
     }
@@ -485,12 +485,12 @@ const Type* Registry::GetType(const tstring& str) const
 
 void Registry::AtomicGetType(int id, const Type** addr) const
 {
-    Helium::AtomicExchange( (intptr*)addr, (intptr)GetType(id) );
+    Helium::AtomicStore( addr, GetType(id), MemoryOrders::Release );
 }
 
 void Registry::AtomicGetType(const tstring& str, const Type** addr) const
 {
-    Helium::AtomicExchange( (intptr*)addr, (intptr)GetType(str) );
+    Helium::AtomicStore( addr, GetType(str), MemoryOrders::Release );
 }
 
 ObjectPtr Registry::CreateInstance(int id) const
@@ -5,6 +5,8 @@
 
 #include "Platform/Types.h"
 
+#include "Foundation/String/Hasher.h"
+
 #include "API.h"
 #include "Stream.h" 
 
@@ -46,7 +48,7 @@ namespace Helium
         class FOUNDATION_API StringPool
         {
         public:
-            typedef stdext::hash_map<tstring, int> M_StringToIndex;
+            typedef stdext::hash_map<tstring, int, StringHasher> M_StringToIndex;
 
             M_StringToIndex         m_Indices; 
             std::vector< tstring >  m_Strings;
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <hash_map>
+
+#include "Platform/Types.h"
+
+#include "Foundation/Checksum/XXH3.h"
+
+namespace Helium
+{
+    //
+    // Hashing class for storing strings as keys to a hash_map, XXH3 is quicker than the default on all but
+    //  the shortest strings and spreads them better
+    //
+
+    class StringHasher : public stdext::hash_compare< tstring >
+    {
+    public:
+        size_t operator()( const tstring& str ) const
+        {
+            return (size_t)Helium::XXH3_64( str );
+        }
+
+        bool operator()( const tstring& str1, const tstring& str2 ) const
+        {
+            return str1 < str2;
+        }
+    };
+}
@@ -12,6 +12,7 @@
 #include "Platform/Types.h"
 
 #include "Foundation/API.h"
+#include "Foundation/Checksum/XXH3.h"
 #include "Foundation/Memory/Endian.h"
 
 typedef u64 tuid;
@@ -162,9 +163,10 @@ namespace Helium
     class TUIDHasher : public stdext::hash_compare< u64 >
     {
     public:
-        size_t operator()( const TUID& tuid ) const
+        size_t operator()( const TUID& id ) const
         {
-            return stdext::hash_compare< u64 >::operator()( 0 );
+            tuid value = id;
+            return (size_t)Helium::XXH3_64( &value, sizeof( value ) );
         }
 
         bool operator()( const TUID& tuid1, const TUID& tuid2 ) const
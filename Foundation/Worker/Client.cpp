@@ -5,6 +5,7 @@
 #include "Platform/Windows/Windows.h"
 #include "Foundation/CommandLine/Utilities.h"
 #include "Foundation/IPC/Pipe.h"
+#include "Foundation/IPC/SharedMemory.h"
 
 #include "Foundation/Startup.h"
 #include "Foundation/Exception.h"
@@ -56,9 +57,7 @@ static void TerminateListener(const Debug::TerminateArgs& args)
 
 bool Client::Initialize( bool debug, bool wait )
 {
-    IPC::PipeConnection* connection = new IPC::PipeConnection ();
-
-    // init pipe connection with this process' process id (hex)
+    // init connection with this process' process id (hex)
     tostringstream stream;
 
     if ( debug )
@@ -70,10 +69,19 @@ bool Client::Initialize( bool debug, bool wait )
         stream << TXT( "worker_" ) << std::hex << ::GetProcessId(GetCurrentProcess());
     }
 
-    connection->Initialize(false, TXT( "Worker Process Connection" ), stream.str().c_str());
-
-    // setup global connection
-    g_Connection = connection;
+    // setup global connection, over whichever transport our manager launched us with
+    if ( Helium::GetCmdLineFlag( Worker::Args::SharedMemory ) )
+    {
+        IPC::SharedMemoryConnection* connection = new IPC::SharedMemoryConnection ();
+        connection->Initialize(false, TXT( "Worker Process Connection" ), stream.str().c_str());
+        g_Connection = connection;
+    }
+    else
+    {
+        IPC::PipeConnection* connection = new IPC::PipeConnection ();
+        connection->Initialize(false, TXT( "Worker Process Connection" ), stream.str().c_str());
+        g_Connection = connection;
+    }
 
     // wait a while for connection
     int timeout = DefaultWorkerTimeout;
@@ -5,6 +5,7 @@
 
 #include "Foundation/Log.h"
 #include "Foundation/IPC/Pipe.h"
+#include "Foundation/IPC/SharedMemory.h"
 #include "Foundation/CommandLine/Utilities.h"
 
 #include "Foundation/Startup.h"
@@ -18,6 +19,7 @@ using namespace Helium::Worker;
 const tchar* Worker::Args::Worker  = TXT( "worker" );
 const tchar* Worker::Args::Debug   = TXT( "worker_debug" );
 const tchar* Worker::Args::Wait    = TXT( "worker_wait" );
+const tchar* Worker::Args::SharedMemory = TXT( "worker_shm" );
 
 // the worker processes for a master application
 std::set< Helium::SmartPtr< Worker::Process > > g_Workers;
@@ -81,7 +83,7 @@ Process::~Process()
     Kill();
 }
 
-bool Process::Start( int timeout )
+bool Process::Start( int timeout, Transport transport )
 {
     tstring str = m_Executable;
     str += TXT( " " );
@@ -97,6 +99,14 @@ bool Process::Start( int timeout )
         timeout = -1;
     }
 
+    // tell our worker to look for a shared memory region instead of a pipe
+    if ( transport == Transports::SharedMemory )
+    {
+        str += TXT( " " );
+        str += Helium::CmdLineDelimiters[0];
+        str += Worker::Args::SharedMemory;
+    }
+
     STARTUPINFO startupInfo;
     memset( &startupInfo, 0, sizeof( startupInfo ) );
     startupInfo.cb = sizeof( startupInfo );
@@ -122,10 +132,7 @@ bool Process::Start( int timeout )
         // save this for query later
         m_Handle = procInfo.hProcess;
 
-        // create the server side of the connection
-        IPC::PipeConnection* connection = new IPC::PipeConnection ();
-
-        // init pipe connection with background process' process id (hex)
+        // init connection with background process' process id (hex)
         tostringstream stream;
 
         if ( m_Debug )
@@ -137,10 +144,19 @@ bool Process::Start( int timeout )
             stream << TXT( "worker_" ) << std::hex << GetProcessId( m_Handle );
         }
 
-        connection->Initialize(true, TXT( "Worker Process Connection" ), stream.str().c_str());
-
-        // setup global connection
-        m_Connection = connection;
+        // create the server side of the connection
+        if ( transport == Transports::SharedMemory )
+        {
+            IPC::SharedMemoryConnection* connection = new IPC::SharedMemoryConnection ();
+            connection->Initialize(true, TXT( "Worker Process Connection" ), stream.str().c_str());
+            m_Connection = connection;
+        }
+        else
+        {
+            IPC::PipeConnection* connection = new IPC::PipeConnection ();
+            connection->Initialize(true, TXT( "Worker Process Connection" ), stream.str().c_str());
+            m_Connection = connection;
+        }
 
         // release handles to our new process
         ::CloseHandle( procInfo.hThread );
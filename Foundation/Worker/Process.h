@@ -28,8 +28,20 @@ namespace Helium
             static const tchar* Worker;
             static const tchar* Debug;
             static const tchar* Wait;
+            static const tchar* SharedMemory;
         };
 
+        // how the manager and worker processes talk to each other
+        namespace Transports
+        {
+            enum Transport
+            {
+                Pipe,           // named pipe, works anywhere
+                SharedMemory,   // shared memory rings, cheaper for high message rates between processes on one machine
+            };
+        }
+        typedef Transports::Transport Transport;
+
 #pragma warning ( disable: 4200 )
         struct ConsoleOutput
         {
@@ -77,7 +89,7 @@ namespace Helium
             ~Process();
 
             // create process
-            bool Start( int timeout = DefaultWorkerTimeout );
+            bool Start( int timeout = DefaultWorkerTimeout, Transport transport = Transports::Pipe );
 
             // you must delete the object this returns, if non-null
             IPC::Message* Receive( bool wait = true );
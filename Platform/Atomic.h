@@ -6,13 +6,64 @@
 
 namespace Helium
 {
-    PLATFORM_API void AtomicIncrement( volatile i32* value );
-    PLATFORM_API void AtomicDecrement( volatile i32* value );
-    PLATFORM_API void AtomicExchange( volatile i32* addr, i32 value );
-
-#ifdef X64
-    PLATFORM_API void AtomicIncrement( volatile i64* value );
-    PLATFORM_API void AtomicDecrement( volatile i64* value );
-    PLATFORM_API void AtomicExchange( volatile i64* addr, i64 value );
+    //
+    // Memory ordering constraints for atomic operations, weaker orders are cheaper on most hardware
+    //
+
+    namespace MemoryOrders
+    {
+        enum MemoryOrder
+        {
+            Relaxed,            // atomicity only, no ordering relative to other memory operations
+            Acquire,            // later memory operations cannot move above this one (loads, read-modify-write)
+            Release,            // earlier memory operations cannot move below this one (stores, read-modify-write)
+            AcquireRelease,     // both of the above (read-modify-write)
+            Sequential,         // full barrier
+        };
+    }
+    typedef MemoryOrders::MemoryOrder MemoryOrder;
+
+    //
+    // Increment and Decrement return the resulting value, the other read-modify-write operations
+    //  return the value that was in memory before the operation (like the win32 Interlocked API)
+    //
+
+    inline i32 AtomicIncrement( volatile i32* value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i32 AtomicDecrement( volatile i32* value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i32 AtomicExchange( volatile i32* addr, i32 value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i32 AtomicCompareExchange( volatile i32* addr, i32 value, i32 comparand, MemoryOrder order = MemoryOrders::Sequential );
+    inline i32 AtomicFetchAdd( volatile i32* addr, i32 value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i32 AtomicFetchOr( volatile i32* addr, i32 value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i32 AtomicFetchAnd( volatile i32* addr, i32 value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i32 AtomicLoad( const volatile i32* addr, MemoryOrder order = MemoryOrders::Acquire );
+    inline void AtomicStore( volatile i32* addr, i32 value, MemoryOrder order = MemoryOrders::Release );
+
+    inline i64 AtomicIncrement( volatile i64* value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i64 AtomicDecrement( volatile i64* value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i64 AtomicExchange( volatile i64* addr, i64 value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i64 AtomicCompareExchange( volatile i64* addr, i64 value, i64 comparand, MemoryOrder order = MemoryOrders::Sequential );
+    inline i64 AtomicFetchAdd( volatile i64* addr, i64 value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i64 AtomicFetchOr( volatile i64* addr, i64 value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i64 AtomicFetchAnd( volatile i64* addr, i64 value, MemoryOrder order = MemoryOrders::Sequential );
+    inline i64 AtomicLoad( const volatile i64* addr, MemoryOrder order = MemoryOrders::Acquire );
+    inline void AtomicStore( volatile i64* addr, i64 value, MemoryOrder order = MemoryOrders::Release );
+
+    //
+    // Pointer width operations
+    //
+
+    template< class T >
+    inline T* AtomicExchange( T* volatile* addr, T* value, MemoryOrder order = MemoryOrders::Sequential );
+    template< class T >
+    inline T* AtomicCompareExchange( T* volatile* addr, T* value, T* comparand, MemoryOrder order = MemoryOrders::Sequential );
+    template< class T >
+    inline T* AtomicLoad( T* const volatile* addr, MemoryOrder order = MemoryOrders::Acquire );
+    template< class T >
+    inline void AtomicStore( T* volatile* addr, T* value, MemoryOrder order = MemoryOrders::Release );
+}
+
+#ifdef WIN32
+# include "Platform/Windows/Atomic.h"
+#else
+# include "Platform/POSIX/Atomic.h"
 #endif
-}
\ No newline at end of file
@@ -50,6 +50,15 @@
 # endif
 #endif
 
+#ifdef __GNUC__
+# ifdef __i386__
+#  define X86
+# endif
+# ifdef __x86_64__
+#  define X64
+# endif
+#endif
+
 //
 // Byte Order
 //
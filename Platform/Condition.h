@@ -4,11 +4,6 @@
 
 #include "Types.h"
 
-#ifdef __GNUC__
-# include <string.h>
-# include <pthread.h>
-#endif
-
 namespace Helium
 {
     class PLATFORM_API Condition
@@ -18,20 +13,11 @@ namespace Helium
 #ifdef __GNUC__
         struct Handle
         {
-            // Protect critical section
-            pthread_mutex_t lock;
-
-            // Keeps track of waiters
-            pthread_cond_t condition;
-
-            // Specifies if this is an auto- or manual-reset event
-            bool manual_reset;
-
-            // "True" if signaled
-            bool is_signaled;
+            // 1 if signaled, this is a manual-reset event
+            volatile i32 Signaled;
 
-            // Number of waiting threads
-            unsigned waiting_threads;
+            // number of threads sleeping on Signaled
+            volatile i32 Waiters;
         };
 #elif defined( WIN32 )
         typedef void* Handle;
@@ -4,17 +4,18 @@
 
 #include "Types.h"
 
-#ifdef __GNUC__
-# include <pthread.h>
-#endif
-
 namespace Helium
 {
     class PLATFORM_API Mutex
     {
     public:
 #ifdef __GNUC__
-        typedef pthread_mutex_t Handle;
+        struct Handle
+        {
+            volatile i32 State;             // 0 is unlocked, 1 is locked, 2 is locked with sleeping waiters
+            volatile i32 OwningThread;      // id of the thread holding the lock (for recursion)
+            u32 RecursionCount;             // number of times the owning thread has locked
+        };
 #elif defined( WIN32 )
         struct Handle
         {
@@ -0,0 +1,188 @@
+#pragma once
+
+//
+// Atomic operations backed by the gcc __atomic builtins, included by Platform/Atomic.h
+//
+
+namespace Helium
+{
+    inline int GetBuiltinMemoryOrder( MemoryOrder order )
+    {
+        switch ( order )
+        {
+        case MemoryOrders::Relaxed:
+            return __ATOMIC_RELAXED;
+        case MemoryOrders::Acquire:
+            return __ATOMIC_ACQUIRE;
+        case MemoryOrders::Release:
+            return __ATOMIC_RELEASE;
+        case MemoryOrders::AcquireRelease:
+            return __ATOMIC_ACQ_REL;
+        default:
+            return __ATOMIC_SEQ_CST;
+        }
+    }
+
+    // loads (and the failure case of compare exchange) cannot have release semantics
+    inline int GetBuiltinLoadOrder( MemoryOrder order )
+    {
+        switch ( order )
+        {
+        case MemoryOrders::Relaxed:
+        case MemoryOrders::Release:
+            return __ATOMIC_RELAXED;
+        case MemoryOrders::Acquire:
+        case MemoryOrders::AcquireRelease:
+            return __ATOMIC_ACQUIRE;
+        default:
+            return __ATOMIC_SEQ_CST;
+        }
+    }
+
+    // stores cannot have acquire semantics
+    inline int GetBuiltinStoreOrder( MemoryOrder order )
+    {
+        switch ( order )
+        {
+        case MemoryOrders::Relaxed:
+            return __ATOMIC_RELAXED;
+        case MemoryOrders::Sequential:
+            return __ATOMIC_SEQ_CST;
+        default:
+            return __ATOMIC_RELEASE;
+        }
+    }
+
+    template< class T >
+    inline T AtomicCompareExchangeBuiltin( volatile T* addr, T value, T comparand, MemoryOrder order )
+    {
+        __atomic_compare_exchange_n( addr, &comparand, value, false, GetBuiltinMemoryOrder( order ), GetBuiltinLoadOrder( order ) );
+        return comparand;
+    }
+
+    //
+    // 32 bit
+    //
+
+    inline i32 AtomicIncrement( volatile i32* value, MemoryOrder order )
+    {
+        return __atomic_add_fetch( value, 1, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i32 AtomicDecrement( volatile i32* value, MemoryOrder order )
+    {
+        return __atomic_sub_fetch( value, 1, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i32 AtomicExchange( volatile i32* addr, i32 value, MemoryOrder order )
+    {
+        return __atomic_exchange_n( addr, value, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i32 AtomicCompareExchange( volatile i32* addr, i32 value, i32 comparand, MemoryOrder order )
+    {
+        return AtomicCompareExchangeBuiltin( addr, value, comparand, order );
+    }
+
+    inline i32 AtomicFetchAdd( volatile i32* addr, i32 value, MemoryOrder order )
+    {
+        return __atomic_fetch_add( addr, value, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i32 AtomicFetchOr( volatile i32* addr, i32 value, MemoryOrder order )
+    {
+        return __atomic_fetch_or( addr, value, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i32 AtomicFetchAnd( volatile i32* addr, i32 value, MemoryOrder order )
+    {
+        return __atomic_fetch_and( addr, value, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i32 AtomicLoad( const volatile i32* addr, MemoryOrder order )
+    {
+        return __atomic_load_n( addr, GetBuiltinLoadOrder( order ) );
+    }
+
+    inline void AtomicStore( volatile i32* addr, i32 value, MemoryOrder order )
+    {
+        __atomic_store_n( addr, value, GetBuiltinStoreOrder( order ) );
+    }
+
+    //
+    // 64 bit
+    //
+
+    inline i64 AtomicIncrement( volatile i64* value, MemoryOrder order )
+    {
+        return __atomic_add_fetch( value, 1, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i64 AtomicDecrement( volatile i64* value, MemoryOrder order )
+    {
+        return __atomic_sub_fetch( value, 1, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i64 AtomicExchange( volatile i64* addr, i64 value, MemoryOrder order )
+    {
+        return __atomic_exchange_n( addr, value, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i64 AtomicCompareExchange( volatile i64* addr, i64 value, i64 comparand, MemoryOrder order )
+    {
+        return AtomicCompareExchangeBuiltin( addr, value, comparand, order );
+    }
+
+    inline i64 AtomicFetchAdd( volatile i64* addr, i64 value, MemoryOrder order )
+    {
+        return __atomic_fetch_add( addr, value, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i64 AtomicFetchOr( volatile i64* addr, i64 value, MemoryOrder order )
+    {
+        return __atomic_fetch_or( addr, value, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i64 AtomicFetchAnd( volatile i64* addr, i64 value, MemoryOrder order )
+    {
+        return __atomic_fetch_and( addr, value, GetBuiltinMemoryOrder( order ) );
+    }
+
+    inline i64 AtomicLoad( const volatile i64* addr, MemoryOrder order )
+    {
+        return __atomic_load_n( addr, GetBuiltinLoadOrder( order ) );
+    }
+
+    inline void AtomicStore( volatile i64* addr, i64 value, MemoryOrder order )
+    {
+        __atomic_store_n( addr, value, GetBuiltinStoreOrder( order ) );
+    }
+
+    //
+    // Pointer width
+    //
+
+    template< class T >
+    inline T* AtomicExchange( T* volatile* addr, T* value, MemoryOrder order )
+    {
+        return __atomic_exchange_n( addr, value, GetBuiltinMemoryOrder( order ) );
+    }
+
+    template< class T >
+    inline T* AtomicCompareExchange( T* volatile* addr, T* value, T* comparand, MemoryOrder order )
+    {
+        return AtomicCompareExchangeBuiltin( addr, value, comparand, order );
+    }
+
+    template< class T >
+    inline T* AtomicLoad( T* const volatile* addr, MemoryOrder order )
+    {
+        return __atomic_load_n( addr, GetBuiltinLoadOrder( order ) );
+    }
+
+    template< class T >
+    inline void AtomicStore( T* volatile* addr, T* value, MemoryOrder order )
+    {
+        __atomic_store_n( addr, value, GetBuiltinStoreOrder( order ) );
+    }
+}
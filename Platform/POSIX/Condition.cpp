@@ -1,151 +1,84 @@
 #include "Platform/Condition.h"
 #include "Platform/Platform.h"
+#include "Platform/Atomic.h"
 
 #include "Platform/Assert.h"
-
-#include <pthread.h>
+#include "Platform/POSIX/Futex.h"
 
 using namespace Helium;
 
-// Manual-Reset event implementation for pthreads:
-// http://www.cs.wustl.edu/~schmidt/win32-cv-2.html
+//
+// Manual-reset event on a futex, Signal only enters the kernel if someone is sleeping
+//  waiters publish themselves before checking the state, and signalers set the state before
+//  checking for waiters, both sequentially consistent, so a wakeup cannot be lost
+//
 
-void event_init(Condition::Handle* evt, bool manual_reset, bool initial_state)
+Condition::Condition()
 {
-    evt->manual_reset = manual_reset;
-    evt->is_signaled = initial_state;
-    evt->waiting_threads = 0;
-
-    pthread_cond_init (&evt->condition, NULL);
-    pthread_mutex_init (&evt->lock, NULL);
+    m_Handle.Signaled = 0;
+    m_Handle.Waiters = 0;
 }
 
-void event_destroy(Condition::Handle* evt)
+Condition::~Condition()
 {
-    pthread_mutex_destroy (&evt->lock);
-    pthread_cond_destroy (&evt->condition);
+    HELIUM_ASSERT( m_Handle.Waiters == 0 );
 }
 
-void event_wait(Condition::Handle* evt)
+void Condition::Signal()
 {
-    // grab the lock first
-    pthread_mutex_lock (&evt->lock);
+    AtomicStore( &m_Handle.Signaled, 1, MemoryOrders::Sequential );
 
-    // Condition is currently signaled
-    if (evt->is_signaled)
+    if ( AtomicLoad( &m_Handle.Waiters, MemoryOrders::Sequential ) > 0 )
     {
-        if (!evt->manual_reset)
-        {
-            // AUTO: reset state
-            evt->is_signaled = 0;
-        }
+        FutexWake( &m_Handle.Signaled );
     }
-    else // evt is currently not signaled
-    {
-        evt->waiting_threads++;
-
-        pthread_cond_wait (&evt->condition, &evt->lock);
-
-        evt->waiting_threads--;
-    }
-
-    // Now we can let go of the lock
-    pthread_mutex_unlock (&evt->lock);
 }
 
-void event_signal(Condition::Handle* evt)
+void Condition::Reset()
 {
-    // grab the lock first
-    pthread_mutex_lock (&evt->lock);
-
-    // Manual-reset evt
-    if (evt->manual_reset)
-    {
-        // signal evt
-        evt->is_signaled = true;
+    AtomicStore( &m_Handle.Signaled, 0, MemoryOrders::Release );
+}
 
-        // wakeup all
-        pthread_cond_broadcast (&evt->condition);
-    }
-    // Auto-reset evt
-    else
+bool Condition::Wait(u32 timeout)
+{
+    for ( u32 i = 0; i < FUTEX_SPIN_COUNT; ++i )
     {
-        if (evt->waiting_threads == 0)
+        if ( AtomicLoad( &m_Handle.Signaled, MemoryOrders::Acquire ) )
         {
-            // No waiters: signal evt
-            evt->is_signaled = true;
+            return true;
         }
-        else
+
+        if ( timeout == 0 )
         {
-            // Waiters: wakeup one waiter
-            pthread_cond_signal (&evt->condition);
+            return false;
         }
-    }
 
-    // Now we can let go of the lock
-    pthread_mutex_unlock (&evt->lock);
-}
+        FutexPause();
+    }
 
-void event_pulse(Condition::Handle* evt)
-{
-    // grab the lock first
-    pthread_mutex_lock (&evt->lock);
+    timespec start;
+    clock_gettime( CLOCK_MONOTONIC, &start );
 
-    // Manual-reset evt
-    if (evt->manual_reset)
-    {
-        // Wakeup all waiters
-        pthread_cond_broadcast (&evt->condition);
-    }
+    bool result = true;
+    AtomicIncrement( &m_Handle.Waiters, MemoryOrders::Sequential );
 
-    // Auto-reset evt: wakeup one waiter
-    else
+    while ( !AtomicLoad( &m_Handle.Signaled, MemoryOrders::Sequential ) )
     {
-        pthread_cond_signal (&evt->condition);
-
-        // Reset evt
-        evt->is_signaled = false;
+        if ( timeout == 0xffffffff )
+        {
+            FutexWait( &m_Handle.Signaled, 0 );
+        }
+        else
+        {
+            timespec remaining;
+            if ( !FutexTimeRemaining( start, timeout, remaining ) || !FutexWait( &m_Handle.Signaled, 0, &remaining ) )
+            {
+                result = AtomicLoad( &m_Handle.Signaled, MemoryOrders::Acquire ) != 0;
+                break;
+            }
+        }
     }
 
-    // Now we can let go of the lock
-    pthread_mutex_unlock (&evt->lock);
-}
-
-void event_reset(Condition::Handle* evt)
-{
-    // Grab the lock first
-    pthread_mutex_lock (&evt->lock);
-
-    // Reset evt
-    evt->is_signaled = false;
-
-    // Now we can let go of the lock
-    pthread_mutex_unlock (&evt->lock);
-}
-
-Condition::Condition()
-{
-    event_init(&m_Handle, true, false);
-}
-
-Condition::~Condition()
-{
-    event_destroy(&m_Handle);
-}
-
-void Condition::Signal()
-{
-    event_signal(&m_Handle);
-}
-
-void Condition::Reset()
-{
-    event_reset(&m_Handle);
-}
-
-bool Condition::Wait(u32 timeout)
-{
-    HELIUM_ASSERT( timeout == 0xffffffff ); // not supported
-    event_wait(&m_Handle);
-    return true;
+    AtomicDecrement( &m_Handle.Waiters, MemoryOrders::Release );
+    return result;
 }
@@ -0,0 +1,70 @@
+#pragma once
+
+//
+// Thin wrappers around the linux futex syscall for the POSIX synchronization primitives
+//  these are process private, use the Shared variants for futexes that live in shared memory
+//
+
+#include "Platform/Types.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+# include <xmmintrin.h>
+#endif
+
+// number of times to poll a contended lock before parking the thread in the kernel
+#define FUTEX_SPIN_COUNT 100
+
+namespace Helium
+{
+    // hint to the processor that we are in a spin wait loop
+    inline void FutexPause()
+    {
+#if defined( __x86_64__ ) || defined( __i386__ )
+        _mm_pause();
+#endif
+    }
+
+    // sleep while *addr == expected, returns false if the timeout elapsed
+    inline bool FutexWait( volatile i32* addr, i32 expected, const timespec* timeout = NULL, bool shared = false )
+    {
+        int op = shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE;
+        if ( ::syscall( SYS_futex, addr, op, expected, timeout, NULL, 0 ) < 0 )
+        {
+            return errno != ETIMEDOUT;
+        }
+
+        return true;
+    }
+
+    // wake up to count threads sleeping on addr
+    inline void FutexWake( volatile i32* addr, i32 count = INT_MAX, bool shared = false )
+    {
+        int op = shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE;
+        ::syscall( SYS_futex, addr, op, count, NULL, NULL, 0 );
+    }
+
+    // compute the time left before a millisecond timeout measured from start, returns false if it has elapsed
+    inline bool FutexTimeRemaining( const timespec& start, u32 timeout, timespec& remaining )
+    {
+        timespec now;
+        clock_gettime( CLOCK_MONOTONIC, &now );
+
+        i64 elapsed = ( (i64)( now.tv_sec - start.tv_sec ) * 1000000000LL ) + ( now.tv_nsec - start.tv_nsec );
+        i64 left = ( (i64)timeout * 1000000LL ) - elapsed;
+        if ( left <= 0 )
+        {
+            return false;
+        }
+
+        remaining.tv_sec = (time_t)( left / 1000000000LL );
+        remaining.tv_nsec = (long)( left % 1000000000LL );
+        return true;
+    }
+}
@@ -1,28 +1,92 @@
 #include "Platform/Mutex.h"
 #include "Platform/Platform.h"
+#include "Platform/Thread.h"
+#include "Platform/Atomic.h"
 
 #include "Platform/Assert.h"
+#include "Platform/POSIX/Futex.h"
 
 using namespace Helium;
 
+//
+// Recursive futex mutex (to match win32 critical sections), see "Futexes Are Tricky" by Ulrich Drepper
+//  the uncontended path is a single compare exchange, contended lockers spin briefly before sleeping
+//
+
 Mutex::Mutex()
 {
-    pthread_mutex_init(&m_Handle, NULL);
+    m_Handle.State = 0;
+    m_Handle.OwningThread = 0;
+    m_Handle.RecursionCount = 0;
 }
 
 Mutex::~Mutex()
 {
-    pthread_mutex_destroy(&m_Handle);
+    HELIUM_ASSERT( m_Handle.State == 0 );
 }
 
 void Mutex::Lock()
 {
-    int result = pthread_mutex_lock(&m_Handle);
-    HELIUM_ASSERT( result == 0 );
+    i32 self = (i32)Helium::GetCurrentThreadID();
+
+    // only we could have stored our own id, so a relaxed read is enough to detect recursion
+    if ( AtomicLoad( &m_Handle.OwningThread, MemoryOrders::Relaxed ) == self )
+    {
+        m_Handle.RecursionCount++;
+        return;
+    }
+
+    i32 state = AtomicCompareExchange( &m_Handle.State, 1, 0, MemoryOrders::Acquire );
+    if ( state != 0 )
+    {
+        // spin for a short while in case the owner is about to unlock
+        for ( u32 i = 0; i < FUTEX_SPIN_COUNT && state != 0; ++i )
+        {
+            FutexPause();
+
+            state = AtomicLoad( &m_Handle.State, MemoryOrders::Relaxed );
+            if ( state == 0 )
+            {
+                state = AtomicCompareExchange( &m_Handle.State, 1, 0, MemoryOrders::Acquire );
+            }
+        }
+
+        // mark the lock as contended and sleep until we are the ones that swap it from unlocked
+        if ( state != 0 )
+        {
+            if ( state != 2 )
+            {
+                state = AtomicExchange( &m_Handle.State, 2, MemoryOrders::Acquire );
+            }
+
+            while ( state != 0 )
+            {
+                FutexWait( &m_Handle.State, 2 );
+                state = AtomicExchange( &m_Handle.State, 2, MemoryOrders::Acquire );
+            }
+        }
+    }
+
+    AtomicStore( &m_Handle.OwningThread, self, MemoryOrders::Relaxed );
+    m_Handle.RecursionCount = 1;
 }
 
 void Mutex::Unlock()
 {
-    int result = pthread_mutex_unlock(&m_Handle);
-    HELIUM_ASSERT( result == 0 );
+    HELIUM_ASSERT( m_Handle.OwningThread == (i32)Helium::GetCurrentThreadID() );
+    HELIUM_ASSERT( m_Handle.RecursionCount > 0 );
+
+    if ( --m_Handle.RecursionCount > 0 )
+    {
+        return;
+    }
+
+    AtomicStore( &m_Handle.OwningThread, 0, MemoryOrders::Relaxed );
+
+    // if there were sleepers we need to fully release and wake one of them
+    if ( AtomicFetchAdd( &m_Handle.State, -1, MemoryOrders::Release ) != 1 )
+    {
+        AtomicStore( &m_Handle.State, 0, MemoryOrders::Release );
+        FutexWake( &m_Handle.State, 1 );
+    }
 }
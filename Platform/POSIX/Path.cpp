@@ -1,5 +1,22 @@
 #include "Platform/Path.h"
 
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+# include <sys/ioctl.h>
+# include <sys/sendfile.h>
+# include <sys/syscall.h>
+# include <linux/fs.h>
+#endif
+
+// the buffer for copies the kernel won't do for us
+#define COPY_BUFFER_SIZE    ( 1024 * 1024 )
+
 const tchar Helium::PathSeparator = '/';
 
 bool Helium::GetFullPath( const tchar* path, tstring& fullPath )
@@ -17,19 +34,262 @@ bool Helium::MakePath( const tchar* path )
     return false;
 }
 
-bool Helium::Copy( const tchar* source, const tchar* dest, bool overwrite )
+#ifdef __linux__
+
+// errors that mean this way of copying doesn't work between these two files, rather than that the copy failed
+static bool IsUnsupported( int error )
+{
+    return error == ENOSYS || error == EXDEV || error == EINVAL || error == EOPNOTSUPP || error == ENOTTY || error == EBADF;
+}
+
+// copy_file_range from offset to the end, falling back quietly if the kernel or filesystem can't before anything is copied
+static bool CopyRange( int in, int out, u64& offset, u64 size )
 {
+# ifdef __NR_copy_file_range
+    while ( offset < size )
+    {
+        loff_t inOffset = offset;
+        loff_t outOffset = offset;
+        ssize_t result = syscall( __NR_copy_file_range, in, &inOffset, out, &outOffset, (size_t)std::min< u64 >( size - offset, 0x40000000 ), 0 );
+        if ( result < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        if ( result == 0 )
+        {
+            // special files, and some kernels copying between filesystems, report nothing to copy rather than
+            //  an error; let the next way try from here, it will also notice if the source really got shorter
+            errno = ENOSYS;
+            return false;
+        }
+
+        offset += result;
+    }
+
+    return true;
+# else
+    errno = ENOSYS;
     return false;
+# endif
+}
+
+static bool SendFile( int in, int out, u64& offset, u64 size )
+{
+    while ( offset < size )
+    {
+        off_t inOffset = offset;
+        ssize_t result = sendfile( out, in, &inOffset, (size_t)std::min< u64 >( size - offset, 0x40000000 ) );
+        if ( result < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        if ( result == 0 )
+        {
+            // as with copy_file_range, leave it to the buffered copy
+            errno = ENOSYS;
+            return false;
+        }
+
+        offset += result;
+    }
+
+    return true;
+}
+
+#endif
+
+static bool CopyBuffered( int in, int out, u64& offset )
+{
+    char* buffer = new char[ COPY_BUFFER_SIZE ];
+    bool result = true;
+
+    while ( result )
+    {
+        ssize_t count = pread( in, buffer, COPY_BUFFER_SIZE, (off_t)offset );
+        if ( count < 0 )
+        {
+            result = errno == EINTR;
+            continue;
+        }
+
+        if ( count == 0 )
+        {
+            break;
+        }
+
+        for ( ssize_t written = 0; written < count; )
+        {
+            ssize_t bytes = pwrite( out, buffer + written, count - written, (off_t)( offset + written ) );
+            if ( bytes < 0 )
+            {
+                if ( errno == EINTR )
+                {
+                    continue;
+                }
+
+                result = false;
+                break;
+            }
+
+            written += bytes;
+        }
+
+        offset += count;
+    }
+
+    delete[] buffer;
+    return result;
+}
+
+bool Helium::Copy( const tchar* source, const tchar* dest, bool overwrite, CopyStrategy* strategy )
+{
+    if ( strategy )
+    {
+        *strategy = CopyStrategies::None;
+    }
+
+    int in = open( source, O_RDONLY );
+    if ( in < 0 )
+    {
+        return false;
+    }
+
+    struct stat info;
+    if ( fstat( in, &info ) != 0 || !S_ISREG( info.st_mode ) )
+    {
+        close( in );
+        return false;
+    }
+
+    // truncating the destination would destroy the source if they are the same file
+    struct stat destInfo;
+    if ( stat( dest, &destInfo ) == 0 && destInfo.st_dev == info.st_dev && destInfo.st_ino == info.st_ino )
+    {
+        close( in );
+        errno = EINVAL;
+        return false;
+    }
+
+    int out = open( dest, O_WRONLY | O_CREAT | O_TRUNC | ( overwrite ? 0 : O_EXCL ), info.st_mode & 0777 );
+    if ( out < 0 )
+    {
+        close( in );
+        return false;
+    }
+
+    u64 size = info.st_size;
+    u64 offset = 0;
+    CopyStrategy used = CopyStrategies::None;
+    bool result = false;
+
+#ifdef __linux__
+# ifdef FICLONE
+    if ( ioctl( out, FICLONE, in ) == 0 )
+    {
+        used = CopyStrategies::Clone;
+        result = true;
+    }
+    else if ( IsUnsupported( errno ) )
+# endif
+    {
+        // each way picks up from wherever the one before it gave up
+        if ( CopyRange( in, out, offset, size ) )
+        {
+            used = CopyStrategies::CopyRange;
+            result = true;
+        }
+        else if ( IsUnsupported( errno ) && SendFile( in, out, offset, size ) )
+        {
+            used = CopyStrategies::SendFile;
+            result = true;
+        }
+        else if ( IsUnsupported( errno ) )
+        {
+            used = CopyStrategies::Buffered;
+            result = CopyBuffered( in, out, offset );
+        }
+    }
+#else
+    used = CopyStrategies::Buffered;
+    result = CopyBuffered( in, out, offset );
+#endif
+
+    // the kernel copies stop at the size we saw, so they must have got there; a clone shares the source's
+    //  blocks whole, and the buffered copy reads to the end of the file (which for special files isn't st_size)
+    if ( result && ( used == CopyStrategies::CopyRange || used == CopyStrategies::SendFile ) && offset != size )
+    {
+        errno = EIO;
+        result = false;
+    }
+
+    if ( result )
+    {
+        // the mode given to open went through the umask
+        fchmod( out, info.st_mode & 07777 );
+
+#ifdef __APPLE__
+        struct timespec times[ 2 ] = { info.st_atimespec, info.st_mtimespec };
+#else
+        struct timespec times[ 2 ] = { info.st_atim, info.st_mtim };
+#endif
+        futimens( out, times );
+    }
+
+    result = close( out ) == 0 && result;
+    close( in );
+
+    if ( !result )
+    {
+        int error = errno;
+        ::unlink( dest );
+        errno = error;
+        return false;
+    }
+
+    if ( strategy )
+    {
+        *strategy = used;
+    }
+
+    return true;
 }
 
 bool Helium::Move( const tchar* source, const tchar* dest )
 {
-    return false;
+    if ( ::rename( source, dest ) == 0 )
+    {
+        return true;
+    }
+
+    if ( errno != EXDEV )
+    {
+        return false;
+    }
+
+    return Copy( source, dest, true ) && ::unlink( source ) == 0;
+}
+
+bool Helium::Replace( const tchar* source, const tchar* dest )
+{
+    // rename swaps the name over in one step, no copying fallback since that couldn't be atomic
+    return ::rename( source, dest ) == 0;
 }
 
 bool Helium::Delete( const tchar* path )
 {
-    return false;
+    return ::unlink( path ) == 0;
 }
 
 bool Helium::GetVersionInfo( const tchar* path, tstring& versionInfo )
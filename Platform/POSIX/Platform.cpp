@@ -1,14 +1,20 @@
 #include "Platform/Platform.h"
 
+#include "Platform/Compiler.h"
+
 #include <unistd.h>
 #include <stdarg.h>
 #include <stdio.h>
 
+#if defined( X86 ) || defined( X64 )
+# include <cpuid.h>
+#endif
+
 using namespace Helium;
 
-Platform::Type Helium::GetType()
+Platform::Type Platform::GetType()
 {
-    return Types::PlayStation3;
+    return Platform::Types::PlayStation3;
 }
 
 void Helium::Print(const tchar* fmt, ...)
@@ -23,3 +29,47 @@ void Helium::Sleep(int millis)
 {
     usleep( millis * 1000 );
 }
+
+u32 Helium::GetProcessorCount()
+{
+    long count = sysconf( _SC_NPROCESSORS_ONLN );
+    return count > 0 ? (u32)count : 1;
+}
+
+u32 Helium::GetProcessorFeatures()
+{
+    u32 features = 0;
+
+#if defined( X86 ) || defined( X64 )
+    unsigned int eax, ebx, ecx, edx;
+    if ( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) )
+    {
+        return 0;
+    }
+
+    features |= ( edx & bit_SSE2 ) ? ProcessorFeatures::SSE2 : 0;
+    features |= ( ecx & bit_SSSE3 ) ? ProcessorFeatures::SSSE3 : 0;
+    features |= ( ecx & bit_SSE4_1 ) ? ProcessorFeatures::SSE41 : 0;
+    features |= ( ecx & bit_SSE4_2 ) ? ProcessorFeatures::SSE42 : 0;
+    features |= ( ecx & bit_PCLMUL ) ? ProcessorFeatures::PCLMUL : 0;
+
+    // avx needs the OS to save the upper halves of the registers across context switches
+    if ( ( ecx & bit_OSXSAVE ) && ( ecx & bit_AVX ) )
+    {
+        unsigned int xcr0, xcr0High;
+        __asm__ ( "xgetbv" : "=a" ( xcr0 ), "=d" ( xcr0High ) : "c" ( 0 ) );
+        if ( ( xcr0 & 0x6 ) == 0x6 )
+        {
+            features |= ProcessorFeatures::AVX;
+
+            if ( __get_cpuid_max( 0, NULL ) >= 7 )
+            {
+                __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+                features |= ( ebx & bit_AVX2 ) ? ProcessorFeatures::AVX2 : 0;
+            }
+        }
+    }
+#endif
+
+    return features;
+}
@@ -3,6 +3,7 @@
 
 #include <pthread.h>
 #include <assert.h>
+#include <time.h>
 
 void Helium::TraceFile::Open(const tchar* file)
 {
@@ -24,16 +25,17 @@ const tchar* Helium::TraceFile::GetFilePath()
     return NULL;
 }
 
+// the clock counts nanoseconds of the monotonic clock, which is immune to wall clock changes
 u64 Helium::TimerGetClock()
 {
-    u64 time = 0;
-    HELIUM_BREAK();
-    return time;
+    timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (u64)now.tv_sec * 1000000000ULL + (u64)now.tv_nsec;
 }
 
 float Helium::CyclesToMillis(u64 cycles)
 {
-    return (f64)cycles * (f64)(1000.0 / 79800000ULL);
+    return (f64)cycles / 1000000.0;
 }
 
 float Helium::TimeTaken(u64 start_time)
@@ -1,38 +1,77 @@
 #include "Platform/Semaphore.h"
 #include "Platform/Platform.h"
+#include "Platform/Atomic.h"
 
 #include "Platform/Assert.h"
+#include "Platform/POSIX/Futex.h"
 
 using namespace Helium;
 
+//
+// Counting semaphore on a futex, Increment only enters the kernel if someone is sleeping
+//
+
 Semaphore::Semaphore()
 {
-    int result = sem_init(&m_Handle, 0, 0);
-    HELIUM_ASSERT( result == 0 );
+    m_Handle.Count = 0;
+    m_Handle.Waiters = 0;
 }
 
 Semaphore::~Semaphore()
 {
-    int result = sem_destroy(&m_Handle);
-    HELIUM_ASSERT( result == 0 );
+    HELIUM_ASSERT( m_Handle.Waiters == 0 );
 }
 
 void Semaphore::Increment()
 {
-    int result = sem_post(&m_Handle);
-    HELIUM_ASSERT( result == 0 );
+    AtomicIncrement( &m_Handle.Count, MemoryOrders::Sequential );
+
+    if ( AtomicLoad( &m_Handle.Waiters, MemoryOrders::Sequential ) > 0 )
+    {
+        FutexWake( &m_Handle.Count, 1 );
+    }
+}
+
+static bool TryDecrement( volatile i32* count )
+{
+    // sequential so a sleeper's check is ordered after it publishes itself in Waiters
+    i32 current = AtomicLoad( count, MemoryOrders::Sequential );
+    while ( current > 0 )
+    {
+        i32 previous = AtomicCompareExchange( count, current - 1, current, MemoryOrders::Acquire );
+        if ( previous == current )
+        {
+            return true;
+        }
+        current = previous;
+    }
+
+    return false;
 }
 
 void Semaphore::Decrement()
 {
-    int result = sem_wait(&m_Handle);
-    HELIUM_ASSERT( result == 0 );
+    for ( u32 i = 0; i < FUTEX_SPIN_COUNT; ++i )
+    {
+        if ( TryDecrement( &m_Handle.Count ) )
+        {
+            return;
+        }
+
+        FutexPause();
+    }
+
+    AtomicIncrement( &m_Handle.Waiters, MemoryOrders::Sequential );
+
+    while ( !TryDecrement( &m_Handle.Count ) )
+    {
+        FutexWait( &m_Handle.Count, 0 );
+    }
+
+    AtomicDecrement( &m_Handle.Waiters, MemoryOrders::Release );
 }
 
 void Semaphore::Reset()
 {
-    int result = sem_destroy(&m_Handle);
-    HELIUM_ASSERT( result == 0 );
-    result = sem_init(&m_Handle, 0, 0);
-    HELIUM_ASSERT( result == 0 );
+    AtomicStore( &m_Handle.Count, 0, MemoryOrders::Release );
 }
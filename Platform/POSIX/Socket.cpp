@@ -2,9 +2,24 @@
 
 #include "Platform/Platform.h"
 #include "Platform/Assert.h"
+#include "Platform/Atomic.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
 
 using namespace Helium;
 
+#ifdef PS3_POSIX
+# define HELIUM_CLOSE_SOCKET socketclose
+#else
+# define HELIUM_CLOSE_SOCKET ::close
+#endif
+
 bool Helium::InitializeSockets()
 {
     return true;
@@ -26,23 +41,19 @@ void Helium::CleanupSocketThread()
         Helium::Print( "TCP Support: Failed to cleanup thread context (%d)\n", Helium::GetSocketError() );
     }
 #endif
-
-    HELIUM_BREAK();
 }
 
 int Helium::GetSocketError()
 {
 #ifdef PS3_POSIX
     return sys_net_errno;
+#else
+    return errno;
 #endif
-
-    HELIUM_BREAK();
-    return -1;
 }
 
 bool Helium::CreateSocket(Socket& socket)
 {
-#ifdef PS3_POSIX
     socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
 
     if (socket < 0)
@@ -51,35 +62,31 @@ bool Helium::CreateSocket(Socket& socket)
         return false;
     }
 
-    return true;
+#ifndef PS3_POSIX
+    // allow the server to rebind its ports immediately after a restart
+    int flag = 1;
+    setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
 #endif
 
-    HELIUM_BREAK();
-    return false;
+    return true;
 }
 
 bool Helium::CloseSocket(Socket& socket)
 {
-#ifdef PS3_POSIX
     // don't bother to check for errors here, as this socket may not have been communicated through yet
     shutdown(socket, SHUT_RDWR);
 
-    if (socketclose(socket) < 0)
+    if (HELIUM_CLOSE_SOCKET(socket) < 0)
     {
         Helium::Print("TCP Support: Failed to close socket %d (%d)\n", socket, Helium::GetSocketError());
         return false;
     }
 
     return true;
-#endif
-
-    HELIUM_BREAK();
-    return false;
 }
 
 bool Helium::BindSocket(Socket& socket, u16 port)
 {
-#ifdef PS3_POSIX
     sockaddr_in service;
     service.sin_family = AF_INET;
     service.sin_addr.s_addr = INADDR_ANY;
@@ -92,7 +99,7 @@ bool Helium::BindSocket(Socket& socket, u16 port)
         {
             HELIUM_BREAK();
         }
-        if (socketclose(socket) < 0) {
+        if (HELIUM_CLOSE_SOCKET(socket) < 0) {
             HELIUM_BREAK();
         }
 
@@ -100,15 +107,10 @@ bool Helium::BindSocket(Socket& socket, u16 port)
     }
 
     return true;
-#endif
-
-    HELIUM_BREAK();
-    return false;
 }
 
 bool Helium::ListenSocket(Socket& socket)
 {
-#ifdef PS3_POSIX
     if (::listen(socket, 5) < 0)
     {
         Helium::Print("TCP Support: Failed to listen socket %d (%d)\n", socket, Helium::GetSocketError());
@@ -117,7 +119,7 @@ bool Helium::ListenSocket(Socket& socket)
         {
             HELIUM_BREAK();
         }
-        if (socketclose(socket) < 0)
+        if (HELIUM_CLOSE_SOCKET(socket) < 0)
         {
             HELIUM_BREAK();
         }
@@ -126,80 +128,331 @@ bool Helium::ListenSocket(Socket& socket)
     }
 
     return true;
-#endif
-
-    HELIUM_BREAK();
-    return false;
 }
 
 bool Helium::ConnectSocket(Socket& socket, sockaddr_in* service)
 {
-#ifdef PS3_POSIX
     return ::connect(socket, (struct sockaddr *)service, sizeof(sockaddr_in)) >= 0;
-#endif
-
-    HELIUM_BREAK();
-    return false;
 }
 
 bool Helium::AcceptSocket(Socket& socket, Socket& server_socket, sockaddr_in* client_info)
 {
-#ifdef PS3_POSIX
     socklen_t lengthname = sizeof(sockaddr_in);
 
     socket = ::accept( server_socket, (struct sockaddr *)client_info, &lengthname );
 
     return socket > 0;
-#endif
-
-    HELIUM_BREAK();
-    return false;
 }
 
 int Helium::SelectSocket(int range, fd_set* read_set, fd_set* write_set, struct timeval* timeout)
 {
 #ifdef PS3_POSIX
     return ::socketselect(range, read_set, write_set, 0, timeout);
+#else
+    return ::select(range, read_set, write_set, 0, timeout);
 #endif
+}
+
+//
+// The sockets are left in blocking mode (so connect and accept behave as on win32), these use
+//  MSG_DONTWAIT and park in the poller when the socket would block, so the wakeup can interrupt them
+//
 
-    HELIUM_BREAK();
-    return -1;
+bool Helium::ReadSocket(Socket& socket, void* buffer, u32 bytes, u32& read, SocketPoller& poller)
+{
+    if (bytes == 0)
+    {
+        return true;
+    }
+
+    while ( !poller.Woken() )
+    {
+        ssize_t local_read = ::recv( socket, buffer, bytes, MSG_DONTWAIT );
+
+        if (local_read > 0)
+        {
+            read = (u32)local_read;
+            return true;
+        }
+
+        if (local_read == 0)
+        {
+            // orderly shutdown by the remote end
+            return false;
+        }
+
+        if (errno == EINTR)
+        {
+            continue;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+#ifdef IPC_TCP_DEBUG_SOCKETS
+            Helium::Print("TCP Support: Failed read (%d)\n", Helium::GetSocketError());
+#endif
+            return false;
+        }
+
+        SocketPoller::Event event;
+        if ( poller.Wait( &event, 1 ) < 0 )
+        {
+            return false;
+        }
+    }
+
+#ifdef IPC_TCP_DEBUG_SOCKETS
+    Helium::Print("TCP Support: Terminating read\n");
+#endif
+    return false;
 }
 
-bool Helium::ReadSocket(Socket& socket, void* buffer, u32 bytes, u32& read, Condition& terminate)
+bool Helium::WriteSocket(Socket& socket, void* buffer, u32 bytes, u32& wrote, SocketPoller& poller)
 {
-#ifdef PS3_POSIX
-    i32 local_read = ::recv( socket, (tchar*)buffer, bytes, 0 );
+    if (bytes == 0)
+    {
+        return true;
+    }
 
-    if (local_read < 0)
+    while ( !poller.Woken() )
     {
-        return false;
+        ssize_t local_wrote = ::send( socket, buffer, bytes, MSG_DONTWAIT | MSG_NOSIGNAL );
+
+        if (local_wrote > 0)
+        {
+            wrote = (u32)local_wrote;
+            return true;
+        }
+
+        if (local_wrote < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (local_wrote == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+#ifdef IPC_TCP_DEBUG_SOCKETS
+            Helium::Print("TCP Support: Failed write (%d)\n", Helium::GetSocketError());
+#endif
+            return false;
+        }
+
+        SocketPoller::Event event;
+        if ( poller.Wait( &event, 1 ) < 0 )
+        {
+            return false;
+        }
     }
 
-    read = local_read;
+#ifdef IPC_TCP_DEBUG_SOCKETS
+    Helium::Print("TCP Support: Terminating write\n");
+#endif
+    return false;
+}
 
-    return true;
+bool Helium::WriteSocketVector(Socket& socket, const SocketBuffer* buffers, u32 count, u32& wrote, SocketPoller& poller)
+{
+    HELIUM_ASSERT( count <= SOCKET_MAX_BUFFERS );
+
+    iovec vectors[ SOCKET_MAX_BUFFERS ];
+    u32 used = 0;
+    for ( u32 i = 0; i < count; ++i )
+    {
+        if ( buffers[ i ].m_Size )
+        {
+            vectors[ used ].iov_base = buffers[ i ].m_Data;
+            vectors[ used ].iov_len = buffers[ i ].m_Size;
+            used++;
+        }
+    }
+
+    if (used == 0)
+    {
+        return true;
+    }
+
+    msghdr message;
+    memset( &message, 0, sizeof( message ) );
+    message.msg_iov = vectors;
+    message.msg_iovlen = used;
+
+    while ( !poller.Woken() )
+    {
+        ssize_t local_wrote = ::sendmsg( socket, &message, MSG_DONTWAIT | MSG_NOSIGNAL );
+
+        if (local_wrote > 0)
+        {
+            wrote = (u32)local_wrote;
+            return true;
+        }
+
+        if (local_wrote < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (local_wrote == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+#ifdef IPC_TCP_DEBUG_SOCKETS
+            Helium::Print("TCP Support: Failed gathered write (%d)\n", Helium::GetSocketError());
 #endif
+            return false;
+        }
+
+        SocketPoller::Event event;
+        if ( poller.Wait( &event, 1 ) < 0 )
+        {
+            return false;
+        }
+    }
 
-    HELIUM_BREAK();
+#ifdef IPC_TCP_DEBUG_SOCKETS
+    Helium::Print("TCP Support: Terminating write\n");
+#endif
     return false;
 }
 
-bool Helium::WriteSocket(Socket& socket, void* buffer, u32 bytes, u32& wrote, Condition& terminate)
+SocketPoller::SocketPoller()
+: m_Woken (0)
 {
-#ifdef PS3_POSIX
-    i32 local_wrote = ::send( socket, (tchar*)buffer, bytes, 0 );
+    m_Handle = ::epoll_create1( EPOLL_CLOEXEC );
+    if ( m_Handle < 0 )
+    {
+        Helium::Print("TCP Support: Failed to create epoll instance (%d)\n", Helium::GetSocketError());
+        HELIUM_BREAK();
+    }
 
-    if (local_wrote < 0)
+    m_Wakeup = ::eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+    if ( m_Wakeup < 0 )
     {
+        Helium::Print("TCP Support: Failed to create wakeup event (%d)\n", Helium::GetSocketError());
+        HELIUM_BREAK();
+    }
+
+    // the wakeup is level triggered, so it keeps waking Wait until Reset drains it
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = this;
+    if ( ::epoll_ctl( m_Handle, EPOLL_CTL_ADD, m_Wakeup, &event ) < 0 )
+    {
+        Helium::Print("TCP Support: Failed to register wakeup event (%d)\n", Helium::GetSocketError());
+        HELIUM_BREAK();
+    }
+}
+
+SocketPoller::~SocketPoller()
+{
+    ::close( m_Wakeup );
+    ::close( m_Handle );
+}
+
+bool SocketPoller::Add( Socket& socket, u32 events, void* userData )
+{
+    epoll_event event;
+    event.events = EPOLLET | EPOLLRDHUP;
+    event.data.ptr = userData;
+
+    if ( events & SocketEvents::Read )
+    {
+        event.events |= EPOLLIN;
+    }
+
+    if ( events & SocketEvents::Write )
+    {
+        event.events |= EPOLLOUT;
+    }
+
+    if ( ::epoll_ctl( m_Handle, EPOLL_CTL_ADD, socket, &event ) < 0 )
+    {
+        Helium::Print("TCP Support: Failed to register socket %d (%d)\n", socket, Helium::GetSocketError());
         return false;
     }
 
-    wrote = local_wrote;
+    return true;
+}
+
+bool SocketPoller::Remove( Socket& socket )
+{
+    if ( ::epoll_ctl( m_Handle, EPOLL_CTL_DEL, socket, NULL ) < 0 )
+    {
+        Helium::Print("TCP Support: Failed to unregister socket %d (%d)\n", socket, Helium::GetSocketError());
+        return false;
+    }
 
     return true;
-#endif
+}
 
-    HELIUM_BREAK();
-    return false;
+int SocketPoller::Wait( Event* events, u32 count, u32 timeout )
+{
+    HELIUM_ASSERT( count > 0 );
+
+    epoll_event ready[ SOCKET_POLLER_MAX + 1 ];
+    if ( count > SOCKET_POLLER_MAX )
+    {
+        count = SOCKET_POLLER_MAX;
+    }
+
+    int result = 0;
+    do
+    {
+        result = ::epoll_wait( m_Handle, ready, count + 1, timeout == 0xffffffff ? -1 : (int)timeout );
+    }
+    while ( result < 0 && errno == EINTR );
+
+    if ( result < 0 )
+    {
+        Helium::Print("TCP Support: Failed to wait for sockets (%d)\n", Helium::GetSocketError());
+        return -1;
+    }
+
+    int written = 0;
+    for ( int i = 0; i < result; ++i )
+    {
+        if ( ready[ i ].data.ptr == this )
+        {
+            // the wakeup takes priority over any socket activity
+            return 0;
+        }
+
+        events[ written ].m_UserData = ready[ i ].data.ptr;
+        events[ written ].m_Events = 0;
+
+        if ( ready[ i ].events & EPOLLIN )
+        {
+            events[ written ].m_Events |= SocketEvents::Read;
+        }
+
+        if ( ready[ i ].events & EPOLLOUT )
+        {
+            events[ written ].m_Events |= SocketEvents::Write;
+        }
+
+        if ( ready[ i ].events & ( EPOLLRDHUP | EPOLLHUP | EPOLLERR ) )
+        {
+            events[ written ].m_Events |= SocketEvents::Closed;
+        }
+
+        ++written;
+    }
+
+    return written;
+}
+
+void SocketPoller::Wakeup()
+{
+    AtomicStore( &m_Woken, 1, MemoryOrders::Sequential );
+    eventfd_write( m_Wakeup, 1 );
+}
+
+void SocketPoller::Reset()
+{
+    AtomicStore( &m_Woken, 0, MemoryOrders::Sequential );
+
+    eventfd_t value;
+    eventfd_read( m_Wakeup, &value );
+}
+
+bool SocketPoller::Woken()
+{
+    return AtomicLoad( &m_Woken, MemoryOrders::Acquire ) != 0;
 }
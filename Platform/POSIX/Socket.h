@@ -8,9 +8,11 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
-#include <netex/net.h>
-#include <netex/ifctl.h>
-#include <netex/errno.h>
+#ifdef PS3_POSIX
+# include <netex/net.h>
+# include <netex/ifctl.h>
+# include <netex/errno.h>
+#endif
 #include <arpa/inet.h>
 
 namespace Helium
@@ -1,6 +1,36 @@
 #include "Platform/Stat.h"
 
+#include <sys/stat.h>
+
 bool Helium::StatPath( const tchar* path, Helium::Stat& stat )
 {
-    return false;
+    struct stat posixStats;
+    bool result = ( ::stat( path, &posixStats ) == 0 );
+
+    if ( result )
+    {
+        if ( S_ISREG( posixStats.st_mode ) )
+            stat.m_Mode |= ModeFlags::File;
+        if ( S_ISDIR( posixStats.st_mode ) )
+            stat.m_Mode |= ModeFlags::Directory;
+        if ( S_ISFIFO( posixStats.st_mode ) )
+            stat.m_Mode |= ModeFlags::Pipe;
+        if ( S_ISCHR( posixStats.st_mode ) || S_ISBLK( posixStats.st_mode ) || S_ISSOCK( posixStats.st_mode ) )
+            stat.m_Mode |= ModeFlags::Special;
+
+        if ( posixStats.st_mode & S_IRUSR )
+            stat.m_Mode |= ModeFlags::Read;
+        if ( posixStats.st_mode & S_IWUSR )
+            stat.m_Mode |= ModeFlags::Write;
+        if ( posixStats.st_mode & S_IXUSR )
+            stat.m_Mode |= ModeFlags::Execute;
+
+        // seconds, like the windows implementation
+        stat.m_AccessTime = posixStats.st_atime;
+        stat.m_CreatedTime = posixStats.st_ctime;
+        stat.m_ModifiedTime = posixStats.st_mtime;
+        stat.m_Size = posixStats.st_size;
+    }
+
+    return result;
 }
@@ -3,10 +3,22 @@
 
 #include "Platform/Assert.h"
 
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
 using namespace Helium;
 
+// linux limits thread names to 16 characters, including the terminator
+static const size_t s_MaxThreadName = 16;
+
 Thread::Thread()
 : m_Handle (0x0)
+, m_Joined (false)
+, m_Return (NULL)
 {
 
 }
@@ -19,30 +31,166 @@ Thread::~Thread()
     }
 }
 
-bool Thread::Create(Entry entry, void* obj, const tchar* name, int priority)
+static void SetThreadName( pthread_t thread, const char* name )
+{
+    if ( !name )
+    {
+        return;
+    }
+
+    char truncated[ s_MaxThreadName ];
+    strncpy( truncated, name, s_MaxThreadName - 1 );
+    truncated[ s_MaxThreadName - 1 ] = '\0';
+
+    pthread_setname_np( thread, truncated );
+}
+
+//
+// Map our win32-style priority values onto the linux scheduling classes:
+//  below normal priorities are batch or idle class (no privileges needed),
+//  above normal priorities are realtime round robin, and time critical is fifo
+//
+
+static void GetSchedulingClass( int priority, int& policy, sched_param& param )
+{
+    memset( &param, 0, sizeof( param ) );
+
+    if ( priority <= ThreadPriorities::Idle )
+    {
+        policy = SCHED_IDLE;
+    }
+    else if ( priority < ThreadPriorities::Normal )
+    {
+        policy = SCHED_BATCH;
+    }
+    else if ( priority == ThreadPriorities::Normal )
+    {
+        policy = SCHED_OTHER;
+    }
+    else if ( priority < ThreadPriorities::TimeCritical )
+    {
+        policy = SCHED_RR;
+        param.sched_priority = sched_get_priority_min( SCHED_RR ) + priority;
+    }
+    else
+    {
+        policy = SCHED_FIFO;
+        param.sched_priority = sched_get_priority_max( SCHED_FIFO );
+    }
+}
+
+bool Thread::Create(Entry entry, void* obj, const char* name, int priority)
 {
-    HELIUM_ASSERT( false );
+    if (Valid())
+    {
+        Close();
+    }
+
+    m_Joined = false;
+    m_Return = NULL;
+
+    int result = pthread_create( &m_Handle, NULL, entry, obj );
+    if ( result != 0 )
+    {
+        Helium::Print(TXT("Failed to create thread: %s\n [0x%x: %s]"), name, result, strerror( result ));
+        m_Handle = 0x0;
+        return false;
+    }
+
+    SetThreadName( m_Handle, name );
+
+    if ( priority != ThreadPriorities::Normal )
+    {
+        SetPriority( priority );
+    }
+
     return true;
 }
 
 Thread::Return Thread::Exit()
 {
-    HELIUM_ASSERT( false );
+    return NULL;
 }
 
 void Thread::Close()
 {
+    if ( !m_Joined )
+    {
+        int result = pthread_detach( m_Handle );
+        if ( result != 0 )
+        {
+            Helium::Print(TXT("Failed to close thread (%s)\n"), strerror( result ));
+            HELIUM_BREAK();
+        }
+    }
+
     m_Handle = 0x0;
+    m_Joined = false;
 }
 
 Thread::Return Thread::Wait(u32 timeout)
 {
-    HELIUM_ASSERT( false );
+    if ( !Valid() )
+    {
+        return 0;
+    }
+
+    if ( m_Joined )
+    {
+        return m_Return;
+    }
+
+    int result = 0;
+    if ( timeout == 0xffffffff )
+    {
+        result = pthread_join( m_Handle, &m_Return );
+    }
+    else
+    {
+        timespec deadline;
+        clock_gettime( CLOCK_REALTIME, &deadline );
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += ( timeout % 1000 ) * 1000000;
+        if ( deadline.tv_nsec >= 1000000000 )
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        result = pthread_timedjoin_np( m_Handle, &m_Return, &deadline );
+        if ( result == ETIMEDOUT )
+        {
+            return (Return)-1;
+        }
+    }
+
+    if ( result != 0 )
+    {
+        Helium::Print(TXT("Failed to wait for thread (%s)\n"), strerror( result ));
+        HELIUM_BREAK();
+        return (Return)-1;
+    }
+
+    m_Joined = true;
+    return m_Return;
 }
 
 bool Thread::Running()
 {
-    HELIUM_ASSERT( false );
+    if ( !Valid() || m_Joined )
+    {
+        return false;
+    }
+
+    // reap the thread if it has finished so a later Wait() can return its result
+    int result = pthread_tryjoin_np( m_Handle, &m_Return );
+    if ( result == EBUSY )
+    {
+        return true;
+    }
+
+    m_Joined = ( result == 0 );
+    return false;
 }
 
 bool Thread::Valid()
@@ -50,54 +198,93 @@ bool Thread::Valid()
     return m_Handle != 0;
 }
 
+bool Thread::SetAffinity( u64 mask )
+{
+    HELIUM_ASSERT( Valid() );
+
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    for ( u32 i = 0; i < 64 && i < CPU_SETSIZE; ++i )
+    {
+        if ( mask & ( 1ULL << i ) )
+        {
+            CPU_SET( i, &set );
+        }
+    }
+
+    int result = pthread_setaffinity_np( m_Handle, sizeof( set ), &set );
+    if ( result != 0 )
+    {
+        Helium::Print(TXT("Failed to set thread affinity to 0x%llx (%s)\n"), mask, strerror( result ));
+        return false;
+    }
+
+    return true;
+}
+
+bool Thread::SetPriority( int priority )
+{
+    HELIUM_ASSERT( Valid() );
+
+    int policy = SCHED_OTHER;
+    sched_param param;
+    GetSchedulingClass( priority, policy, param );
+
+    int result = pthread_setschedparam( m_Handle, policy, &param );
+    if ( result != 0 )
+    {
+        // realtime classes need CAP_SYS_NICE, the thread just keeps running at normal priority
+        Helium::Print(TXT("Failed to set thread priority to %d (%s)\n"), priority, strerror( result ));
+        return false;
+    }
+
+    return true;
+}
+
 ThreadLocalPointer::ThreadLocalPointer()
 {
-#ifdef PS3_POSIX
     int status = pthread_key_create(&m_Key, NULL);
     HELIUM_ASSERT( status == 0 && "Could not create pthread_key");
-#endif
+    (void)status; // only checked in debug builds
 
     SetPointer(NULL);
-
-    HELIUM_BREAK();
 }
 
 ThreadLocalPointer::~ThreadLocalPointer()
 {
-#ifdef PS3_POSIX
     pthread_key_delete(m_Key);
-#endif
-
-    HELIUM_BREAK();
 }
 
 void* ThreadLocalPointer::GetPointer()
 {
-#ifdef PS3_POSIX
     return pthread_getspecific(m_Key);
-#endif
-
-    HELIUM_BREAK();
-    return NULL;
 }
 
 void ThreadLocalPointer::SetPointer(void* pointer)
 {
-#ifdef PS3_POSIX
     pthread_setspecific(m_Key, pointer);
-#endif
+}
 
-    HELIUM_BREAK();
+static u32 GetThreadID()
+{
+    // gettid is a syscall, and the mutex calls this on every lock, so cache it per thread
+    static __thread u32 s_ThreadID = 0;
+    if ( s_ThreadID == 0 )
+    {
+        s_ThreadID = (u32)::syscall( SYS_gettid );
+    }
+
+    return s_ThreadID;
 }
 
+static u32 g_MainThreadID = GetThreadID();
+
 u32 Helium::GetMainThreadID()
 {
-    HELIUM_BREAK();
-    return 0;
+    return g_MainThreadID;
 }
 
 u32 Helium::GetCurrentThreadID()
 {
-    HELIUM_BREAK();
-    return 0;
+    return GetThreadID();
 }
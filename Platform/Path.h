@@ -15,11 +15,34 @@ namespace Helium
 {
     PLATFORM_API extern const tchar PathSeparator;
 
+    // how Copy got the data across, fastest first
+    namespace CopyStrategies
+    {
+        enum CopyStrategy
+        {
+            None,
+            Clone,          // the new file shares the source's blocks until either is written (FICLONE)
+            CopyRange,      // copied inside the kernel, or by the filesystem or server (copy_file_range)
+            SendFile,       // copied inside the kernel through the page cache (sendfile)
+            Buffered,       // read and written through a buffer of our own
+            System,         // handed to the operating system's copy (CopyFile)
+        };
+    }
+    typedef CopyStrategies::CopyStrategy CopyStrategy;
+
     PLATFORM_API bool GetFullPath( const tchar* path, tstring& fullPath );
     PLATFORM_API bool IsAbsolute( const tchar* path );
     PLATFORM_API bool MakePath( const tchar* path );
-    PLATFORM_API bool Copy( const tchar* source, const tchar* dest, bool overwrite );
+
+    // copy a file with its permissions and timestamps, strategy (if given) says how it was done
+    PLATFORM_API bool Copy( const tchar* source, const tchar* dest, bool overwrite, CopyStrategy* strategy = NULL );
+
+    // rename a file, copying it and deleting the source if it's going to another filesystem
     PLATFORM_API bool Move( const tchar* source, const tchar* dest );
+
+    // atomically rename a file over another on the same filesystem, readers see either the old dest or the new one
+    PLATFORM_API bool Replace( const tchar* source, const tchar* dest );
+
     PLATFORM_API bool Delete( const tchar* path );
     PLATFORM_API bool GetVersionInfo( const tchar* path, tstring& versionInfo );
 }
\ No newline at end of file
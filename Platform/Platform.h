@@ -47,4 +47,25 @@ namespace Helium
 
     PLATFORM_API void Print(const tchar* fmt, ...);
     PLATFORM_API void Sleep(int millis);
+
+    // number of processors available to this process
+    PLATFORM_API u32 GetProcessorCount();
+
+    namespace ProcessorFeatures
+    {
+        enum ProcessorFeature
+        {
+            SSE2    = 1 << 0,
+            SSSE3   = 1 << 1,
+            SSE41   = 1 << 2,
+            SSE42   = 1 << 3,
+            PCLMUL  = 1 << 4,
+            AVX     = 1 << 5,   // only when the OS saves the ymm registers too
+            AVX2    = 1 << 6,
+        };
+    }
+    typedef ProcessorFeatures::ProcessorFeature ProcessorFeature;
+
+    // the instruction set extensions we can use on this processor (ProcessorFeatures bits), 0 off x86
+    PLATFORM_API u32 GetProcessorFeatures();
 }
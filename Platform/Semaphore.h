@@ -4,10 +4,6 @@
 
 #include "Types.h"
 
-#ifdef __GNUC__
-# include <semaphore.h>
-#endif
-
 namespace Helium
 {
     class PLATFORM_API Semaphore
@@ -15,7 +11,14 @@ namespace Helium
     public:
 
 #ifdef __GNUC__
-        typedef sem_t Handle;
+        struct Handle
+        {
+            // available count
+            volatile i32 Count;
+
+            // number of threads sleeping on Count
+            volatile i32 Waiters;
+        };
 #elif defined( WIN32 )
         typedef void* Handle;
 #else
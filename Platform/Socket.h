@@ -8,8 +8,106 @@
 
 #include "Condition.h"
 
+// maximum number of sockets that can be registered with a single SocketPoller (win32 can wait on 64 events, one is the wakeup)
+#define SOCKET_POLLER_MAX 63
+
+// maximum number of buffers gathered into a single send by WriteSocketVector
+#define SOCKET_MAX_BUFFERS 64
+
 namespace Helium
 {
+    namespace SocketEvents
+    {
+        enum SocketEvent
+        {
+            Read    = 1 << 0,   // data (or a pending connection) is available
+            Write   = 1 << 1,   // the send buffer has space
+            Closed  = 1 << 2,   // the remote end hung up, or the socket errored
+        };
+    }
+    typedef SocketEvents::SocketEvent SocketEvent;
+
+    //
+    // SocketPoller - Readiness notification for a set of sockets (epoll on linux, WSAEventSelect on win32)
+    //  Registration is edge triggered: an event is reported when a socket *becomes* ready, so consumers
+    //  must read or write until the socket would block before waiting again.  The wakeup is a manual-reset
+    //  event (like Condition) that makes Wait return immediately until it is reset, it is used to interrupt
+    //  threads blocked on sockets when a connection is terminating.
+    //
+
+    class PLATFORM_API SocketPoller
+    {
+    public:
+        struct Event
+        {
+            void*   m_UserData;     // value passed to Add() for this socket
+            u32     m_Events;       // SocketEvents that are ready
+        };
+
+    private:
+#ifdef WIN32
+        struct Registration
+        {
+            uintptr m_Socket;
+            void*   m_Event;
+            u32     m_Events;
+            void*   m_UserData;
+        };
+
+        void*           m_Wakeup;
+        Registration    m_Registrations[ SOCKET_POLLER_MAX ];
+        u32             m_Count;
+#else
+        int             m_Handle;   // epoll instance
+        int             m_Wakeup;   // eventfd
+        volatile i32    m_Woken;    // mirrors the eventfd so the socket functions don't need a syscall to check it
+#endif
+
+    public:
+        SocketPoller();
+        ~SocketPoller();
+
+    private:
+        SocketPoller( const SocketPoller& rhs )
+        {
+
+        }
+
+    public:
+        // register a socket for a mask of SocketEvents
+        bool Add( Socket& socket, u32 events, void* userData = NULL );
+
+        // unregister a socket (this must be done before it is closed)
+        bool Remove( Socket& socket );
+
+        // block until a registered socket becomes ready, the timeout expires, or the wakeup is signaled
+        //  returns the number of events written, zero for timeout or wakeup, or -1 on failure
+        int Wait( Event* events, u32 count, u32 timeout = 0xffffffff );
+
+        // wake up (and keep waking up) threads blocked in Wait
+        void Wakeup();
+
+        // clear the wakeup so Wait will block again
+        void Reset();
+
+        // is the wakeup signaled
+        bool Woken();
+
+#ifdef WIN32
+        void* GetWakeupHandle()
+        {
+            return m_Wakeup;
+        }
+#endif
+    };
+
+    // one piece of a gathered write
+    struct SocketBuffer
+    {
+        void*   m_Data;
+        u32     m_Size;
+    };
+
     PLATFORM_API bool InitializeSockets();
     PLATFORM_API void CleanupSockets();
     PLATFORM_API void CleanupSocketThread();
@@ -26,6 +124,11 @@ namespace Helium
 
     PLATFORM_API int SelectSocket(int range, fd_set* read_set, fd_set* write_set, struct timeval* timeout);
 
-    PLATFORM_API bool ReadSocket(Socket& socket, void* buffer, u32 bytes, u32& read, Condition& terminate);
-    PLATFORM_API bool WriteSocket(Socket& socket, void* buffer, u32 bytes, u32& wrote, Condition& terminate);
+    // these block until some data has been transferred, the connection breaks, or the poller is woken up
+    //  (the socket must be registered with the poller for the matching SocketEvent)
+    PLATFORM_API bool ReadSocket(Socket& socket, void* buffer, u32 bytes, u32& read, SocketPoller& poller);
+    PLATFORM_API bool WriteSocket(Socket& socket, void* buffer, u32 bytes, u32& wrote, SocketPoller& poller);
+
+    // like WriteSocket, but sends up to SOCKET_MAX_BUFFERS buffers with one call (wrote may end partway into any of them)
+    PLATFORM_API bool WriteSocketVector(Socket& socket, const SocketBuffer* buffers, u32 count, u32& wrote, SocketPoller& poller);
 }
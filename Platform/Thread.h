@@ -10,6 +10,26 @@
 
 namespace Helium
 {
+    //
+    // Thread priorities, these match the win32 THREAD_PRIORITY_* values so they can be passed through
+    //  on that platform, and are mapped to scheduling classes elsewhere
+    //
+
+    namespace ThreadPriorities
+    {
+        enum ThreadPriority
+        {
+            Idle            = -15,
+            Lowest          = -2,
+            BelowNormal     = -1,
+            Normal          = 0,
+            AboveNormal     = 1,
+            Highest         = 2,
+            TimeCritical    = 15,
+        };
+    }
+    typedef ThreadPriorities::ThreadPriority ThreadPriority;
+
     class PLATFORM_API Thread
     {
     public:
@@ -19,15 +39,21 @@ namespace Helium
         typedef void*               Param;
         typedef Return              (*Entry)(Param);
 #else
-        typedef sys_ppu_thread_t    Handle;
-        typedef void                Return;
-        typedef u64                 Param;
+        typedef pthread_t           Handle;
+        typedef void*               Return;
+        typedef void*               Param;
         typedef Return              (*Entry)(Param);
 #endif
 
     private:
         Handle m_Handle;
 
+#ifndef WIN32
+        // pthreads can only be joined once, so cache the result for Running() and Wait()
+        bool   m_Joined;
+        Return m_Return;
+#endif
+
         struct ThreadHelperArgs
         {
             ThreadHelperArgs( void* object, void* args )
@@ -49,7 +75,7 @@ namespace Helium
             return m_Handle;
         }
 
-        // create and execute a thread
+        // create and execute a thread (priority is one of ThreadPriorities)
         bool Create( Entry entry, void* obj, const char* name, int priority = 0 );
 
         // C++ helper (remember, it is valid to pass a member function pointer as a template parameter!)
@@ -65,7 +91,7 @@ namespace Helium
         bool CreateWithArgs( Entry entry, void* obj, void* args, const char* name, int priority = 0 )
         {
             ThreadHelperArgs* threadHelperArgs = new ThreadHelperArgs( obj, args );
-            return Create(entry, threadHelperArgs, name);
+            return Create(entry, threadHelperArgs, name, priority);
         }
 
         // C++ helper (remember, it is valid to pass a member function pointer as a template parameter!)
@@ -98,6 +124,12 @@ namespace Helium
 
         // are we valid?
         bool Valid();
+
+        // pin the thread to the processors set in mask (bit N is processor N)
+        bool SetAffinity( u64 mask );
+
+        // change the scheduling priority of a running thread (one of ThreadPriorities)
+        bool SetPriority( int priority );
     };
 
     class PLATFORM_API ThreadLocalPointer
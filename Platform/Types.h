@@ -24,8 +24,13 @@ typedef double                  f64;
 typedef unsigned int            p32;
 typedef unsigned long long      p64;
 
-typedef unsigned int            uintptr;
-typedef int                     intptr;
+#if defined( __LP64__ ) || defined( _LP64 )
+typedef u64                     uintptr;
+typedef i64                     intptr;
+#else
+typedef u32                     uintptr;
+typedef i32                     intptr;
+#endif
 
 #elif defined( WIN32 )
 
@@ -0,0 +1,244 @@
+#pragma once
+
+//
+// Atomic operations backed by the msvc interlocked intrinsics, included by Platform/Atomic.h
+//  x86 and x64 are strongly ordered, so acquire loads and release stores only need a compiler barrier
+//
+
+#include <intrin.h>
+
+#pragma intrinsic( _ReadWriteBarrier )
+#pragma intrinsic( _InterlockedIncrement )
+#pragma intrinsic( _InterlockedDecrement )
+#pragma intrinsic( _InterlockedExchange )
+#pragma intrinsic( _InterlockedCompareExchange )
+#pragma intrinsic( _InterlockedExchangeAdd )
+#pragma intrinsic( _InterlockedOr )
+#pragma intrinsic( _InterlockedAnd )
+#pragma intrinsic( _InterlockedCompareExchange64 )
+
+namespace Helium
+{
+    //
+    // 32 bit
+    //
+
+    inline i32 AtomicIncrement( volatile i32* value, MemoryOrder )
+    {
+        return _InterlockedIncrement( (volatile long*)value );
+    }
+
+    inline i32 AtomicDecrement( volatile i32* value, MemoryOrder )
+    {
+        return _InterlockedDecrement( (volatile long*)value );
+    }
+
+    inline i32 AtomicExchange( volatile i32* addr, i32 value, MemoryOrder )
+    {
+        return _InterlockedExchange( (volatile long*)addr, value );
+    }
+
+    inline i32 AtomicCompareExchange( volatile i32* addr, i32 value, i32 comparand, MemoryOrder )
+    {
+        return _InterlockedCompareExchange( (volatile long*)addr, value, comparand );
+    }
+
+    inline i32 AtomicFetchAdd( volatile i32* addr, i32 value, MemoryOrder )
+    {
+        return _InterlockedExchangeAdd( (volatile long*)addr, value );
+    }
+
+    inline i32 AtomicFetchOr( volatile i32* addr, i32 value, MemoryOrder )
+    {
+        return _InterlockedOr( (volatile long*)addr, value );
+    }
+
+    inline i32 AtomicFetchAnd( volatile i32* addr, i32 value, MemoryOrder )
+    {
+        return _InterlockedAnd( (volatile long*)addr, value );
+    }
+
+    inline i32 AtomicLoad( const volatile i32* addr, MemoryOrder )
+    {
+        i32 result = *addr;
+        _ReadWriteBarrier();
+        return result;
+    }
+
+    inline void AtomicStore( volatile i32* addr, i32 value, MemoryOrder order )
+    {
+        if ( order == MemoryOrders::Sequential )
+        {
+            _InterlockedExchange( (volatile long*)addr, value );
+        }
+        else
+        {
+            _ReadWriteBarrier();
+            *addr = value;
+        }
+    }
+
+    //
+    // 64 bit (x86 only has a 64 bit compare exchange, so the rest are built from that)
+    //
+
+    inline i64 AtomicCompareExchange( volatile i64* addr, i64 value, i64 comparand, MemoryOrder )
+    {
+        return _InterlockedCompareExchange64( (volatile __int64*)addr, value, comparand );
+    }
+
+#ifdef X64
+    inline i64 AtomicIncrement( volatile i64* value, MemoryOrder )
+    {
+        return _InterlockedIncrement64( (volatile __int64*)value );
+    }
+
+    inline i64 AtomicDecrement( volatile i64* value, MemoryOrder )
+    {
+        return _InterlockedDecrement64( (volatile __int64*)value );
+    }
+
+    inline i64 AtomicExchange( volatile i64* addr, i64 value, MemoryOrder )
+    {
+        return _InterlockedExchange64( (volatile __int64*)addr, value );
+    }
+
+    inline i64 AtomicFetchAdd( volatile i64* addr, i64 value, MemoryOrder )
+    {
+        return _InterlockedExchangeAdd64( (volatile __int64*)addr, value );
+    }
+
+    inline i64 AtomicFetchOr( volatile i64* addr, i64 value, MemoryOrder )
+    {
+        return _InterlockedOr64( (volatile __int64*)addr, value );
+    }
+
+    inline i64 AtomicFetchAnd( volatile i64* addr, i64 value, MemoryOrder )
+    {
+        return _InterlockedAnd64( (volatile __int64*)addr, value );
+    }
+
+    inline i64 AtomicLoad( const volatile i64* addr, MemoryOrder )
+    {
+        i64 result = *addr;
+        _ReadWriteBarrier();
+        return result;
+    }
+
+    inline void AtomicStore( volatile i64* addr, i64 value, MemoryOrder order )
+    {
+        if ( order == MemoryOrders::Sequential )
+        {
+            _InterlockedExchange64( (volatile __int64*)addr, value );
+        }
+        else
+        {
+            _ReadWriteBarrier();
+            *addr = value;
+        }
+    }
+#else
+    inline i64 AtomicFetchAdd( volatile i64* addr, i64 value, MemoryOrder )
+    {
+        i64 previous = *addr;
+        i64 current;
+        while ( ( current = AtomicCompareExchange( addr, previous + value, previous ) ) != previous )
+        {
+            previous = current;
+        }
+        return previous;
+    }
+
+    inline i64 AtomicFetchOr( volatile i64* addr, i64 value, MemoryOrder )
+    {
+        i64 previous = *addr;
+        i64 current;
+        while ( ( current = AtomicCompareExchange( addr, previous | value, previous ) ) != previous )
+        {
+            previous = current;
+        }
+        return previous;
+    }
+
+    inline i64 AtomicFetchAnd( volatile i64* addr, i64 value, MemoryOrder )
+    {
+        i64 previous = *addr;
+        i64 current;
+        while ( ( current = AtomicCompareExchange( addr, previous & value, previous ) ) != previous )
+        {
+            previous = current;
+        }
+        return previous;
+    }
+
+    inline i64 AtomicExchange( volatile i64* addr, i64 value, MemoryOrder )
+    {
+        i64 previous = *addr;
+        i64 current;
+        while ( ( current = AtomicCompareExchange( addr, value, previous ) ) != previous )
+        {
+            previous = current;
+        }
+        return previous;
+    }
+
+    inline i64 AtomicIncrement( volatile i64* value, MemoryOrder order )
+    {
+        return AtomicFetchAdd( value, 1, order ) + 1;
+    }
+
+    inline i64 AtomicDecrement( volatile i64* value, MemoryOrder order )
+    {
+        return AtomicFetchAdd( value, -1, order ) - 1;
+    }
+
+    // plain 64 bit loads and stores can tear on x86, so go through the compare exchange
+    inline i64 AtomicLoad( const volatile i64* addr, MemoryOrder )
+    {
+        return AtomicCompareExchange( const_cast< volatile i64* >( addr ), 0, 0 );
+    }
+
+    inline void AtomicStore( volatile i64* addr, i64 value, MemoryOrder )
+    {
+        AtomicExchange( addr, value );
+    }
+#endif
+
+    //
+    // Pointer width
+    //
+
+    template< class T >
+    inline T* AtomicExchange( T* volatile* addr, T* value, MemoryOrder order )
+    {
+        return (T*)AtomicExchange( (volatile intptr*)addr, (intptr)value, order );
+    }
+
+    template< class T >
+    inline T* AtomicCompareExchange( T* volatile* addr, T* value, T* comparand, MemoryOrder order )
+    {
+        return (T*)AtomicCompareExchange( (volatile intptr*)addr, (intptr)value, (intptr)comparand, order );
+    }
+
+    template< class T >
+    inline T* AtomicLoad( T* const volatile* addr, MemoryOrder )
+    {
+        T* result = *addr;
+        _ReadWriteBarrier();
+        return result;
+    }
+
+    template< class T >
+    inline void AtomicStore( T* volatile* addr, T* value, MemoryOrder order )
+    {
+        if ( order == MemoryOrders::Sequential )
+        {
+            AtomicExchange( addr, value, order );
+        }
+        else
+        {
+            _ReadWriteBarrier();
+            *addr = value;
+        }
+    }
+}
@@ -83,14 +83,27 @@ bool Helium::MakePath( const tchar* path )
     return true;
 }
 
-bool Helium::Copy( const tchar* source, const tchar* dest, bool overwrite )
+bool Helium::Copy( const tchar* source, const tchar* dest, bool overwrite, CopyStrategy* strategy )
 {
-    return ( TRUE == ::CopyFile( source, dest, overwrite ? FALSE : TRUE ) );
+    // CopyFile already copies in the kernel (and clones on ReFS volumes that can), and keeps the timestamps
+    bool result = ( TRUE == ::CopyFile( source, dest, overwrite ? FALSE : TRUE ) );
+
+    if ( strategy )
+    {
+        *strategy = result ? CopyStrategies::System : CopyStrategies::None;
+    }
+
+    return result;
 }
 
 bool Helium::Move( const tchar* source, const tchar* dest )
 {
-    return ( TRUE == ::MoveFile( source, dest ) );
+    return ( TRUE == ::MoveFileEx( source, dest, MOVEFILE_COPY_ALLOWED ) );
+}
+
+bool Helium::Replace( const tchar* source, const tchar* dest )
+{
+    return ( TRUE == ::MoveFileEx( source, dest, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) );
 }
 
 bool Helium::Delete( const tchar* path )
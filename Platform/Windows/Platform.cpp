@@ -3,6 +3,7 @@
 #include "Platform/Assert.h"
 
 #include <eh.h>
+#include <intrin.h>
 #include <new.h>
 #include <stdlib.h>
 #include <sstream>
@@ -106,3 +107,47 @@ void Helium::Sleep(int millis)
 {
     ::Sleep(millis);
 }
+
+u32 Helium::GetProcessorCount()
+{
+    SYSTEM_INFO info;
+    ::GetSystemInfo( &info );
+    return info.dwNumberOfProcessors;
+}
+
+u32 Helium::GetProcessorFeatures()
+{
+    u32 features = 0;
+
+#if defined( _M_IX86 ) || defined( _M_X64 )
+    int info[ 4 ];
+    __cpuid( info, 0 );
+    int maxLeaf = info[ 0 ];
+
+    __cpuid( info, 1 );
+    int ecx = info[ 2 ];
+    int edx = info[ 3 ];
+
+    features |= ( edx & ( 1 << 26 ) ) ? ProcessorFeatures::SSE2 : 0;
+    features |= ( ecx & ( 1 << 9 ) ) ? ProcessorFeatures::SSSE3 : 0;
+    features |= ( ecx & ( 1 << 19 ) ) ? ProcessorFeatures::SSE41 : 0;
+    features |= ( ecx & ( 1 << 20 ) ) ? ProcessorFeatures::SSE42 : 0;
+    features |= ( ecx & ( 1 << 1 ) ) ? ProcessorFeatures::PCLMUL : 0;
+
+# if _MSC_FULL_VER >= 160040219
+    // avx needs the OS to save the upper halves of the registers across context switches
+    if ( ( ecx & ( 1 << 27 ) ) && ( ecx & ( 1 << 28 ) ) && ( _xgetbv( 0 ) & 0x6 ) == 0x6 )
+    {
+        features |= ProcessorFeatures::AVX;
+
+        if ( maxLeaf >= 7 )
+        {
+            __cpuidex( info, 7, 0 );
+            features |= ( info[ 1 ] & ( 1 << 5 ) ) ? ProcessorFeatures::AVX2 : 0;
+        }
+    }
+# endif
+#endif
+
+    return features;
+}
@@ -1,5 +1,6 @@
 #include "Platform/Windows/Windows.h"
 #include "Platform/Windows/Socket.h"
+#include "Platform/Error.h"
 #include "Platform/Socket.h"
 #include "Platform/Assert.h"
 #include "Platform/Platform.h"
@@ -139,7 +140,17 @@ bool Helium::AcceptSocket(Socket& socket, Socket& server_socket, sockaddr_in* cl
 
     socket.m_Handle = ::accept( server_socket, (struct sockaddr *)client_info, &lengthname);
 
-    return socket != SOCKET_ERROR;
+    if ( socket == INVALID_SOCKET )
+    {
+        return false;
+    }
+
+    // accepted sockets inherit any WSAEventSelect from the server socket (which also makes them non-blocking)
+    ::WSAEventSelect( socket, NULL, 0 );
+    u_long blocking = 0;
+    ::ioctlsocket( socket, FIONBIO, &blocking );
+
+    return true;
 }
 
 int Helium::SelectSocket(int range, fd_set* read_set, fd_set* write_set,struct timeval* timeout)
@@ -147,7 +158,7 @@ int Helium::SelectSocket(int range, fd_set* read_set, fd_set* write_set,struct t
     return ::select(range, read_set, write_set, 0, timeout);
 }
 
-bool Helium::ReadSocket(Socket& socket, void* buffer, u32 bytes, u32& read, Condition& terminate)
+bool Helium::ReadSocket(Socket& socket, void* buffer, u32 bytes, u32& read, SocketPoller& poller)
 {
     if (bytes == 0)
     {
@@ -171,7 +182,7 @@ bool Helium::ReadSocket(Socket& socket, void* buffer, u32 bytes, u32& read, Cond
         }
         else
         {
-            HANDLE events[] = { terminate.GetHandle(), socket.m_Overlapped.hEvent };
+            HANDLE events[] = { poller.GetWakeupHandle(), socket.m_Overlapped.hEvent };
             DWORD result = ::WSAWaitForMultipleEvents(2, events, FALSE, INFINITE, FALSE);
 
             HELIUM_ASSERT( result != WAIT_FAILED );
@@ -204,7 +215,7 @@ bool Helium::ReadSocket(Socket& socket, void* buffer, u32 bytes, u32& read, Cond
     return true;
 }
 
-bool Helium::WriteSocket(Socket& socket, void* buffer, u32 bytes, u32& wrote, Condition& terminate)
+bool Helium::WriteSocket(Socket& socket, void* buffer, u32 bytes, u32& wrote, SocketPoller& poller)
 {
     if (bytes == 0)
     {
@@ -228,7 +239,7 @@ bool Helium::WriteSocket(Socket& socket, void* buffer, u32 bytes, u32& wrote, Co
         }
         else
         {
-            HANDLE events[] = { terminate.GetHandle(), socket.m_Overlapped.hEvent };
+            HANDLE events[] = { poller.GetWakeupHandle(), socket.m_Overlapped.hEvent };
             DWORD result = ::WSAWaitForMultipleEvents(2, events, FALSE, INFINITE, FALSE);
 
             HELIUM_ASSERT( result != WAIT_FAILED );
@@ -259,4 +270,221 @@ bool Helium::WriteSocket(Socket& socket, void* buffer, u32 bytes, u32& wrote, Co
     wrote = (u32)wrote_local;
 
     return true;
+}
+
+bool Helium::WriteSocketVector(Socket& socket, const SocketBuffer* buffers, u32 count, u32& wrote, SocketPoller& poller)
+{
+    HELIUM_ASSERT( count <= SOCKET_MAX_BUFFERS );
+
+    WSABUF bufs[ SOCKET_MAX_BUFFERS ];
+    DWORD used = 0;
+    for ( u32 i = 0; i < count; ++i )
+    {
+        if ( buffers[ i ].m_Size )
+        {
+            bufs[ used ].buf = (CHAR*)buffers[ i ].m_Data;
+            bufs[ used ].len = buffers[ i ].m_Size;
+            used++;
+        }
+    }
+
+    if (used == 0)
+    {
+        return true;
+    }
+
+    DWORD flags = 0;
+    DWORD wrote_local = 0;
+    if ( ::WSASend(socket.m_Handle, bufs, used, &wrote_local, 0, (OVERLAPPED*)&socket.m_Overlapped, NULL) != 0 )
+    {
+        if ( WSAGetLastError() != WSA_IO_PENDING )
+        {
+#ifdef IPC_TCP_DEBUG_SOCKETS
+            Helium::Print("TCP Support: Failed to initiate overlapped gathered write (%s)\n", Helium::GetErrorString().c_str());
+#endif
+            return false;
+        }
+        else
+        {
+            HANDLE events[] = { poller.GetWakeupHandle(), socket.m_Overlapped.hEvent };
+            DWORD result = ::WSAWaitForMultipleEvents(2, events, FALSE, INFINITE, FALSE);
+
+            HELIUM_ASSERT( result != WAIT_FAILED );
+
+            if ( (result - WAIT_OBJECT_0) == 0 )
+            {
+#ifdef IPC_TCP_DEBUG_SOCKETS
+                Helium::Print("TCP Support: Terminating write\n");
+#endif
+                return false;
+            }
+
+            if ( !::WSAGetOverlappedResult(socket.m_Handle, (OVERLAPPED*)&socket.m_Overlapped, &wrote_local, false, &flags) )
+            {
+#ifdef IPC_TCP_DEBUG_SOCKETS
+                Helium::Print("TCP Support: Failed gathered write (%s)\n", Helium::GetErrorString().c_str());
+#endif
+                return false;
+            }
+        }
+    }
+
+    if (wrote_local == 0)
+    {
+        return false;
+    }
+
+    wrote = (u32)wrote_local;
+
+    return true;
+}
+
+SocketPoller::SocketPoller()
+: m_Count (0)
+{
+    m_Wakeup = ::CreateEvent( NULL, TRUE, FALSE, NULL );
+    if ( !m_Wakeup )
+    {
+        Helium::Print(TXT("TCP Support: Failed to create wakeup event (%s)\n"), Helium::GetErrorString().c_str());
+        HELIUM_BREAK();
+    }
+}
+
+SocketPoller::~SocketPoller()
+{
+    while ( m_Count )
+    {
+        ::WSACloseEvent( m_Registrations[ --m_Count ].m_Event );
+    }
+
+    ::CloseHandle( m_Wakeup );
+}
+
+bool SocketPoller::Add( Socket& socket, u32 events, void* userData )
+{
+    if ( m_Count >= SOCKET_POLLER_MAX )
+    {
+        Helium::Print(TXT("TCP Support: Too many sockets registered with poller\n"));
+        return false;
+    }
+
+    long networkEvents = FD_CLOSE;
+    if ( events & SocketEvents::Read )
+    {
+        networkEvents |= FD_READ | FD_ACCEPT;
+    }
+    if ( events & SocketEvents::Write )
+    {
+        networkEvents |= FD_WRITE | FD_CONNECT;
+    }
+
+    WSAEVENT event = ::WSACreateEvent();
+    if ( event == WSA_INVALID_EVENT || ::WSAEventSelect( socket, event, networkEvents ) == SOCKET_ERROR )
+    {
+        Helium::Print(TXT("TCP Support: Failed to register socket (%d)\n"), WSAGetLastError());
+        if ( event != WSA_INVALID_EVENT )
+        {
+            ::WSACloseEvent( event );
+        }
+        return false;
+    }
+
+    Registration& registration = m_Registrations[ m_Count++ ];
+    registration.m_Socket = (uintptr)socket.m_Handle;
+    registration.m_Event = event;
+    registration.m_Events = events;
+    registration.m_UserData = userData;
+
+    return true;
+}
+
+bool SocketPoller::Remove( Socket& socket )
+{
+    for ( u32 i = 0; i < m_Count; ++i )
+    {
+        if ( m_Registrations[ i ].m_Socket == (uintptr)socket.m_Handle )
+        {
+            ::WSAEventSelect( socket, NULL, 0 );
+            ::WSACloseEvent( m_Registrations[ i ].m_Event );
+
+            m_Registrations[ i ] = m_Registrations[ --m_Count ];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int SocketPoller::Wait( Event* events, u32 count, u32 timeout )
+{
+    HELIUM_ASSERT( count > 0 );
+
+    HANDLE handles[ SOCKET_POLLER_MAX + 1 ];
+    handles[ 0 ] = m_Wakeup;
+    for ( u32 i = 0; i < m_Count; ++i )
+    {
+        handles[ i + 1 ] = m_Registrations[ i ].m_Event;
+    }
+
+    DWORD result = ::WSAWaitForMultipleEvents( m_Count + 1, handles, FALSE, timeout == 0xffffffff ? WSA_INFINITE : timeout, FALSE );
+    if ( result == WSA_WAIT_TIMEOUT || result == WSA_WAIT_EVENT_0 )
+    {
+        return 0;
+    }
+
+    if ( result == WSA_WAIT_FAILED )
+    {
+        Helium::Print(TXT("TCP Support: Failed to wait for sockets (%d)\n"), WSAGetLastError());
+        return -1;
+    }
+
+    // report every signaled socket starting from the first one, resetting their events as we go
+    int written = 0;
+    for ( u32 i = result - WSA_WAIT_EVENT_0 - 1; i < m_Count && (u32)written < count; ++i )
+    {
+        Registration& registration = m_Registrations[ i ];
+
+        WSANETWORKEVENTS networkEvents;
+        if ( ::WSAEnumNetworkEvents( (SOCKET)registration.m_Socket, registration.m_Event, &networkEvents ) == SOCKET_ERROR || networkEvents.lNetworkEvents == 0 )
+        {
+            continue;
+        }
+
+        events[ written ].m_UserData = registration.m_UserData;
+        events[ written ].m_Events = 0;
+
+        if ( networkEvents.lNetworkEvents & ( FD_READ | FD_ACCEPT ) )
+        {
+            events[ written ].m_Events |= SocketEvents::Read;
+        }
+
+        if ( networkEvents.lNetworkEvents & ( FD_WRITE | FD_CONNECT ) )
+        {
+            events[ written ].m_Events |= SocketEvents::Write;
+        }
+
+        if ( networkEvents.lNetworkEvents & FD_CLOSE )
+        {
+            events[ written ].m_Events |= SocketEvents::Closed;
+        }
+
+        ++written;
+    }
+
+    return written;
+}
+
+void SocketPoller::Wakeup()
+{
+    ::SetEvent( m_Wakeup );
+}
+
+void SocketPoller::Reset()
+{
+    ::ResetEvent( m_Wakeup );
+}
+
+bool SocketPoller::Woken()
+{
+    return ::WaitForSingleObject( m_Wakeup, 0 ) == WAIT_OBJECT_0;
 }
\ No newline at end of file
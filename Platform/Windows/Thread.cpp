@@ -131,6 +131,32 @@ bool Thread::Valid()
     return m_Handle != 0;
 }
 
+bool Thread::SetAffinity( u64 mask )
+{
+    HELIUM_ASSERT( Valid() );
+
+    if ( !::SetThreadAffinityMask( m_Handle, (DWORD_PTR)mask ) )
+    {
+        Helium::Print(TXT("Failed to set thread affinity (%s)\n"), Helium::GetErrorString().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool Thread::SetPriority( int priority )
+{
+    HELIUM_ASSERT( Valid() );
+
+    if ( !::SetThreadPriority( m_Handle, priority ) )
+    {
+        Helium::Print(TXT("Failed to set thread priority (%s)\n"), Helium::GetErrorString().c_str());
+        return false;
+    }
+
+    return true;
+}
+
 ThreadLocalPointer::ThreadLocalPointer()
 {
     m_Key = TlsAlloc(); 